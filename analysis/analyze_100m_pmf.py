@@ -8,7 +8,8 @@ Usage:
   python analyze_100m_pmf.py --db ../solvers/100m_policy.db --out 100m_pmf.png --csv 100m_pmf.csv
 
 Notes:
-- We reconstruct the PMF by recursion:
+- By default the PMF is read from the pmf100m table written by the solver.
+- With --reconstruct we rebuild the PMF by recursion:
     pmf(state) = pmf after taking the policy's best action at that state,
     expanding one roll (over all 4-dice outcomes) when the action involves a roll.
 - Terminal when stage=2 and the best action is FREEZE → degenerate distribution at set1 + score(current).
@@ -52,7 +53,7 @@ def fetch_policy(cur, stage, rerolls, dice_sorted, set1_score):
         row = cur.execute(
             """SELECT best, ev_freeze, sd_freeze, ev_reroll, sd_reroll
                FROM states100m
-              WHERE stage=? AND rerolls=? AND d1=? AND d2=? AND d3=? AND d4=? AND set1_score IS NULL""",
+              WHERE stage=? AND rerolls=? AND d1=? AND d2=? AND d3=? AND d4=? AND set1_score=0""",
             (1, rerolls, d1, d2, d3, d4)
         ).fetchone()
     else:
@@ -64,7 +65,8 @@ def fetch_policy(cur, stage, rerolls, dice_sorted, set1_score):
         ).fetchone()
     if row is None:
         raise RuntimeError(f"Policy row not found for state: stage={stage}, rerolls={rerolls}, dice={dice_sorted}, set1={set1_score}")
-    return row  # (best, evF, sdF, evR, sdR)
+    best, evF, sdF, evR, sdR = row
+    return ("freeze", "reroll")[best], evF, sdF, evR, sdR
 
 def pmf_add(pmf_a, pmf_b, w=1.0):
     """Add pmf_b into pmf_a with weight w."""
@@ -80,6 +82,23 @@ def pmf_mean_sd(pmf):
     var = sum((x-mu)**2 * p for x,p in pmf.items())
     return mu, math.sqrt(max(0.0, var))
 
+def load_stored_pmf(db_path, verbose=False):
+    """(pmf, mu, sd) from the pmf100m table written by the solver, or None if the DB predates it."""
+    conn = sqlite3.connect(db_path)
+    try:
+        rows = conn.execute("SELECT score, pmf FROM pmf100m WHERE pmf > 0 ORDER BY score").fetchall()
+    except sqlite3.OperationalError:
+        return None
+    finally:
+        conn.close()
+    if not rows:
+        return None
+    pmf = dict(rows)
+    mu, sd = pmf_mean_sd(pmf)
+    if verbose:
+        print(f"Final-score EV = {mu:.6f}, SD = {sd:.6f} (stored pmf100m), support size = {len(pmf)}")
+    return pmf, mu, sd
+
 def reconstruct_pmf(db_path, verbose=False):
     conn = sqlite3.connect(db_path)
     cur = conn.cursor()
@@ -129,10 +148,13 @@ def main():
     ap.add_argument("--db", required=True, help="Path to 100m_policy.db")
     ap.add_argument("--out", default="100m_pmf.png", help="Output image path (PNG)")
     ap.add_argument("--csv", default=None, help="Optional CSV dump of (score,prob)")
+    ap.add_argument("--reconstruct", action="store_true",
+                    help="Re-walk the policy instead of reading the stored PMF table")
     ap.add_argument("--verbose", action="store_true")
     args = ap.parse_args()
 
-    pmf, mu, sd = reconstruct_pmf(args.db, verbose=args.verbose)
+    stored = None if args.reconstruct else load_stored_pmf(args.db, verbose=args.verbose)
+    pmf, mu, sd = stored or reconstruct_pmf(args.db, verbose=args.verbose)
 
     # Plot
     import matplotlib.pyplot as plt
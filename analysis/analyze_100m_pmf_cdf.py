@@ -14,6 +14,9 @@ Usage:
       --pmf-out 100m_pmf.png --pmf-csv 100m_pmf.csv \
       --cdf-out 100m_cdf.png --cdf-txt 100m_cdf.txt \
       --verbose
+
+The PMF comes from the pmf100m table written by the solver; --reconstruct
+re-derives it by walking the policy states instead.
 """
 
 import argparse
@@ -52,7 +55,7 @@ def fetch_policy(cur, stage, rerolls, dice_sorted, set1_score):
         row = cur.execute(
             """SELECT best, ev_freeze, sd_freeze, ev_reroll, sd_reroll
                FROM states100m
-              WHERE stage=? AND rerolls=? AND d1=? AND d2=? AND d3=? AND d4=? AND set1_score IS NULL""",
+              WHERE stage=? AND rerolls=? AND d1=? AND d2=? AND d3=? AND d4=? AND set1_score=0""",
             (1, rerolls, d1, d2, d3, d4)
         ).fetchone()
     else:
@@ -64,7 +67,8 @@ def fetch_policy(cur, stage, rerolls, dice_sorted, set1_score):
         ).fetchone()
     if row is None:
         raise RuntimeError(f"Policy row not found for state: stage={stage}, rerolls={rerolls}, dice={dice_sorted}, set1={set1_score}")
-    return row  # (best, evF, sdF, evR, sdR)
+    best, evF, sdF, evR, sdR = row
+    return ("freeze", "reroll")[best], evF, sdF, evR, sdR
 
 def pmf_add(pmf_a, pmf_b, w=1.0):
     for x, p in pmf_b.items():
@@ -79,6 +83,23 @@ def pmf_mean_sd(pmf):
     var = sum((x-mu)**2 * p for x,p in pmf.items())
     return mu, math.sqrt(max(0.0, var))
 
+def load_stored_pmf(db_path, verbose=False):
+    """(pmf, mu, sd) from the pmf100m table written by the solver, or None if the DB predates it."""
+    conn = sqlite3.connect(db_path)
+    try:
+        rows = conn.execute("SELECT score, pmf FROM pmf100m WHERE pmf > 0 ORDER BY score").fetchall()
+    except sqlite3.OperationalError:
+        return None
+    finally:
+        conn.close()
+    if not rows:
+        return None
+    pmf = dict(rows)
+    mu, sd = pmf_mean_sd(pmf)
+    if verbose:
+        print(f"Final-score EV = {mu:.6f}, SD = {sd:.6f} (stored pmf100m), support size = {len(pmf)}")
+    return pmf, mu, sd
+
 def reconstruct_pmf(db_path, verbose=False):
     conn = sqlite3.connect(db_path)
     cur = conn.cursor()
@@ -142,10 +163,13 @@ def main():
     ap.add_argument("--pmf-csv", default=None, help="Optional PMF CSV")
     ap.add_argument("--cdf-out", default="100m_cdf.png", help="CDF plot (PNG)")
     ap.add_argument("--cdf-txt", default="100m_cdf.txt", help="CDF text table")
+    ap.add_argument("--reconstruct", action="store_true",
+                    help="Re-walk the policy instead of reading the stored PMF table")
     ap.add_argument("--verbose", action="store_true")
     args = ap.parse_args()
 
-    pmf, mu, sd = reconstruct_pmf(args.db, verbose=args.verbose)
+    stored = None if args.reconstruct else load_stored_pmf(args.db, verbose=args.verbose)
+    pmf, mu, sd = stored or reconstruct_pmf(args.db, verbose=args.verbose)
 
     # --- PMF plot and CSV ---
     import matplotlib.pyplot as plt
@@ -3,21 +3,30 @@
 Reconstruct and plot PMF and CDF for Long Jump final score under optimal play,
 using the precomputed SQLite DB produced by longjump_precompute.cpp.
 
-- First reconstruct the *attempt* distribution exactly (one attempt: run-up then jump).
-- Then compute the *event* distribution for "best of k attempts" (iid) via CDF^k.
+- First load the exact *attempt* distribution (one attempt: run-up then jump).
+- Then compute the *event* distribution for "best of k attempts" (iid) via CDF^k,
+  or, for k=3 with a DB built by `longjump_precompute --bo3`, read the exact
+  distribution under the best-of-three policy (lj_bo3_pmf).
 
 Outputs:
   --attempt-pmf, --attempt-cdf, --attempt-cdf-txt
   --final-pmf, --final-cdf, --final-cdf-txt   (final = best of k)
 
 DB schema (from the C++ precompute):
-  lj_post(phase, sum_frozen, n1..n6, f1..f6)
+  lj_post_simple(phase, sum_frozen, n1..n6, freeze_count)
     phase: 1=RUNUP_POST, 3=JUMP_POST
-    sum_frozen: only for RUNUP_POST (NULL for JUMP_POST)
+    sum_frozen: only for RUNUP_POST (0 for JUMP_POST)
     n1..n6: counts of pips among rolled dice (post-roll state)
-    f1..f6: how many of each pip to freeze now (optimal)
+    freeze_count: how many dice to freeze now — the smallest in the run-up,
+                  the largest in the jump; 0 in the run-up means stop and jump
+
+The attempt PMF is read from the lj_attempt_pmf table that the solver writes.
+--reconstruct re-derives it by walking the policy instead; with --bin (and
+solvers/libdecathlon_policy.so built), that walk reads decisions from the
+binary policy file instead of SQLite.
 """
-import argparse, sqlite3, math
+import argparse, sqlite3, math, sys
+from pathlib import Path
 from functools import lru_cache
 from collections import Counter
 
@@ -52,20 +61,34 @@ def outcomes_counts(n):
 # cache outcomes
 _OUT = {n: outcomes_counts(n) for n in range(0,6)}
 
+sys.path.insert(0, str(Path(__file__).resolve().parents[1]))
+from players import policy_lib
+
+def freeze_faces(phase, cnt, k):
+    """Freeze the k smallest dice in the run-up, the k largest in the jump."""
+    f = {i: 0 for i in range(1,7)}
+    for face in (range(1,7) if phase==RUNUP_POST else range(6,0,-1)):
+        take = min(cnt[face], k)
+        f[face] = take
+        k -= take
+    return f
+
 def fetch_decision(cur, phase, sum_frozen, cnt):
-    row = cur.execute(
-        """SELECT f1,f2,f3,f4,f5,f6 FROM lj_post
-           WHERE phase=? AND (sum_frozen IS ? OR sum_frozen=?) AND
-                 n1=? AND n2=? AND n3=? AND n4=? AND n5=? AND n6=?""",
-        (phase,
-         None if phase==JUMP_POST else None,
-         None if phase==JUMP_POST else sum_frozen,
-         cnt[1],cnt[2],cnt[3],cnt[4],cnt[5],cnt[6])
-    ).fetchone()
-    if row is None:
+    """`cur` is a SQLite cursor or a policy_lib.Policy."""
+    if isinstance(cur, policy_lib.Policy):
+        k = cur.best_action(cur.index_longjump(phase, sum_frozen, cnt))
+    else:
+        row = cur.execute(
+            """SELECT freeze_count FROM lj_post_simple
+               WHERE phase=? AND sum_frozen=? AND
+                     n1=? AND n2=? AND n3=? AND n4=? AND n5=? AND n6=?""",
+            (phase, 0 if phase==JUMP_POST else sum_frozen,
+             cnt[1],cnt[2],cnt[3],cnt[4],cnt[5],cnt[6])
+        ).fetchone()
+        k = None if row is None else row[0]
+    if k is None:
         raise RuntimeError(f"No policy row for phase={phase}, s={sum_frozen}, cnt={cnt}")
-    f = {i: row[i-1] for i in range(1,7)}
-    return f
+    return freeze_faces(phase, cnt, k)
 
 def pmf_add(a, b, w=1.0):
     for x,p in b.items():
@@ -80,9 +103,29 @@ def pmf_mean_sd(pmf):
     var = sum((x-mu)**2*p for x,p in pmf.items())
     return mu, math.sqrt(max(0.0, var))
 
-def reconstruct_attempt_pmf(db_path, verbose=False):
+def load_stored_pmf(db_path, verbose=False, table="lj_attempt_pmf", label="Attempt"):
+    """(pmf, mu, sd) from a PMF table written by the solver, or None if the DB predates it."""
     conn = sqlite3.connect(db_path)
-    cur = conn.cursor()
+    try:
+        rows = conn.execute(f"SELECT score, pmf FROM {table} WHERE pmf > 0 ORDER BY score").fetchall()
+    except sqlite3.OperationalError:
+        return None
+    finally:
+        conn.close()
+    if not rows:
+        return None
+    pmf = dict(rows)
+    mu, sd = pmf_mean_sd(pmf)
+    if verbose:
+        print(f"{label} EV = {mu:.6f}, SD = {sd:.6f} (stored {table}), support size = {len(pmf)}")
+    return pmf, mu, sd
+
+def reconstruct_attempt_pmf(db_path, verbose=False, bin_path=None):
+    if bin_path:
+        conn = cur = policy_lib.Policy(bin_path)
+    else:
+        conn = sqlite3.connect(db_path)
+        cur = conn.cursor()
 
     @lru_cache(maxsize=None)
     def pmf_jump_pre(n_rem):
@@ -101,39 +144,23 @@ def reconstruct_attempt_pmf(db_path, verbose=False):
 
     @lru_cache(maxsize=None)
     def pmf_runup_pre(n_rem, s):
-        # Base: if we've frozen all 5 dice in the run-up (n_rem==0),
-        # jump uses k = 5 - n_rem dice (i.e., 5)
-        if s > 8:
-            # shouldn't be called, but treat as invalid attempt = 0
-            return {0:1.0}
+        # Jump uses the k = 5 - n_rem dice frozen so far in the run-up
+        k = 5 - n_rem
         if n_rem == 0:
-            k = 5 - n_rem
             return pmf_jump_pre(k)
 
-        # STOP option -> jump with k = 5 - n_rem dice
-        k = 5 - n_rem
-        pmf_stop = pmf_jump_pre(k)
-
-        # ROLL option -> expand outcomes of n_rem dice; at POST freeze per optimal policy
-        pmf_roll = {}
+        # Roll, then freeze per the policy; freezing nothing means stop and jump
+        pmf = {}
         for cnt, p in _OUT[n_rem]:
             f = fetch_decision(cur, RUNUP_POST, s, cnt)
             add = sum(i*f[i] for i in range(1,7))
             total_frozen = sum(f[i] for i in range(1,7))
-            if add <= 0 or s + add > 8 or total_frozen <= 0:
-                # No legal freeze -> invalid attempt for this outcome: contributes mass at 0
-                pmf_add(pmf_roll, {0: p})
-                continue
-            sub = pmf_runup_pre(n_rem - total_frozen, s + add)
-            pmf_add(pmf_roll, pmf_scale(sub, p))
-
-        # Choose better branch by EV (tie → lower SD → prefer STOP)
-        mu_stop, sd_stop = pmf_mean_sd(pmf_stop)
-        mu_roll, sd_roll = pmf_mean_sd(pmf_roll) if pmf_roll else (0.0, 0.0)
-        if (mu_roll > mu_stop) or (abs(mu_roll - mu_stop) < 1e-12 and sd_roll < sd_stop):
-            return pmf_roll
-        else:
-            return pmf_stop
+            if total_frozen == 0:
+                sub = pmf_jump_pre(k)
+            else:
+                sub = pmf_runup_pre(n_rem - total_frozen, s + add)
+            pmf_add(pmf, pmf_scale(sub, p))
+        return pmf
 
     pmf_attempt = pmf_runup_pre(5, 0)
     mu, sd = pmf_mean_sd(pmf_attempt)
@@ -169,6 +196,7 @@ def dump_txt(path, xs, ys, header):
 def main():
     ap = argparse.ArgumentParser()
     ap.add_argument("--db", required=True, help="Path to longjump_policy.db")
+    ap.add_argument("--bin", default=None, help="Optional longjump_policy.bin, read via libdecathlon_policy")
     ap.add_argument("--attempt-pmf", default="longjump_attempt_pmf.png")
     ap.add_argument("--attempt-cdf", default="longjump_attempt_cdf.png")
     ap.add_argument("--attempt-cdf-txt", default="longjump_attempt_cdf.txt")
@@ -176,10 +204,13 @@ def main():
     ap.add_argument("--final-cdf", default="longjump_final_cdf.png")
     ap.add_argument("--final-cdf-txt", default="longjump_final_cdf.txt")
     ap.add_argument("--k", type=int, default=3, help="best of k attempts (default 3)")
+    ap.add_argument("--reconstruct", action="store_true",
+                    help="Re-walk the policy instead of reading the stored PMF table")
     ap.add_argument("--verbose", action="store_true")
     args = ap.parse_args()
 
-    pmf_attempt, mu_a, sd_a = reconstruct_attempt_pmf(args.db, verbose=args.verbose)
+    stored = None if args.reconstruct or args.bin else load_stored_pmf(args.db, verbose=args.verbose)
+    pmf_attempt, mu_a, sd_a = stored or reconstruct_attempt_pmf(args.db, verbose=args.verbose, bin_path=args.bin)
 
     # PMF/CDF plots (attempt)
     import matplotlib.pyplot as plt
@@ -205,8 +236,13 @@ def main():
         dump_txt(args.attempt_cdf_txt, Xa, Fa, "# score\tcdf")
         print(f"Wrote {args.attempt_cdf_txt}")
 
-    # Final event = best of k attempts
-    F_final_pmf = cdf_power_to_pmf(Xa, Fa, args.k)
+    # Final event = best of k attempts. A DB built with --bo3 has the exact
+    # distribution under the best-of-three policy; otherwise assume k iid
+    # attempts, each played for single-attempt EV.
+    bo3 = None
+    if args.k == 3 and not (args.reconstruct or args.bin):
+        bo3 = load_stored_pmf(args.db, verbose=args.verbose, table="lj_bo3_pmf", label="Best-of-3")
+    F_final_pmf = bo3[0] if bo3 else cdf_power_to_pmf(Xa, Fa, args.k)
     Xf = sorted(F_final_pmf.keys())
     Pf = [F_final_pmf[x] for x in Xf]
     muf = sum(x*p for x,p in F_final_pmf.items())
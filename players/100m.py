@@ -2,7 +2,10 @@
 import sqlite3, random
 from pathlib import Path
 
+from players import policy_lib
+
 DB_PATH = Path(__file__).resolve().parents[1] / "solvers" / "100m_policy.db"
+BIN_PATH = DB_PATH.with_suffix(".bin")  # written by 100m_precompute --policy-bin
 
 def score_set(d):  # for printing only
     return sum(v if v < 6 else -6 for v in d)
@@ -13,9 +16,8 @@ def lookup(cur, stage, rerolls, dice, set1_score):
         """SELECT ev_freeze, sd_freeze, ev_reroll, sd_reroll, best
              FROM states100m
             WHERE stage=? AND rerolls=? AND d1=? AND d2=? AND d3=? AND d4=? AND
-                  (set1_score IS ? OR set1_score = ?)""",
-        (stage, rerolls, d[0], d[1], d[2], d[3],
-         None if stage==1 else None, None if stage==1 else set1_score)
+                  set1_score=?""",
+        (stage, rerolls, d[0], d[1], d[2], d[3], 0 if stage==1 else set1_score)
     ).fetchone()
     if row is None:
         raise RuntimeError(f"State not found: stage={stage}, rerolls={rerolls}, dice={d}, set1={set1_score}")
@@ -23,7 +25,28 @@ def lookup(cur, stage, rerolls, dice, set1_score):
     acts = {"freeze": (evF, sdF)}
     if evR is not None:
         acts["reroll"] = (evR, sdR)
-    return best, acts
+    return ("freeze", "reroll")[best], acts
+
+def lookup_bin(pol, stage, rerolls, dice, set1_score):
+    """Same result as lookup(), via libdecathlon_policy."""
+    idx = pol.index_100m(stage, rerolls, dice, set1_score)
+    best = pol.best_action(idx)
+    if best is None:
+        raise RuntimeError(f"State not found: stage={stage}, rerolls={rerolls}, dice={tuple(sorted(dice))}, set1={set1_score}")
+    acts = {"freeze": pol.moments(idx, policy_lib.FREEZE)}
+    reroll = pol.moments(idx, policy_lib.REROLL)
+    if reroll is not None:
+        acts["reroll"] = reroll
+    return ("reroll" if best == policy_lib.REROLL else "freeze"), acts
+
+def open_lookup():
+    """Return (query, close): the binary policy via libdecathlon_policy if built, else SQLite."""
+    if policy_lib.available(BIN_PATH):
+        pol = policy_lib.Policy(BIN_PATH)
+        return (lambda *state: lookup_bin(pol, *state)), pol.close
+    conn = sqlite3.connect(DB_PATH)
+    cur = conn.cursor()
+    return (lambda *state: lookup(cur, *state)), conn.close
 
 def fmt_acts(best, acts):
     lines=[]
@@ -34,8 +57,8 @@ def fmt_acts(best, acts):
 
 def interactive(play_auto=False, seed=None):
     rng = random.Random(seed)
-    with sqlite3.connect(DB_PATH) as conn:
-        cur = conn.cursor()
+    query, close = open_lookup()
+    try:
         rerolls = 5
         # stage 1 initial roll
         dice = tuple(sorted(rng.choices([1,2,3,4,5,6], k=4)))
@@ -48,10 +71,10 @@ def interactive(play_auto=False, seed=None):
         while True:
             if stage == 1:
                 print(f"[SET 1] Dice: {dice} | score-if-freeze={score_set(dice):2d} | rerolls={rerolls}")
-                best, acts = lookup(cur, 1, rerolls, dice, None)
+                best, acts = query(1, rerolls, dice, None)
             else:
                 print(f"[SET 2] Dice: {dice} | score-if-freeze={score_set(dice):2d} | rerolls={rerolls} | set1={set1}")
-                best, acts = lookup(cur, 2, rerolls, dice, set1)
+                best, acts = query(2, rerolls, dice, set1)
 
             print(fmt_acts(best, acts))
 
@@ -89,6 +112,8 @@ def interactive(play_auto=False, seed=None):
                 else:
                     rerolls -= 1
                     dice = tuple(sorted(rng.choices([1,2,3,4,5,6], k=4)))
+    finally:
+        close()
 
 if __name__ == "__main__":
     interactive(play_auto=False)
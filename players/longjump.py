@@ -2,11 +2,14 @@
 """
 Interactive player for Long Jump in Knizia's Dice Decathlon.
 
-Reads optimal policy from solvers/longjump_policy.db (from longjump_precompute.cpp).
+Reads optimal policy from solvers/longjump_policy.db (from longjump_precompute.cpp),
+or from solvers/longjump_policy.bin through libdecathlon_policy when both are built.
+If the DB was generated with --bo3, hints come from the best-of-three policy,
+which depends on the attempt and the best score so far.
 Lets the human roll/freeze or stop, with optional hints from the engine.
 
 Usage:
-    python3 -m players.longjump [--db solvers/longjump_policy.db] [--hint]
+    python3 -m players.longjump [--db solvers/longjump_policy.db] [--bin solvers/longjump_policy.bin] [--hint]
 
 Controls:
     On run-up: choose dice to freeze or 'stop' to end run-up.
@@ -17,6 +20,9 @@ Controls:
 import argparse
 import sqlite3
 import random
+from pathlib import Path
+
+from players import policy_lib
 
 RUNUP_PRE=0; RUNUP_POST=1; JUMP_PRE=2; JUMP_POST=3
 
@@ -29,19 +35,48 @@ def counts_from_dice(dice):
         cnt[d] += 1
     return cnt
 
+def freeze_faces(phase, cnt, k):
+    """The policy freezes the k smallest dice in the run-up and the k largest in the jump."""
+    f = {i: 0 for i in range(1, 7)}
+    for face in (range(1, 7) if phase == RUNUP_POST else range(6, 0, -1)):
+        take = min(cnt[face], k)
+        f[face] = take
+        k -= take
+    return f
+
 def fetch_decision(cur, phase, sum_frozen, cnt):
+    """Faces to freeze now, as {face: count}; all zero means stop the run-up.
+    `cur` is a SQLite cursor or a policy_lib.Policy."""
+    if isinstance(cur, policy_lib.Policy):
+        k = cur.best_action(cur.index_longjump(phase, sum_frozen, cnt))
+    else:
+        row = cur.execute(
+            """SELECT freeze_count FROM lj_post_simple
+               WHERE phase=? AND sum_frozen=? AND
+                     n1=? AND n2=? AND n3=? AND n4=? AND n5=? AND n6=?""",
+            (phase, 0 if phase == JUMP_POST else sum_frozen,
+             cnt[1], cnt[2], cnt[3], cnt[4], cnt[5], cnt[6])
+        ).fetchone()
+        k = None if row is None else row[0]
+    if k is None:
+        raise RuntimeError(f"No policy for phase={phase}, s={sum_frozen}, cnt={cnt}")
+    return freeze_faces(phase, cnt, k)
+
+def has_bo3(conn):
+    return conn.execute("SELECT 1 FROM sqlite_master WHERE type='table' AND name='lj_bo3_post'").fetchone() is not None
+
+def fetch_decision_bo3(cur, attempt, best, phase, sum_frozen, cnt):
+    """Like fetch_decision, from the best-of-three policy: attempt 0..2, best score
+    so far; in the jump phase sum_frozen is the jump sum frozen so far."""
     row = cur.execute(
-        """SELECT f1,f2,f3,f4,f5,f6 FROM lj_post
-           WHERE phase=? AND (sum_frozen IS ? OR sum_frozen=?) AND
+        """SELECT freeze_count FROM lj_bo3_post
+           WHERE attempt=? AND best=? AND phase=? AND sum_frozen=? AND
                  n1=? AND n2=? AND n3=? AND n4=? AND n5=? AND n6=?""",
-        (phase,
-         None if phase == JUMP_POST else None,
-         None if phase == JUMP_POST else sum_frozen,
-         cnt[1], cnt[2], cnt[3], cnt[4], cnt[5], cnt[6])
+        (attempt, best, phase, sum_frozen, cnt[1], cnt[2], cnt[3], cnt[4], cnt[5], cnt[6])
     ).fetchone()
     if row is None:
-        raise RuntimeError(f"No policy for phase={phase}, s={sum_frozen}, cnt={cnt}")
-    return {i: row[i-1] for i in range(1, 7)}
+        raise RuntimeError(f"No policy for attempt={attempt}, best={best}, phase={phase}, s={sum_frozen}, cnt={cnt}")
+    return freeze_faces(phase, cnt, row[0])
 
 def freeze_dice(dice, freeze_faces, freeze_counts):
     """Freeze according to chosen counts per face."""
@@ -56,7 +91,8 @@ def freeze_dice(dice, freeze_faces, freeze_counts):
             remaining.append(d)
     return frozen, remaining
 
-def run_longjump(cur, show_hint=False):
+def run_longjump(decide, show_hint=False):
+    """One attempt; decide(phase, sum_frozen, cnt) gives the engine's freeze."""
     # Run-up phase
     frozen_runup = []
     sum_runup = 0
@@ -66,7 +102,7 @@ def run_longjump(cur, show_hint=False):
         print(f"Run-up roll: {dice}  (sum frozen={sum_runup})")
         cnt = counts_from_dice(dice)
         if show_hint:
-            hint = fetch_decision(cur, RUNUP_POST, sum_runup, cnt)
+            hint = decide(RUNUP_POST, sum_runup, cnt)
             print(f"[HINT] Freeze: {hint}")
         choice = input("Freeze dice (faces) or 'stop': ").strip().lower()
         if choice == 'stop':
@@ -102,7 +138,7 @@ def run_longjump(cur, show_hint=False):
         print(f"Jump roll: {dice}")
         cnt = counts_from_dice(dice)
         if show_hint:
-            hint = fetch_decision(cur, JUMP_POST, None, cnt)
+            hint = decide(JUMP_POST, jump_score, cnt)
             print(f"[HINT] Freeze: {hint}")
         choice = input("Freeze dice (faces) or 'all': ").strip().lower()
         if choice == 'all':
@@ -121,26 +157,43 @@ def run_longjump(cur, show_hint=False):
         jump_score += sum(frozen)
         remaining = len(remaining_dice)
 
-    total_score = sum_runup + jump_score
-    print(f"Attempt score: {total_score}")
-    return total_score
+    # only the jump dice score; the run-up just sets how many there are
+    print(f"Attempt score: {jump_score}")
+    return jump_score
 
 def main():
     ap = argparse.ArgumentParser()
     ap.add_argument("--db", default="solvers/longjump_policy.db")
+    ap.add_argument("--bin", default="solvers/longjump_policy.bin",
+                    help="Binary policy, used instead of --db when libdecathlon_policy is built")
     ap.add_argument("--hint", action="store_true", help="Show engine's optimal freeze each step")
     args = ap.parse_args()
-    conn = sqlite3.connect(args.db)
-    cur = conn.cursor()
+    if policy_lib.available(args.bin):
+        conn = cur = policy_lib.Policy(args.bin)
+    else:
+        conn = sqlite3.connect(args.db)
+        cur = conn.cursor()
+    bo3 = None
+    if Path(args.db).exists():
+        db = sqlite3.connect(args.db)
+        if has_bo3(db):
+            bo3 = db.cursor()
+        else:
+            db.close()
     print("=== Long Jump ===")
     scores = []
-    for attempt in range(1, 4):  # best of 3
-        print(f"\nAttempt {attempt} of 3")
-        score = run_longjump(cur, show_hint=args.hint)
-        scores.append(score)
-    best = max(scores)
-    print(f"\nYour scores: {scores}, Best: {best}")
+    for attempt in range(3):  # best of 3
+        print(f"\nAttempt {attempt + 1} of 3")
+        best = max(scores, default=0)
+        if bo3 is not None:
+            decide = lambda ph, s, cnt: fetch_decision_bo3(bo3, attempt, best, ph, s, cnt)
+        else:
+            decide = lambda ph, s, cnt: fetch_decision(cur, ph, s, cnt)
+        scores.append(run_longjump(decide, show_hint=args.hint))
+    print(f"\nYour scores: {scores}, Best: {max(scores)}")
     conn.close()
+    if bo3 is not None:
+        bo3.connection.close()
 
 if __name__ == "__main__":
     main()
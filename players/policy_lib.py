@@ -0,0 +1,216 @@
+"""
+ctypes binding for libdecathlon_policy (solvers/decathlon_policy.h).
+
+Loads a binary policy file written by a solver with --policy-bin and answers
+lookups through the shared library instead of SQLite.
+
+Build the library first:
+    g++ -O3 -std=c++20 -shared -fPIC solvers/decathlon_policy.cpp -o solvers/libdecathlon_policy.so
+
+Usage:
+    from players.policy_lib import Policy
+    pol = Policy("solvers/100m_policy.bin")
+    best = pol.best_action(pol.index_100m(1, 5, (1, 2, 3, 4)))
+
+Policy.index_100m / index_longjump lay the index out for the rules the file
+was solved with; the module-level index_100m / index_longjump assume the
+standard reroll budget and run-up limit.
+
+PolicyClient asks a running solvers/policy_server for the same lookups over
+its Unix socket, so every process sees reloaded policies without reopening:
+    with PolicyClient("/tmp/decathlon.sock") as cli:
+        (action, ev, sd), = cli.lookup_many(EVENT_100M, [state])
+"""
+import ctypes
+import math
+import socket
+import struct
+from pathlib import Path
+
+SOLVERS_DIR = Path(__file__).resolve().parents[1] / "solvers"
+LIB_PATH = SOLVERS_DIR / "libdecathlon_policy.so"
+
+EVENT_100M = 1
+EVENT_LONGJUMP = 2
+FREEZE, REROLL = 0, 1             # 100m action codes
+RUNUP_POST, JUMP_POST = 1, 3      # long jump phases
+
+
+class Result(ctypes.Structure):
+    _fields_ = [("action", ctypes.c_int32), ("ev", ctypes.c_double), ("sd", ctypes.c_double)]
+
+
+_lib = None
+
+def _load(lib_path=None):
+    global _lib
+    if _lib is not None:
+        return _lib
+    lib = ctypes.CDLL(str(lib_path or LIB_PATH))
+    lib.dp_open.argtypes = [ctypes.c_char_p]
+    lib.dp_open.restype = ctypes.c_void_p
+    lib.dp_close.argtypes = [ctypes.c_void_p]
+    lib.dp_last_error.restype = ctypes.c_char_p
+    lib.dp_event.argtypes = [ctypes.c_void_p]
+    lib.dp_num_states.argtypes = [ctypes.c_void_p]
+    lib.dp_num_states.restype = ctypes.c_uint64
+    lib.dp_root_moments.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_double), ctypes.POINTER(ctypes.c_double)]
+    lib.dp_index_100m.argtypes = [ctypes.c_int, ctypes.c_int, ctypes.POINTER(ctypes.c_int), ctypes.c_int]
+    lib.dp_index_100m.restype = ctypes.c_int32
+    lib.dp_index_longjump.argtypes = [ctypes.c_int, ctypes.c_int, ctypes.POINTER(ctypes.c_int)]
+    lib.dp_index_longjump.restype = ctypes.c_int32
+    lib.dp_state_index_100m.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.c_int, ctypes.POINTER(ctypes.c_int),
+                                        ctypes.c_int]
+    lib.dp_state_index_100m.restype = ctypes.c_int32
+    lib.dp_state_index_longjump.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.c_int, ctypes.POINTER(ctypes.c_int)]
+    lib.dp_state_index_longjump.restype = ctypes.c_int32
+    lib.dp_best_action.argtypes = [ctypes.c_void_p, ctypes.c_int32]
+    lib.dp_best_action.restype = ctypes.c_int32
+    lib.dp_moments.argtypes = [ctypes.c_void_p, ctypes.c_int32, ctypes.c_int32,
+                               ctypes.POINTER(ctypes.c_double), ctypes.POINTER(ctypes.c_double)]
+    lib.dp_lookup_many.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_int32), ctypes.c_size_t,
+                                   ctypes.POINTER(Result)]
+    lib.dp_lookup_many.restype = ctypes.c_size_t
+    _lib = lib
+    return lib
+
+def available(bin_path, lib_path=None):
+    """True if both the shared library and the policy file exist."""
+    return Path(lib_path or LIB_PATH).exists() and Path(bin_path).exists()
+
+def index_100m(stage, rerolls, dice, set1_score=None):
+    lib = _load()
+    arr = (ctypes.c_int * 4)(*dice)
+    return lib.dp_index_100m(stage, rerolls, arr, 0 if set1_score is None else set1_score)
+
+def index_longjump(phase, sum_frozen, cnt):
+    """cnt: dict face -> count (faces 1..6)."""
+    lib = _load()
+    arr = (ctypes.c_int * 6)(*[cnt.get(i, 0) for i in range(1, 7)])
+    return lib.dp_index_longjump(phase, 0 if sum_frozen is None else sum_frozen, arr)
+
+
+class Policy:
+    def __init__(self, bin_path, lib_path=None):
+        self._lib = _load(lib_path)
+        self._h = self._lib.dp_open(str(bin_path).encode())
+        if not self._h:
+            raise RuntimeError(self._lib.dp_last_error().decode())
+
+    def close(self):
+        if self._h:
+            self._lib.dp_close(self._h)
+            self._h = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def __del__(self):
+        self.close()
+
+    @property
+    def event(self):
+        return self._lib.dp_event(self._h)
+
+    @property
+    def num_states(self):
+        return self._lib.dp_num_states(self._h)
+
+    def root_moments(self):
+        ev, sd = ctypes.c_double(), ctypes.c_double()
+        self._lib.dp_root_moments(self._h, ctypes.byref(ev), ctypes.byref(sd))
+        return ev.value, sd.value
+
+    def index_100m(self, stage, rerolls, dice, set1_score=None):
+        """State index in this policy (its reroll budget), -1 if out of range."""
+        arr = (ctypes.c_int * 4)(*dice)
+        return self._lib.dp_state_index_100m(self._h, stage, rerolls, arr, 0 if set1_score is None else set1_score)
+
+    def index_longjump(self, phase, sum_frozen, cnt):
+        """As index_100m, for the run-up limit; cnt: dict face -> count (faces 1..6)."""
+        arr = (ctypes.c_int * 6)(*[cnt.get(i, 0) for i in range(1, 7)])
+        return self._lib.dp_state_index_longjump(self._h, phase, 0 if sum_frozen is None else sum_frozen, arr)
+
+    def best_action(self, state):
+        """Best action code at a state index, or None if invalid/unreachable."""
+        a = self._lib.dp_best_action(self._h, state)
+        return None if a < 0 else a
+
+    def moments(self, state, action):
+        """(EV, SD) of taking `action` at `state`, or None if unavailable."""
+        ev, sd = ctypes.c_double(), ctypes.c_double()
+        if self._lib.dp_moments(self._h, state, action, ctypes.byref(ev), ctypes.byref(sd)) != 0:
+            return None
+        return ev.value, sd.value
+
+    def lookup_many(self, states):
+        """List of (action, ev, sd) per state index; action None if invalid."""
+        n = len(states)
+        idx = (ctypes.c_int32 * n)(*states)
+        out = (Result * n)()
+        self._lib.dp_lookup_many(self._h, idx, n, out)
+        res = []
+        for r in out:
+            if r.action < 0:
+                res.append((None, math.nan, math.nan))
+            else:
+                res.append((r.action, r.ev, r.sd))
+        return res
+
+
+class PolicyClient:
+    """Client for solvers/policy_server (wire format in policy_server.cpp)."""
+    MAGIC = 0x31515044            # "DPQ1"
+    OP_LOOKUP, OP_INFO = 1, 2
+
+    def __init__(self, socket_path):
+        self._sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self._sock.connect(str(socket_path))
+        self.generation = 0       # generation that answered the last lookup
+        self.rules_hash = 0
+
+    def close(self):
+        if self._sock:
+            self._sock.close()
+            self._sock = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def _recv(self, n):
+        buf = bytearray()
+        while len(buf) < n:
+            chunk = self._sock.recv(n - len(buf))
+            if not chunk:
+                raise ConnectionError("policy_server closed the connection")
+            buf += chunk
+        return bytes(buf)
+
+    def _call(self, op, event, payload=b"", n=0):
+        self._sock.sendall(struct.pack("<4I", self.MAGIC, op, event, n) + payload)
+        magic, status, generation, count, rules_hash = struct.unpack("<4IQ", self._recv(24))
+        if magic != self.MAGIC or status != 0:
+            raise RuntimeError(f"policy_server error {status}")
+        return generation, count, rules_hash
+
+    def info(self):
+        """One dict per served event: event, generation, num_states, rules_hash, ev, sd."""
+        _, count, _ = self._call(self.OP_INFO, 0)
+        keys = ("event", "generation", "num_states", "rules_hash", "ev", "sd")
+        return [dict(zip(keys, struct.unpack("<IIQQdd", self._recv(40)))) for _ in range(count)]
+
+    def lookup_many(self, event, states):
+        """Like Policy.lookup_many, answered from a single generation of the event's file."""
+        n = len(states)
+        self.generation, count, self.rules_hash = self._call(
+            self.OP_LOOKUP, event, struct.pack(f"<{n}i", *states), n)
+        res = []
+        for action, _, ev, sd in struct.iter_unpack("<iIdd", self._recv(24 * count)):
+            res.append((None, math.nan, math.nan) if action < 0 else (action, ev, sd))
+        return res
@@ -0,0 +1,290 @@
+// Arrow IPC file writer (the "Feather v2" format read by pyarrow.feather,
+// pandas.read_feather, polars.read_ipc, DuckDB, ...) for the dense solver
+// tables, with no Arrow library.
+//
+// The file holds one record batch of fixed-width, non-nullable columns:
+// integers, doubles, and fixed-size lists of doubles (the per-state PMFs).
+// Column buffers are written straight from the caller's arrays, each on a
+// 64-byte boundary, so a reader can mmap the file and use them in place.
+//
+// Layout (little-endian, Arrow columnar format, metadata version V5):
+//   "ARROW1\0\0"
+//   Schema message        0xFFFFFFFF, int32 length, flatbuffer Message, padding
+//   RecordBatch message   the same, then the body: every buffer, padded to 64
+//   Footer                flatbuffer (schema, block of the record batch), int32 length
+//   "ARROW1"
+// The flatbuffers are built by the small back-to-front builder below; only
+// the tables and fields listed in Schema.fbs/Message.fbs/File.fbs that this
+// writer needs are emitted. Files are written to "<path>.tmp" and renamed
+// into place, like policy files.
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace arrowipc {
+
+namespace fb {
+
+// Flatbuffer builder. The buffer grows towards the front; a reference to an
+// object is its distance from the end of the buffer, which stays fixed.
+class Builder {
+public:
+    using Ref = uint32_t;
+
+    uint32_t size() const { return uint32_t(buf_.size()); }
+
+    // Pad so that `len` more bytes leave the front aligned to `a`.
+    void pre_align(size_t len, size_t a){
+        while((buf_.size() + len) % a) buf_.insert(buf_.begin(), 0);
+    }
+
+    template<class T>
+    void push(T v){
+        pre_align(sizeof(T), sizeof(T));
+        uint8_t b[sizeof(T)];
+        memcpy(b, &v, sizeof(T));
+        buf_.insert(buf_.begin(), b, b + sizeof(T));
+    }
+    void push_ref(Ref r){
+        pre_align(4, 4);
+        push<uint32_t>(size() + 4 - r);      // forward, from the field to the object
+    }
+
+    Ref string(const std::string& s){
+        pre_align(s.size() + 1, 4);
+        buf_.insert(buf_.begin(), 0);
+        buf_.insert(buf_.begin(), s.begin(), s.end());
+        push<uint32_t>(uint32_t(s.size()));
+        return size();
+    }
+    Ref refs(const std::vector<Ref>& v){
+        pre_align(4*v.size(), 4);
+        for(size_t i=v.size(); i-- > 0; ) push_ref(v[i]);
+        push<uint32_t>(uint32_t(v.size()));
+        return size();
+    }
+    // Vector of structs made of int64 fields.
+    template<size_t N>
+    Ref structs(const std::vector<std::array<int64_t, N>>& v){
+        pre_align(8*N*v.size(), 8);
+        for(size_t i=v.size(); i-- > 0; )
+            for(size_t k=N; k-- > 0; ) push<int64_t>(v[i][k]);
+        push<uint32_t>(uint32_t(v.size()));
+        return size();
+    }
+
+    void start(){ fields_.clear(); table_start_ = size(); }
+    template<class T>
+    void field(int id, T v){ push<T>(v); fields_.push_back({id, size()}); }
+    void field_ref(int id, Ref r){ push_ref(r); fields_.push_back({id, size()}); }
+    Ref end(){
+        push<int32_t>(0);                                 // vtable offset, patched below
+        const uint32_t table = size();
+        int n = 0;
+        for(auto& f: fields_) n = std::max(n, f.id + 1);
+        std::vector<uint16_t> vt(2 + n, 0);
+        vt[0] = uint16_t(2*vt.size());
+        vt[1] = uint16_t(table - table_start_);
+        for(auto& f: fields_) vt[2 + f.id] = uint16_t(table - f.pos);
+        for(size_t i=vt.size(); i-- > 0; ) push<uint16_t>(vt[i]);
+        const int32_t soff = int32_t(size() - table);   // the vtable is just before the table
+        memcpy(&buf_[buf_.size() - table], &soff, 4);
+        return table;
+    }
+
+    // Root reference in front, total size a multiple of 8.
+    std::vector<uint8_t> finish(Ref root){
+        pre_align(4, 8);
+        push_ref(root);
+        return std::move(buf_);
+    }
+
+private:
+    struct Field { int id; uint32_t pos; };
+    std::vector<uint8_t> buf_;
+    std::vector<Field> fields_;
+    uint32_t table_start_ = 0;
+};
+
+} // namespace fb
+
+class Writer {
+public:
+    // The data is not copied; it must stay alive until write().
+    template<class T>
+    void add(std::string name, std::span<const T> data){
+        static_assert(std::is_integral_v<T> || std::is_same_v<T, double>, "arrowipc: unsupported column type");
+        check_rows(data.size());
+        cols_.push_back({std::move(name), std::is_same_v<T, double> ? FLOAT64 : INT, int(8*sizeof(T)),
+                         std::is_signed_v<T>, 0, data.data(), data.size_bytes()});
+    }
+    // A fixed_size_list<double>[size] column: row r is data[r*size, (r+1)*size).
+    void add_list(std::string name, std::span<const double> data, int size){
+        if(size <= 0 || data.size() % size) throw std::invalid_argument("arrowipc: list column of the wrong length");
+        check_rows(data.size() / size);
+        cols_.push_back({std::move(name), LIST, 64, true, size, data.data(), data.size_bytes()});
+    }
+    // Schema-level key/value metadata.
+    void set_meta(std::string key, std::string value){ meta_.emplace_back(std::move(key), std::move(value)); }
+
+    int64_t rows() const { return rows_ < 0 ? 0 : rows_; }
+
+    void write(const std::string& path) const {
+        // body: per column a zero-length validity buffer and the data (a list
+        // has its own validity buffer, then its child's two)
+        std::vector<std::array<int64_t,2>> nodes, buffers;
+        int64_t body = 0;
+        for(const Col& c: cols_){
+            nodes.push_back({rows(), 0});
+            buffers.push_back({body, 0});
+            if(c.kind == LIST){ nodes.push_back({rows()*c.list_size, 0}); buffers.push_back({body, 0}); }
+            buffers.push_back({body, int64_t(c.bytes)});
+            body = align(body + int64_t(c.bytes));
+        }
+
+        const std::vector<uint8_t> schema_msg = message(SCHEMA, 0, 8, [&](fb::Builder& b){ return schema(b); });
+        const int64_t batch_at = 8 + int64_t(schema_msg.size());
+        const std::vector<uint8_t> batch_msg = message(RECORD_BATCH, body, batch_at, [&](fb::Builder& b){
+            const auto nv = b.structs(nodes), bv = b.structs(buffers);
+            b.start();
+            b.field<int64_t>(0, rows());
+            b.field_ref(1, nv);
+            b.field_ref(2, bv);
+            return b.end();
+        });
+
+        std::string tmp = path + ".tmp";
+        FILE* f = fopen(tmp.c_str(), "wb");
+        if(!f) throw std::runtime_error("cannot create " + tmp);
+        static const char magic[8] = {'A','R','R','O','W','1',0,0};
+        bool ok = fwrite(magic, 1, 8, f)==8;
+        ok = ok && fwrite(schema_msg.data(), 1, schema_msg.size(), f)==schema_msg.size();
+        ok = ok && fwrite(batch_msg.data(), 1, batch_msg.size(), f)==batch_msg.size();
+        for(const Col& c: cols_){
+            ok = ok && fwrite(c.data, 1, c.bytes, f)==c.bytes;
+            ok = ok && pad(f, align(int64_t(c.bytes)) - int64_t(c.bytes));
+        }
+
+        fb::Builder b;
+        const auto sc = schema(b);
+        const auto blocks = b.structs(std::vector<std::array<int64_t,3>>{
+            {batch_at, int64_t(batch_msg.size()), body}});    // Block {offset, int32 metaDataLength + pad, bodyLength}
+        const auto none = b.structs(std::vector<std::array<int64_t,3>>{});
+        b.start();
+        b.field<int16_t>(0, V5);
+        b.field_ref(1, sc);
+        b.field_ref(2, none);
+        b.field_ref(3, blocks);
+        const std::vector<uint8_t> footer = b.finish(b.end());
+        const int32_t footer_len = int32_t(footer.size());
+        ok = ok && fwrite(footer.data(), 1, footer.size(), f)==footer.size();
+        ok = ok && fwrite(&footer_len, 4, 1, f)==1 && fwrite(magic, 1, 6, f)==6;
+        ok = (fclose(f)==0) && ok;
+        if(!ok || rename(tmp.c_str(), path.c_str())!=0){
+            remove(tmp.c_str());
+            throw std::runtime_error("failed writing Arrow file " + path);
+        }
+    }
+
+private:
+    enum Kind { INT, FLOAT64, LIST };
+    struct Col { std::string name; Kind kind; int bits; bool is_signed; int list_size; const void* data; size_t bytes; };
+
+    // Schema.fbs / Message.fbs constants
+    static constexpr int16_t V5 = 4;                                   // MetadataVersion
+    static constexpr uint8_t SCHEMA = 1, RECORD_BATCH = 3;             // MessageHeader
+    static constexpr uint8_t TYPE_INT = 2, TYPE_FLOAT = 3, TYPE_FIXED_SIZE_LIST = 16;   // Type
+    static constexpr int16_t DOUBLE = 2;                               // Precision
+
+    static int64_t align(int64_t x){ return (x + 63) & ~int64_t(63); }
+    static bool pad(FILE* f, int64_t n){
+        static const char zeros[64]{};
+        return n == 0 || fwrite(zeros, 1, size_t(n), f)==size_t(n);
+    }
+
+    void check_rows(size_t n){
+        if(rows_ >= 0 && int64_t(n) != rows_) throw std::invalid_argument("arrowipc: columns of different lengths");
+        rows_ = int64_t(n);
+    }
+
+    static fb::Builder::Ref type(fb::Builder& b, Kind k, int bits, bool is_signed){
+        b.start();
+        if(k == FLOAT64) b.field<int16_t>(0, DOUBLE);
+        else { b.field<int32_t>(0, bits); b.field<uint8_t>(1, is_signed); }
+        return b.end();
+    }
+    static fb::Builder::Ref field(fb::Builder& b, const std::string& name, uint8_t type_id, fb::Builder::Ref t,
+                                  const std::vector<fb::Builder::Ref>& children){
+        const auto nm = b.string(name), ch = b.refs(children);
+        b.start();
+        b.field_ref(0, nm);
+        b.field<uint8_t>(1, 0);                    // not nullable
+        b.field<uint8_t>(2, type_id);
+        b.field_ref(3, t);
+        b.field_ref(5, ch);
+        return b.end();
+    }
+
+    fb::Builder::Ref schema(fb::Builder& b) const {
+        std::vector<fb::Builder::Ref> fields, kvs;
+        for(const Col& c: cols_){
+            if(c.kind == LIST){
+                const auto item = field(b, "item", TYPE_FLOAT, type(b, FLOAT64, 64, true), {});
+                b.start();
+                b.field<int32_t>(0, c.list_size);
+                const auto t = b.end();
+                fields.push_back(field(b, c.name, TYPE_FIXED_SIZE_LIST, t, {item}));
+            } else
+                fields.push_back(field(b, c.name, c.kind == FLOAT64 ? TYPE_FLOAT : TYPE_INT,
+                                       type(b, c.kind, c.bits, c.is_signed), {}));
+        }
+        for(const auto& [k, v]: meta_){
+            const auto ks = b.string(k), vs = b.string(v);
+            b.start();
+            b.field_ref(0, ks);
+            b.field_ref(1, vs);
+            kvs.push_back(b.end());
+        }
+        const auto fv = b.refs(fields), mv = b.refs(kvs);
+        b.start();
+        b.field<int16_t>(0, 0);                    // little-endian
+        b.field_ref(1, fv);
+        b.field_ref(2, mv);
+        return b.end();
+    }
+
+    // Encapsulated message written at file offset `at`: continuation marker,
+    // length, flatbuffer, padded so that the body starts on a 64-byte boundary.
+    template<class Header>
+    static std::vector<uint8_t> message(uint8_t kind, int64_t body, int64_t at, Header&& header){
+        fb::Builder b;
+        const auto h = header(b);
+        b.start();
+        b.field<int16_t>(0, V5);
+        b.field<uint8_t>(1, kind);
+        b.field_ref(2, h);
+        b.field<int64_t>(3, body);
+        const std::vector<uint8_t> m = b.finish(b.end());
+        std::vector<uint8_t> out(size_t(align(at + 8 + int64_t(m.size())) - at));
+        memcpy(&out[0], "\xff\xff\xff\xff", 4);
+        memcpy(&out[8], m.data(), m.size());
+        const int32_t len = int32_t(out.size() - 8);
+        memcpy(&out[4], &len, 4);
+        return out;
+    }
+
+    std::vector<Col> cols_;
+    std::vector<std::pair<std::string, std::string>> meta_;
+    int64_t rows_ = -1;
+};
+
+} // namespace arrowipc
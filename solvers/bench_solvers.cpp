@@ -0,0 +1,312 @@
+// g++ -O3 -std=c++20 -pthread solvers/bench_solvers.cpp -lsqlite3 -o solvers/bench_solvers
+// Usage: ./bench_solvers [--repeat N] [--lookups N] [--dir DIR] [--json bench.json] [--bo3]
+//                        [--lazy-capacity NODES] [--threads N]
+//
+// Times each phase of every event solver separately and benchmarks random
+// policy lookups against both output formats. Prints one JSON document
+// (stdout, or --json FILE):
+//   events[]: name, states, enumerate_ms, solve_ms (moments and actions only),
+//             pmf_ms (extra cost of the score PMFs), db_write_ms, bin_write_ms, bin_bytes
+//   lookup_results[]: event, backend (sqlite | mmap), lookups_per_sec, p50_ns, p99_ns
+//   lazy_results[]: event, capacity, first_ms (empty cache to the first decision),
+//             lookups_per_sec (one thread, cache warming up), lookups_per_sec_mt
+//             (--threads on a fresh cache), hits, misses, evictions (of the
+//             single-thread pass), mismatches (decisions differing from the
+//             full solve; should be 0)
+// Phase times are the minimum over --repeat runs. Throughput is measured over
+// an untimed loop; latency percentiles time each lookup on its own, so they
+// include the clock overhead (tens of ns). Lookup states are drawn uniformly
+// from the reachable states. Outputs go to --dir (default /tmp).
+#include <bits/stdc++.h>
+#include "dp_engine.hpp"
+#include "event_100m.hpp"
+#include "event_longjump.hpp"
+#include "lazy_solver.hpp"
+#include "parallel.hpp"
+#include "policy_format.hpp"
+#include "sqlite_writer.hpp"
+#include "store_100m.hpp"
+#include "store_longjump.hpp"
+using namespace std;
+
+template<class T>
+static void keep(const T& v){ asm volatile("" : : "g"(&v) : "memory"); }
+
+template<class F>
+static double min_ms(int repeat, F&& f){
+    double best = 1e300;
+    for(int i=0; i<repeat; ++i){ par::Stopwatch c; f(); best = min(best, c.ms()); }
+    return best;
+}
+
+struct EventBench {
+    string name;
+    int states = 0;
+    double enumerate_ms = 0, solve_ms = 0, pmf_ms = 0, db_write_ms = 0, bin_write_ms = 0;
+    uint64_t bin_bytes = 0;
+};
+
+struct LookupBench { string event, backend; double per_sec = 0, p50_ns = 0, p99_ns = 0; };
+
+struct LazyBench {
+    string event;
+    size_t capacity = 0;
+    int threads = 1;
+    double first_ms = 0, per_sec = 0, per_sec_mt = 0;
+    dp::CacheStats cache;
+    int64_t mismatches = 0;
+};
+
+// Regenerating the outcome tables at run time: what the solvers would pay
+// per process without the compile-time tables.
+template<int... N>
+static double enumerate_ms(int repeat){
+    return min_ms(repeat, []{ ((keep(dice::make_outcomes<N>())), ...); });
+}
+
+template<class Event, class WriteDb>
+static EventBench bench_event(const string& name, const Event& ev, policy::Event id, double enum_ms,
+                              int repeat, const string& dir, WriteDb&& write_db, dp::Solver<Event>& out){
+    EventBench b{name, ev.n_states(), enum_ms};
+    b.solve_ms = min_ms(repeat, [&]{
+        dp::Solver<Event> s(ev); s.set_track_pmf(false); s.solve(); keep(s.root());
+    });
+    double full = min_ms(repeat, [&]{ dp::Solver<Event> s(ev); s.solve(); keep(s.root()); });
+    b.pmf_ms = max(0.0, full - b.solve_ms);
+    out.solve();
+    const string db_path = dir + "/bench_" + name + ".db", bin_path = dir + "/bench_" + name + ".bin";
+    b.db_write_ms = min_ms(repeat, [&]{
+        remove(db_path.c_str());
+        sqlw::Db db(db_path);
+        write_db(db, out);
+    });
+    if(id){
+        b.bin_write_ms = min_ms(repeat, [&]{ dp::write_policy_bin(out, id, bin_path); });
+        b.bin_bytes = filesystem::file_size(bin_path);
+    }
+    return b;
+}
+
+// Time n calls of lookup(i): throughput from an untimed pass, percentiles
+// from a pass timing every call.
+template<class F>
+static LookupBench bench_lookups(const string& event, const string& backend, int n, F&& lookup){
+    LookupBench r{event, backend};
+    int64_t sink = 0;
+    par::Stopwatch c;
+    for(int i=0; i<n; ++i) sink += lookup(i);
+    r.per_sec = n / (c.ms() / 1e3);
+    vector<double> ns(n);
+    for(int i=0; i<n; ++i){
+        auto t0 = chrono::steady_clock::now();
+        sink += lookup(i);
+        ns[i] = chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count();
+    }
+    keep(sink);
+    sort(ns.begin(), ns.end());
+    r.p50_ns = ns[n/2];
+    r.p99_ns = ns[min(n-1, int(n*0.99))];
+    return r;
+}
+
+// Prepared single-row SELECT; lookup binds ints and returns the first column.
+class Query {
+public:
+    Query(sqlw::Db& db, const string& sql) : st_(db.prepare(sql)) {}
+    ~Query(){ sqlite3_finalize(st_); }
+    int64_t run(initializer_list<int> args){
+        int p = 1;
+        for(int a: args) sqlite3_bind_int(st_, p++, a);
+        int64_t v = sqlite3_step(st_)==SQLITE_ROW ? sqlite3_column_int64(st_, 0) : -1;
+        sqlite3_reset(st_);
+        return v;
+    }
+private:
+    sqlite3_stmt* st_;
+};
+
+static void lookups_100m(const dp::Solver<events::M100>& solver, const string& dir, int n, mt19937_64& rng,
+                         vector<LookupBench>& out){
+    const events::M100& ev = solver.event();
+    struct Key { int stage, rerolls, dice[4], set1; };
+    vector<Key> keys(n);
+    for(Key& k: keys){
+        events::M100::State s = ev.state_at(int(rng() % ev.n_states()));
+        k = {s.stage, s.rerolls, {}, s.set1_score};
+        for(int i=0; i<4; ++i) k.dice[i] = dice::OUTCOMES<4>[s.pat].dice[i];
+        shuffle(k.dice, k.dice+4, rng);               // callers pass dice unsorted
+    }
+    sqlw::Db db(dir + "/bench_100m.db");
+    Query q(db, "SELECT best FROM states100m WHERE stage=? AND rerolls=? AND d1=? AND d2=? AND d3=? AND d4=?"
+                " AND set1_score=?;");
+    out.push_back(bench_lookups("100m", "sqlite", n, [&](int i){
+        Key k = keys[i];
+        sort(k.dice, k.dice+4);                        // rows store sorted dice
+        return q.run({k.stage, k.rerolls, k.dice[0], k.dice[1], k.dice[2], k.dice[3], k.stage==1 ? 0 : k.set1});
+    }));
+    policy::File f(dir + "/bench_100m.bin");
+    auto act = f.section<uint8_t>(policy::SEC_ACTION);
+    auto evf = f.section<double>(policy::ev_section(0));
+    out.push_back(bench_lookups("100m", "mmap", n, [&](int i){
+        const Key& k = keys[i];
+        int s = policy::m100::index(k.stage, k.rerolls, k.dice, k.set1);
+        return int64_t(act[s]) + int64_t(evf[s]);
+    }));
+}
+
+static void lookups_longjump(const dp::Solver<events::LongJump>& solver, const string& dir, int n, mt19937_64& rng,
+                             vector<LookupBench>& out){
+    const events::LongJump& ev = solver.event();
+    vector<int> reach;
+    for(int s=0; s<ev.n_states(); ++s) if(solver.action(s)!=dp::NO_ACTION) reach.push_back(s);
+    struct Key { int phase, sum, count[7]; };
+    vector<Key> keys(n);
+    for(Key& k: keys){
+        events::LongJump::Post p = ev.post_at(reach[rng() % reach.size()]);
+        k = {p.phase, p.sum_frozen, {}};
+        for(int f=1; f<=6; ++f) k.count[f] = events::lj::COUNTS_AT[p.counts][f];
+    }
+    sqlw::Db db(dir + "/bench_longjump.db");
+    Query q(db, "SELECT freeze_count FROM lj_post_simple WHERE phase=? AND sum_frozen=? AND n1=? AND n2=?"
+                " AND n3=? AND n4=? AND n5=? AND n6=?;");
+    out.push_back(bench_lookups("longjump", "sqlite", n, [&](int i){
+        const Key& k = keys[i];
+        return q.run({k.phase, k.sum, k.count[1], k.count[2], k.count[3], k.count[4], k.count[5], k.count[6]});
+    }));
+    policy::File f(dir + "/bench_longjump.bin");
+    auto act = f.section<uint8_t>(policy::SEC_ACTION);
+    out.push_back(bench_lookups("longjump", "mmap", n, [&](int i){
+        const Key& k = keys[i];
+        return int64_t(act[policy::longjump::index(k.phase, k.sum, k.count)]);
+    }));
+}
+
+// dp::LazySolver answering n decisions at reachable states of the full solve.
+template<class Event>
+static LazyBench bench_lazy(const string& name, const dp::Solver<Event>& full, int n, size_t capacity, int threads,
+                            mt19937_64& rng){
+    const Event& ev = full.event();
+    vector<int> reach, keys(n);
+    for(int s=0; s<ev.n_states(); ++s) if(full.action(s)!=dp::NO_ACTION) reach.push_back(s);
+    for(int& k: keys) k = reach[rng() % reach.size()];
+
+    LazyBench b;
+    b.event = name; b.capacity = capacity; b.threads = threads;
+    dp::LazySolver<Event> lazy(ev, capacity);
+    par::Stopwatch first;
+    keep(lazy.decide_state(keys[0]));
+    b.first_ms = first.ms();
+    par::Stopwatch warm;
+    for(int s: keys){
+        const auto d = lazy.decide_state(s);
+        bool same = d.action == full.action(s);
+        if constexpr(Event::ACTION_MOMENTS){
+            const dp::Moments m = full.action_moments(s, d.action);
+            same = same && m.ev == d.m.ev && m.ev2 == d.m.ev2;
+        }
+        b.mismatches += !same;
+    }
+    b.per_sec = n / (warm.ms() / 1e3);
+    b.cache = lazy.cache_stats();
+
+    dp::LazySolver<Event> shared(ev, capacity);
+    par::Stopwatch mt;
+    par::parallel_for(n, threads, [&](int i){ keep(shared.decide_state(keys[i])); });
+    b.per_sec_mt = n / (mt.ms() / 1e3);
+    return b;
+}
+
+static string to_json(const vector<EventBench>& evs, const vector<LookupBench>& lks, const vector<LazyBench>& lzs,
+                      int repeat, int lookups){
+    string j = "{\n  \"repeat\": " + to_string(repeat) + ",\n  \"lookups\": " + to_string(lookups) + ",\n";
+    char buf[512];
+    j += "  \"events\": [\n";
+    for(size_t i=0; i<evs.size(); ++i){
+        const EventBench& e = evs[i];
+        snprintf(buf, sizeof buf,
+            "    {\"name\": \"%s\", \"states\": %d, \"enumerate_ms\": %.4f, \"solve_ms\": %.4f, \"pmf_ms\": %.4f,"
+            " \"db_write_ms\": %.3f, \"bin_write_ms\": %.3f, \"bin_bytes\": %llu}%s\n",
+            e.name.c_str(), e.states, e.enumerate_ms, e.solve_ms, e.pmf_ms, e.db_write_ms, e.bin_write_ms,
+            (unsigned long long)e.bin_bytes, i+1<evs.size() ? "," : "");
+        j += buf;
+    }
+    j += "  ],\n  \"lookup_results\": [\n";
+    for(size_t i=0; i<lks.size(); ++i){
+        const LookupBench& l = lks[i];
+        snprintf(buf, sizeof buf,
+            "    {\"event\": \"%s\", \"backend\": \"%s\", \"lookups_per_sec\": %.0f, \"p50_ns\": %.0f, \"p99_ns\": %.0f}%s\n",
+            l.event.c_str(), l.backend.c_str(), l.per_sec, l.p50_ns, l.p99_ns, i+1<lks.size() ? "," : "");
+        j += buf;
+    }
+    j += "  ],\n  \"lazy_results\": [\n";
+    for(size_t i=0; i<lzs.size(); ++i){
+        const LazyBench& l = lzs[i];
+        snprintf(buf, sizeof buf,
+            "    {\"event\": \"%s\", \"capacity\": %llu, \"first_ms\": %.4f, \"lookups_per_sec\": %.0f,"
+            " \"lookups_per_sec_mt\": %.0f, \"threads\": %d, \"hits\": %llu, \"misses\": %llu,"
+            " \"evictions\": %llu, \"mismatches\": %lld}%s\n",
+            l.event.c_str(), (unsigned long long)l.cache.capacity, l.first_ms, l.per_sec, l.per_sec_mt, l.threads,
+            (unsigned long long)l.cache.hits, (unsigned long long)l.cache.misses,
+            (unsigned long long)l.cache.evictions, (long long)l.mismatches, i+1<lzs.size() ? "," : "");
+        j += buf;
+    }
+    return j + "  ]\n}\n";
+}
+
+int main(int argc, char** argv){
+    int repeat = 5, lookups = 200000, threads = 0;
+    size_t lazy_capacity = 4096;  // chance nodes
+    string dir = "/tmp", json_path;
+    bool bo3 = false;
+    for(int i=1; i<argc; ++i){
+        string a = argv[i];
+        if(a=="--repeat" && i+1<argc) repeat = max(1, atoi(argv[++i]));
+        else if(a=="--lookups" && i+1<argc) lookups = max(1, atoi(argv[++i]));
+        else if(a=="--dir" && i+1<argc) dir = argv[++i];
+        else if(a=="--json" && i+1<argc) json_path = argv[++i];
+        else if(a=="--bo3") bo3 = true;
+        else if(a=="--lazy-capacity" && i+1<argc) lazy_capacity = max(1, atoi(argv[++i]));
+        else if(a=="--threads" && i+1<argc) threads = atoi(argv[++i]);
+        else { fprintf(stderr,"unknown option %s\n", a.c_str()); return 1; }
+    }
+
+    if(threads<=0) threads = par::hardware_threads();
+
+    try {
+        vector<EventBench> evs;
+        vector<LookupBench> lks;
+        vector<LazyBench> lzs;
+        mt19937_64 rng(12345);
+
+        dp::Solver<events::M100> m100;
+        evs.push_back(bench_event("100m", events::M100{}, policy::EVENT_100M, enumerate_ms<4>(repeat), repeat, dir,
+            [](sqlw::Db& db, const auto& s){ store::write_100m(db, s); }, m100));
+        lookups_100m(m100, dir, lookups, rng, lks);
+        lzs.push_back(bench_lazy("100m", m100, lookups, lazy_capacity, threads, rng));
+
+        dp::Solver<events::LongJump> lj;
+        const double lj_enum = enumerate_ms<1,2,3,4,5>(repeat);
+        evs.push_back(bench_event("longjump", events::LongJump{}, policy::EVENT_LONGJUMP, lj_enum, repeat, dir,
+            [](sqlw::Db& db, const auto& s){ store::write_longjump(db, s); }, lj));
+        lookups_longjump(lj, dir, lookups, rng, lks);
+        lzs.push_back(bench_lazy("longjump", lj, lookups, lazy_capacity, threads, rng));
+
+        if(bo3){
+            dp::Solver<events::LongJumpBo3> b3;
+            evs.push_back(bench_event("longjump_bo3", events::LongJumpBo3{}, policy::Event(0), lj_enum, repeat, dir,
+                [](sqlw::Db& db, const auto& s){ store::write_longjump_bo3(db, s); }, b3));
+            lzs.push_back(bench_lazy("longjump_bo3", b3, lookups, lazy_capacity, threads, rng));
+        }
+
+        string j = to_json(evs, lks, lzs, repeat, lookups);
+        if(json_path.empty()) fputs(j.c_str(), stdout);
+        else {
+            ofstream(json_path) << j;
+            fprintf(stderr,"Wrote %s\n", json_path.c_str());
+        }
+    } catch(const exception& e){
+        fprintf(stderr,"%s\n", e.what());
+        return 2;
+    }
+    return 0;
+}
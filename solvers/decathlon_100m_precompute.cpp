@@ -1,198 +1,164 @@
-// g++ -O3 -std=c++20 solvers/decathlon_100m_precompute.cpp -lsqlite3 -o solvers/100m_precompute
+// g++ -O3 -std=c++20 -pthread solvers/decathlon_100m_precompute.cpp -lsqlite3 -o solvers/100m_precompute
+// Usage: ./100m_precompute [100m_policy.db] [--threads N] [--policy-bin 100m_policy.bin] [--compact]
+//                          [--arrow 100m_states.arrow] [--arrow-pmf]
+//                          [--sql-batch ROWS] [--max-rerolls R] [--objective ev|maxprob:T|meanvar:L]
+//                          [--full-table] [--force] [--stats]
+//
+// Solves the 100m (events::M100, event_100m.hpp) with dp::Solver and writes
+// every decision state with the moments of both actions.
+//
+// --objective picks what the policy maximizes (dp::Objective): the expected
+// score (default), P(score >= T), or E - L*Var. The stored actions, moments
+// and pmf100m are those of that policy. Whatever the objective, reach100m
+// holds the best achievable P(score >= T) for every T, from one pass.
+//
+// Under ev, stage 2 is solved once per (rerolls, dice) with events::M100Offset
+// and shifted by set1_score; states100m still gets every row, and the binary
+// policy stores the folded table (FLAG_SET1_OFFSET), looked up with the same
+// indices. --full-table solves and stores every set1_score instead, as the
+// other objectives must.
+//
+// --arrow also writes the states as an Arrow IPC file (store_arrow.hpp), for
+// dataframes; --arrow-pmf adds each state's score PMF under the policy. It is
+// rewritten whenever it is asked for.
+//
+// --compact writes the binary policy bit-packed (1 bit a state) with the
+// chosen action's EV/SD as 16-bit fixed point, within 1/512 (policy::COMPACT).
+//
+// Outputs record the rule fingerprint they were solved for (solver_rules in
+// the DB, rules_hash in the binary header). An output that already matches
+// is left alone, and if only max_rerolls changed, states100m keeps the rows
+// for rerolls <= min(old, new): a state with r rerolls left does not depend
+// on the budget it started from (except under meanvar, whose anchor is the
+// root EV). --force rewrites everything. The objective is part of the
+// fingerprint unless it is ev.
+//
+// --stats prints the solver's counters (dp::Stats: chance nodes and states
+// visited, edges, memo hits, PMF adds, table bytes, phase times).
 #include <bits/stdc++.h>
-#include <sqlite3.h>
+#include "dp_engine.hpp"
+#include "event_100m.hpp"
+#include "parallel.hpp"
+#include "sqlite_writer.hpp"
+#include "store_100m.hpp"
+#include "store_arrow.hpp"
 using namespace std;
 
-static const int SIDES[6] = {1,2,3,4,5,6};
-static vector<array<int,4>> FOUR_OUTS;
-
-inline int score_set(const array<int,4>& d){
-    int s=0; for(int v: d) s += (v==6 ? -6 : v); return s;
-}
-
-struct State {
-    int stage;            // 1 or 2
-    int rerolls;          // 0..5
-    array<int,4> dice;    // sorted
-    int set1_score;       // use 7777 as "NULL" for stage 1
-    bool operator==(State const& o) const {
-        return stage==o.stage && rerolls==o.rerolls && dice==o.dice && set1_score==o.set1_score;
-    }
-};
-
-struct StateHash {
-    size_t operator()(State const& s) const noexcept {
-        size_t h = s.stage*1315423911u + s.rerolls*2654435761u + (unsigned)s.set1_score*97531u;
-        for(int v: s.dice) h = h*131u + v;
-        return h;
-    }
-};
-
-struct Moments { double ev=0, ev2=0; };
-struct SolveRes {
-    Moments best;
-    Moments freeze_m;
-    optional<Moments> reroll_m; // empty if rerolls=0
-    string best_action;         // "freeze" or "reroll"
-};
-
-unordered_map<State,SolveRes,StateHash> memo;
-
-static inline Moments combine_avg(const vector<Moments>& ms){
-    double ev=0, ev2=0; double w=1.0/ms.size();
-    for(auto& m: ms){ ev+=w*m.ev; ev2+=w*m.ev2; }
-    return {ev, ev2};
+using M100 = events::M100;
+
+template<class Event>
+static void report_objective(const dp::Solver<Event>& solver){
+    const dp::Objective& o = solver.objective();
+    const auto& root = solver.root();
+    if(o.kind == dp::Objective::MAXPROB){
+        int t = int(o.param);
+        double p = 0;
+        for(int x=max(t, M100::Score::MIN); x<=M100::Score::MAX; ++x) p += root.pmf[x];
+        fprintf(stderr,"%s: P(score >= %d) = %.6f\n", o.text().c_str(), t, p);
+    } else
+        fprintf(stderr,"%s: E - L*Var = %.6f after %d pass(es)\n", o.text().c_str(),
+                root.m.ev - o.param*root.m.sd()*root.m.sd(), solver.objective_iterations());
 }
 
-SolveRes solve_state(const State& s){
-    auto it = memo.find(s);
-    if(it!=memo.end()) return it->second;
-
-    // --- Freeze moments
-    Moments freeze_m;
-    if(s.stage==2){
-        int total = s.set1_score + score_set(s.dice);
-        freeze_m = {double(total), double(total)*double(total)};
-    } else {
-        int s1 = score_set(s.dice);
-        vector<Moments> kids; kids.reserve(FOUR_OUTS.size());
-        for(auto r: FOUR_OUTS){
-            sort(r.begin(), r.end());
-            SolveRes child = solve_state({2, s.rerolls, r, s1});
-            kids.push_back(child.best);
+int main(int argc, char** argv){
+    string path = "100m_policy.db";
+    string bin_path;           // optional mmap-able policy file
+    string arrow_path;         // optional Arrow IPC export
+    bool arrow_pmf = false;    // with a per-state PMF column
+    int sql_batch = 256;       // rows per multi-row INSERT (1 = one row per statement)
+    int threads = 1;           // --threads 0 = one per hardware thread
+    bool report = false;       // per-layer wall times, on with --threads
+    bool force = false;        // regenerate even if the outputs match the rules
+    bool stats = false;        // print dp::Stats after the solve
+    bool compact = false;      // --policy-bin in the compact encoding
+    bool full_table = false;   // no stage-2 folding under ev
+    M100::Rules rules;
+    dp::Objective objective;
+    for(int i=1; i<argc; ++i){
+        string a = argv[i];
+        if(a=="--threads" && i+1<argc){ threads = atoi(argv[++i]); report = true; }
+        else if(a=="--policy-bin" && i+1<argc) bin_path = argv[++i];
+        else if(a=="--arrow" && i+1<argc) arrow_path = argv[++i];
+        else if(a=="--arrow-pmf") arrow_pmf = true;
+        else if(a=="--sql-batch" && i+1<argc) sql_batch = atoi(argv[++i]);
+        else if(a=="--max-rerolls" && i+1<argc) rules.max_rerolls = atoi(argv[++i]);
+        else if(a=="--objective" && i+1<argc){
+            try { objective = dp::Objective::parse(argv[++i]); }
+            catch(const exception& e){ fprintf(stderr,"%s\n", e.what()); return 1; }
         }
-        freeze_m = combine_avg(kids);
+        else if(a=="--compact") compact = true;
+        else if(a=="--full-table") full_table = true;
+        else if(a=="--force") force = true;
+        else if(a=="--stats") stats = true;
+        else if(a.rfind("--",0)==0){ fprintf(stderr,"unknown option %s\n", a.c_str()); return 1; }
+        else path = a;
     }
-
-    // --- Reroll moments (if any rerolls left)
-    optional<Moments> reroll_m;
-    if(s.rerolls>0){
-        vector<Moments> kids; kids.reserve(FOUR_OUTS.size());
-        for(auto r: FOUR_OUTS){
-            sort(r.begin(), r.end());
-            SolveRes child = solve_state({s.stage, s.rerolls-1, r, s.set1_score});
-            kids.push_back(child.best);
+    if(threads<=0) threads = par::hardware_threads();
+
+    try {
+        const M100 event(rules);
+        const rules::Fingerprint fp = dp::fingerprint(event, objective);
+        const policy::Encoding encoding = compact ? policy::COMPACT : policy::FULL;
+        const bool folded = objective.is_ev() && !full_table;
+        const uint32_t layout = folded ? events::M100Offset::POLICY_FLAGS : 0;
+
+        sqlw::Db db(path);
+        const optional<string> stored = sqlw::read_rules(db, fp.output());
+        const bool db_current = !force && stored == fp.text();
+        const bool bin_current = bin_path.empty() ||
+                                 (!force && policy::stored_rules_hash(bin_path, encoding, layout) == fp.hash());
+        if(db_current && bin_current && arrow_path.empty()){
+            fprintf(stderr,"%s is up to date (rules %s), nothing to do\n", path.c_str(), fp.hex().c_str());
+            return 0;
         }
-        reroll_m = combine_avg(kids);
+        // a different reroll budget only adds or removes states with more rerolls left
+        int keep = -1;
+        if(!force && stored && objective.kind != dp::Objective::MEANVAR &&
+           rules::Fingerprint::same_except(*stored, fp.text(), "max_rerolls") && db.has_table("states100m"))
+            keep = min(stoi(*rules::Fingerprint::value(*stored, "max_rerolls")), rules.max_rerolls);
+
+        // M100 or M100Offset, same outputs
+        auto run = [&](const auto& solved){
+            dp::Solver<remove_cvref_t<decltype(solved)>> solver(solved);
+            solver.set_objective(objective);
+            solver.set_track_reach(true);
+            par::Stopwatch solve_clock;
+            solver.solve(threads, [&](int l, double ms){
+                if(report) fprintf(stderr,"layer stage=%d rerolls=%d: %.3f ms\n",
+                                   solved.layer_stage(l), solved.layer_rerolls(l), ms);
+            });
+            if(report) fprintf(stderr,"solve: %.3f ms on %d thread(s)\n", solve_clock.ms(), threads);
+            if(stats) dp::print_stats(stderr, "100m", solver.stats());
+            if(!objective.is_ev()) report_objective(solver);
+
+            const auto& root = solver.root();
+            if(fabs(root.pmf.mass() - 1) > 1e-9 || fabs(root.pmf.mean() - root.m.ev) > 1e-9)
+                fprintf(stderr,"warning: score PMF disagrees with the moments (mass=%.12f, mean=%.12f)\n",
+                        root.pmf.mass(), root.pmf.mean());
+
+            if(!bin_current){
+                dp::write_policy_bin(solver, policy::EVENT_100M, bin_path, fp.hash(), encoding);
+                fprintf(stderr,"Wrote %sbinary policy to %s (%llu bytes)\n", compact ? "compact " : "", bin_path.c_str(),
+                        (unsigned long long)filesystem::file_size(bin_path));
+            }
+            if(!arrow_path.empty()){
+                store::write_100m_arrow(solver, arrow_path, arrow_pmf);
+                fprintf(stderr,"Wrote Arrow table to %s (%llu bytes)\n", arrow_path.c_str(),
+                        (unsigned long long)filesystem::file_size(arrow_path));
+            }
+            if(!db_current){
+                int64_t rows = store::write_100m(db, solver, keep, sql_batch);
+                if(keep >= 0)
+                    fprintf(stderr,"Kept states100m rows with rerolls <= %d, wrote %lld new rows\n", keep, (long long)rows);
+                fprintf(stderr,"Wrote %d states to %s (EV=%.6f, SD=%.6f)\n", event.n_states(), path.c_str(),
+                        root.m.ev, root.m.sd());
+            }
+        };
+        if(folded) run(events::M100Offset(rules));
+        else run(event);
+    } catch(const exception& e){
+        fprintf(stderr,"%s\n", e.what());
+        return 2;
     }
-
-    // choose best by EV (tie → lower SD → prefer freeze)
-    auto sd = [](Moments m){ double var=max(0.0, m.ev2 - m.ev*m.ev); return sqrt(var); };
-    string best_action="freeze"; Moments best = freeze_m;
-    if(reroll_m){
-        double sd_f = sd(freeze_m), sd_r = sd(*reroll_m);
-        if ( (reroll_m->ev > freeze_m.ev) ||
-             (fabs(reroll_m->ev - freeze_m.ev) < 1e-12 && sd_r < sd_f) )
-        { best = *reroll_m; best_action="reroll"; }
-    }
-
-    SolveRes res{best, freeze_m, reroll_m, best_action};
-    memo.emplace(s, res);
-    return res;
-}
-
-static void ensure_four_outs(){
-    if(!FOUR_OUTS.empty()) return;
-    FOUR_OUTS.reserve(1296);
-    for(int a: SIDES) for(int b: SIDES) for(int c: SIDES) for(int d: SIDES){
-        array<int,4> t{a,b,c,d}; sort(t.begin(), t.end()); FOUR_OUTS.push_back(t);
-    }
-    // dedup to 126 patterns
-    sort(FOUR_OUTS.begin(), FOUR_OUTS.end());
-    FOUR_OUTS.erase(unique(FOUR_OUTS.begin(), FOUR_OUTS.end()), FOUR_OUTS.end());
-}
-
-static void sql_exec(sqlite3* db, const char* sql){
-    char* err=nullptr;
-    if(sqlite3_exec(db, sql, nullptr, nullptr, &err)!=SQLITE_OK){
-        string msg = err?err:"(unknown sqlite error)";
-        sqlite3_free(err);
-        throw runtime_error("sqlite error: " + msg);
-    }
-}
-
-int main(int argc, char** argv){
-    ensure_four_outs();
-    // pre-warm recursion by solving everything
-    // enumerate all states
-    vector<State> all;
-    all.reserve(50000);
-
-    // stage 1
-    for(int r=0;r<=5;r++)
-        for(auto d: FOUR_OUTS)
-            all.push_back({1,r,d,7777}); // 7777 sentinel = NULL
-
-    // stage 2
-    for(int r=0;r<=5;r++)
-        for(auto d: FOUR_OUTS)
-            for(int s1=-24; s1<=20; ++s1)
-                all.push_back({2,r,d,s1});
-
-    // Solve all (memoized recursion – super fast)
-    for(auto& s: all) solve_state(s);
-
-    // open DB
-    string path = (argc>=2? argv[1] : "100m_policy.db");
-    sqlite3* db=nullptr;
-    if(sqlite3_open(path.c_str(), &db)!=SQLITE_OK) throw runtime_error("sqlite open failed");
-
-    sql_exec(db, "PRAGMA journal_mode=OFF;");
-    sql_exec(db, "PRAGMA synchronous=OFF;");
-    sql_exec(db, "DROP TABLE IF EXISTS states100m;");
-    sql_exec(db,
-        "CREATE TABLE states100m ("
-        " stage INTEGER NOT NULL,"
-        " rerolls INTEGER NOT NULL,"
-        " d1 INTEGER NOT NULL, d2 INTEGER NOT NULL, d3 INTEGER NOT NULL, d4 INTEGER NOT NULL,"
-        " set1_score INTEGER,"    // NULL for stage 1
-        " ev_freeze REAL NOT NULL, sd_freeze REAL NOT NULL,"
-        " ev_reroll REAL, sd_reroll REAL,"
-        " best TEXT NOT NULL,"
-        " PRIMARY KEY (stage,rerolls,d1,d2,d3,d4,set1_score)"
-        ");"
-    );
-
-    sqlite3_stmt* ins=nullptr;
-    string q = "INSERT INTO states100m "
-               "(stage,rerolls,d1,d2,d3,d4,set1_score,ev_freeze,sd_freeze,ev_reroll,sd_reroll,best) "
-               "VALUES (?,?,?,?,?,?,?,?,?,?,?,?);";
-    if(sqlite3_prepare_v2(db, q.c_str(), -1, &ins, nullptr)!=SQLITE_OK) throw runtime_error("prepare failed");
-
-    auto sd = [](Moments m){ double var=max(0.0, m.ev2 - m.ev*m.ev); return sqrt(var); };
-    sql_exec(db, "BEGIN;");
-    for(auto& kv : memo){
-        const State& s = kv.first;
-        const SolveRes& r = kv.second;
-        sqlite3_reset(ins);
-        sqlite3_bind_int  (ins, 1, s.stage);
-        sqlite3_bind_int  (ins, 2, s.rerolls);
-        sqlite3_bind_int  (ins, 3, s.dice[0]);
-        sqlite3_bind_int  (ins, 4, s.dice[1]);
-        sqlite3_bind_int  (ins, 5, s.dice[2]);
-        sqlite3_bind_int  (ins, 6, s.dice[3]);
-        if(s.stage==1) sqlite3_bind_null(ins, 7);
-        else           sqlite3_bind_int (ins, 7, s.set1_score);
-
-        sqlite3_bind_double(ins, 8, r.freeze_m.ev);
-        sqlite3_bind_double(ins, 9, sd(r.freeze_m));
-
-        if(r.reroll_m){
-            sqlite3_bind_double(ins,10, r.reroll_m->ev);
-            sqlite3_bind_double(ins,11, sd(*r.reroll_m));
-        }else{
-            sqlite3_bind_null  (ins,10);
-            sqlite3_bind_null  (ins,11);
-        }
-        sqlite3_bind_text  (ins,12, r.best_action.c_str(), -1, SQLITE_TRANSIENT);
-
-        if(sqlite3_step(ins)!=SQLITE_DONE) throw runtime_error("insert failed");
-    }
-    sql_exec(db, "COMMIT;");
-    sqlite3_finalize(ins);
-    sql_exec(db, "CREATE INDEX IF NOT EXISTS idx_states100m ON states100m(stage,rerolls,d1,d2,d3,d4,set1_score);");
-    sqlite3_close(db);
-
-    cerr << "Wrote " << memo.size() << " states to " << path << "\n";
     return 0;
 }
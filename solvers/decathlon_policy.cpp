@@ -0,0 +1,154 @@
+// g++ -O3 -std=c++20 -shared -fPIC solvers/decathlon_policy.cpp -o solvers/libdecathlon_policy.so
+//
+// C ABI over policy::File (see decathlon_policy.h). Section spans are resolved
+// once at open, so each lookup is a bounds check plus array reads. Compact
+// files decode their packed actions and quantized moments on the fly; they
+// only have moments for the stored action. In 100m files with
+// FLAG_SET1_OFFSET, stage-2 indices are folded onto the stored (rerolls,
+// dice) row and set1_score is added to its EV. dp_state_index_* lay the
+// index out for the reroll budget or run-up limit of the opened file
+// (policy::layout_param); dp_index_* assume the standard rules.
+
+#include "decathlon_policy.h"
+#include "policy_format.hpp"
+
+#include <cmath>
+#include <exception>
+#include <string>
+
+namespace {
+
+constexpr int MAX_ACTIONS = 8;   // action codes with per-action moment sections
+
+thread_local std::string last_error;
+
+} // namespace
+
+struct dp_policy {
+    policy::File file;
+    policy::ActionCodes action;
+    std::span<const double> ev[MAX_ACTIONS], sd[MAX_ACTIONS];
+    std::span<const int16_t> ev_q, sd_q;    // compact files: the stored action's moments
+    uint64_t n_index;                       // valid state indices
+    int64_t n_stage1 = -1;                  // FLAG_SET1_OFFSET files: stage-2 indices fold above this
+    int layout;                             // max_rerolls (100m) or max_runup (long jump) of the index
+
+    explicit dp_policy(const char* path)
+        : file(path), n_index(file.n_states()), layout(policy::layout_param(file.header())) {
+        if(layout < 0) throw std::runtime_error("policy file has an unknown state layout");
+        action = file.actions();
+        if(action.size()!=file.n_states()) throw std::runtime_error("policy file has no action section");
+        if(file.header().flags & policy::FLAG_SET1_OFFSET){
+            if(file.event()!=policy::EVENT_100M || file.n_states()%2) throw std::runtime_error("bad folded policy layout");
+            n_stage1 = int64_t(file.n_states() / 2);
+            n_index = uint64_t(n_stage1) * (1 + policy::m100::N_S1);
+        }
+        ev_q = file.section<int16_t>(policy::SEC_EV_Q);
+        sd_q = file.section<int16_t>(policy::SEC_SD_Q);
+        if(ev_q.size()!=sd_q.size() || (!ev_q.empty() && ev_q.size()!=file.n_states()))
+            throw std::runtime_error("policy file has inconsistent moment sections");
+        for(int a=0; a<MAX_ACTIONS; ++a){
+            ev[a] = file.section<double>(policy::ev_section(a));
+            sd[a] = file.section<double>(policy::sd_section(a));
+            if(ev[a].size()!=sd[a].size() || (!ev[a].empty() && ev[a].size()!=file.n_states()))
+                throw std::runtime_error("policy file has inconsistent moment sections");
+        }
+    }
+
+    bool valid(int32_t s) const { return s>=0 && uint64_t(s)<n_index; }
+
+    // State index -> row in the file and the score to add to its EV.
+    policy::m100::Stored row(int32_t s) const {
+        return n_stage1 < 0 ? policy::m100::Stored{s, 0} : policy::m100::stored_index(s, n_stage1);
+    }
+
+    int32_t best(int32_t s) const {
+        if(!valid(s)) return -1;
+        uint8_t a = action[row(s).index];
+        return (file.event()==policy::EVENT_LONGJUMP && a==policy::longjump::NO_ACTION) ? -1 : a;
+    }
+
+    bool moments(int32_t s, int32_t a, double* e, double* d) const {
+        if(!valid(s)) return false;
+        const auto [i, offset] = row(s);
+        if(!ev_q.empty()){
+            if(a!=best(s) || ev_q[i]==policy::Q_NAN) return false;
+            if(e) *e = policy::dequantize(ev_q[i]) + offset;
+            if(d) *d = policy::dequantize(sd_q[i]);
+            return true;
+        }
+        if(a<0 || a>=MAX_ACTIONS || ev[a].empty() || std::isnan(ev[a][i])) return false;
+        if(e) *e = ev[a][i] + offset;
+        if(d) *d = sd[a][i];
+        return true;
+    }
+};
+
+extern "C" {
+
+dp_policy* dp_open(const char* path){
+    try {
+        return new dp_policy(path);
+    } catch(const std::exception& e){
+        last_error = e.what();
+        return nullptr;
+    }
+}
+
+void dp_close(dp_policy* p){ delete p; }
+
+const char* dp_last_error(void){ return last_error.c_str(); }
+
+int dp_event(const dp_policy* p){ return int(p->file.event()); }
+
+uint64_t dp_num_states(const dp_policy* p){ return p->n_index; }
+
+int dp_layout(const dp_policy* p){ return p->layout; }
+
+void dp_root_moments(const dp_policy* p, double* ev, double* sd){
+    if(ev) *ev = p->file.header().root_ev;
+    if(sd) *sd = p->file.header().root_sd;
+}
+
+uint64_t dp_rules_hash(const dp_policy* p){ return p->file.header().rules_hash; }
+
+int32_t dp_index_100m(int stage, int rerolls, const int dice[4], int set1_score){
+    return policy::m100::index(stage, rerolls, dice, set1_score);
+}
+
+int32_t dp_index_longjump(int phase, int sum_frozen, const int counts[6]){
+    int c[7] = {0, counts[0], counts[1], counts[2], counts[3], counts[4], counts[5]};
+    return policy::longjump::index(phase, sum_frozen, c);
+}
+
+int32_t dp_state_index_100m(const dp_policy* p, int stage, int rerolls, const int dice[4], int set1_score){
+    if(p->file.event()!=policy::EVENT_100M) return -1;
+    return policy::m100::index(stage, rerolls, dice, set1_score, p->layout);
+}
+
+int32_t dp_state_index_longjump(const dp_policy* p, int phase, int sum_frozen, const int counts[6]){
+    if(p->file.event()!=policy::EVENT_LONGJUMP) return -1;
+    int c[7] = {0, counts[0], counts[1], counts[2], counts[3], counts[4], counts[5]};
+    return policy::longjump::index(phase, sum_frozen, c, p->layout);
+}
+
+int32_t dp_best_action(const dp_policy* p, int32_t state){ return p->best(state); }
+
+int dp_moments(const dp_policy* p, int32_t state, int32_t action, double* ev, double* sd){
+    return p->moments(state, action, ev, sd) ? 0 : -1;
+}
+
+size_t dp_lookup_many(const dp_policy* p, const int32_t* states, size_t n, dp_result* out){
+    size_t ok = 0;
+    for(size_t i=0; i<n; ++i){
+        dp_result& r = out[i];
+        r.action = p->best(states[i]);
+        r.ev = r.sd = NAN;
+        if(r.action<0) continue;
+        p->moments(states[i], r.action, &r.ev, &r.sd);
+        ++ok;
+    }
+    return ok;
+}
+
+} // extern "C"
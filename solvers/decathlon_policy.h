@@ -0,0 +1,86 @@
+/* libdecathlon_policy — O(1) lookups into binary policy files written by the
+ * solvers with --policy-bin (see policy_format.hpp).
+ *
+ *   g++ -O3 -std=c++20 -shared -fPIC solvers/decathlon_policy.cpp -o solvers/libdecathlon_policy.so
+ *
+ * Plain C ABI so that Python (players/policy_lib.py, via ctypes) and other
+ * languages can link it. States are addressed by their perfect index, computed
+ * for the opened file with dp_state_index_100m / dp_state_index_longjump.
+ * Functions never throw; failures are reported through return values and
+ * dp_last_error().
+ */
+#ifndef DECATHLON_POLICY_H
+#define DECATHLON_POLICY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum { DP_EVENT_100M = 1, DP_EVENT_LONGJUMP = 2 };
+
+/* 100m action codes. Long jump actions are freeze counts (0 = stop run-up). */
+enum { DP_100M_FREEZE = 0, DP_100M_REROLL = 1 };
+
+/* Long jump phases, as stored in the lj_post_simple table. */
+enum { DP_LJ_RUNUP_POST = 1, DP_LJ_JUMP_POST = 3 };
+
+typedef struct dp_policy dp_policy;
+
+typedef struct dp_result {
+    int32_t action;   /* best action, -1 if the state is invalid or unreachable */
+    double  ev;       /* moments of the best action; NaN if the file has none */
+    double  sd;
+} dp_result;
+
+/* Open (mmap) a policy file. Returns NULL on failure. */
+dp_policy*  dp_open(const char* path);
+void        dp_close(dp_policy* p);
+
+/* Message for the last failure on the calling thread. */
+const char* dp_last_error(void);
+
+int         dp_event(const dp_policy* p);
+/* Number of valid state indices (which may exceed the rows stored, see
+ * FLAG_SET1_OFFSET in policy_format.hpp). */
+uint64_t    dp_num_states(const dp_policy* p);
+/* The reroll budget (100m) or run-up limit (long jump) the state indices of p
+ * are laid out for. */
+int         dp_layout(const dp_policy* p);
+/* Expected score and SD of the whole event under the policy. */
+void        dp_root_moments(const dp_policy* p, double* ev, double* sd);
+/* Hash of the rules the policy was solved for (0 if not recorded). */
+uint64_t    dp_rules_hash(const dp_policy* p);
+
+/* Perfect state indices into p, laid out for the reroll budget or run-up
+ * limit p was solved with; -1 if the state is out of range or p is a policy
+ * of the other event.
+ * 100m: dice in any order, set1_score ignored for stage 1.
+ * Long jump: counts[i] = number of rolled dice showing face i+1;
+ *            sum_frozen ignored for the jump phase. */
+int32_t     dp_state_index_100m(const dp_policy* p, int stage, int rerolls, const int dice[4], int set1_score);
+int32_t     dp_state_index_longjump(const dp_policy* p, int phase, int sum_frozen, const int counts[6]);
+
+/* The same for the standard rules (max_rerolls 5, max_runup 8) only: for a
+ * policy solved with other limits these indices are wrong. */
+int32_t     dp_index_100m(int stage, int rerolls, const int dice[4], int set1_score);
+int32_t     dp_index_longjump(int phase, int sum_frozen, const int counts[6]);
+
+/* Best action at a state, or -1. */
+int32_t     dp_best_action(const dp_policy* p, int32_t state);
+
+/* Moments of taking `action` at `state`. Returns 0 on success, -1 if the
+ * action is unavailable there or the file stores no moments for it (compact
+ * files keep them, to within 1/512, for the best action only). */
+int         dp_moments(const dp_policy* p, int32_t state, int32_t action, double* ev, double* sd);
+
+/* Batched dp_best_action + best-action moments. Returns the number of valid states. */
+size_t      dp_lookup_many(const dp_policy* p, const int32_t* states, size_t n, dp_result* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DECATHLON_POLICY_H */
@@ -0,0 +1,355 @@
+// g++ -O3 -std=c++20 -pthread solvers/decathlon_total.cpp -lsqlite3 -o solvers/decathlon_total
+// Usage: ./decathlon_total total.db [--100m 100m_policy.db] [--longjump longjump_policy.db]
+//                         [--pmf NAME=DB:TABLE]... [--target T]... [--threads N]
+//                         [--shard K/N --work-dir DIR [--shard-timeout SEC]]
+//
+// Combines the per-event score distributions into the distribution of the
+// decathlon total, with the events in command-line order:
+//   --100m DB       pmf100m from the 100m solver
+//   --longjump DB   lj_bo3_pmf from the long jump solver (--bo3); without it,
+//                   the best of three attempts played for single-attempt EV
+//   --pmf N=DB:T    any table(score, pmf) as written by sqlw::write_pmf_table;
+//                   such an event is always played the same way
+// The events are independent, so the total is their convolution.
+//
+// --target T also plays for P(total >= T): before each event, with total t so
+// far, the event is solved in-process (dp::Solver::set_utility) to maximize
+//   p_reach(next event, t + event score)
+// the probability of still reaching T from there, working back from the last
+// event. Rules come from each DB's solver_rules fingerprint (of longjump_bo3
+// for lj_bo3_pmf, of longjump for the single-attempt fallback), which must
+// match the rules played here: EV outputs only (no --objective), and the
+// k-smallest/k-largest freeze.
+//
+// That backward pass is the joint (event, total so far, event state) space,
+// one event solve per total, and --shard K/N splits it across N processes
+// (shard_checkpoint.hpp): shard K solves the totals k with k % N == K at each
+// position, writes them to DIR, and reads the other shards' results for the
+// position before starting the one before it, since a position only depends
+// on p_reach of the next. DIR must be shared when the shards run on different
+// machines. Every shard ends with the full result; only shard 0 writes the
+// DB. The layer files are checkpoints: a shard that is restarted (or a run
+// with --work-dir alone) continues after the last position it wrote for the
+// same events, rules and target. --shard-timeout bounds the wait for a
+// position from another shard (default 3600 s).
+//
+// Tables:
+//   decathlon_events(position, name, source, ev, sd)
+//   decathlon_total(score, pmf, cdf)                      every event played for EV
+//   decathlon_target(target, p_ev_play, p_target_play, ev, sd)
+//   decathlon_target_value(target, position, total_before, p_reach)
+//       p_reach is what the player maximizes at `position` (its utility)
+//   decathlon_target_pmf(target, score, pmf)              total when playing for the target
+#include <bits/stdc++.h>
+#include "dp_engine.hpp"
+#include "event_100m.hpp"
+#include "event_longjump.hpp"
+#include "parallel.hpp"
+#include "rules.hpp"
+#include "score_pmf.hpp"
+#include "shard_checkpoint.hpp"
+#include "sqlite_writer.hpp"
+using namespace std;
+
+struct Event {
+    string name, source;
+    pmf::Dist dist;            // score when played for EV
+    int lo = 0, hi = 0;        // score range of any policy
+    // Score distribution of the policy maximizing E[u[score - lo]]; empty
+    // for events that only have a fixed PMF.
+    function<pmf::Dist(vector<double>)> solve;
+    string rules;              // fingerprint text of the rules solve() plays
+};
+
+// The event as solved for `output`: its rules parameter `key` read back from
+// the stored fingerprint (or the default when there is none), then the whole
+// fingerprint checked against the event this program plays. A PMF solved
+// under other rules or for another --objective than ev would not be the
+// score distribution of the policy target play starts from.
+template<class E>
+static E stored_event(sqlw::Db& db, const string& output, const string& key, int def, const string& path){
+    optional<string> text = sqlw::read_rules(db, output);
+    if(!text){
+        fprintf(stderr,"note: %s has no rule fingerprint for %s, assuming %s=%d\n",
+                path.c_str(), output.c_str(), key.c_str(), def);
+        return E({def});
+    }
+    optional<string> v = rules::Fingerprint::value(*text, key);
+    const E ev({v ? stoi(*v) : def});
+    if(optional<string> o = rules::Fingerprint::value(*text, "objective"))
+        throw runtime_error(path + ": " + output + " was solved with --objective " + *o +
+                            "; decathlon_total needs the ev outputs");
+    if(*text != ev.fingerprint().text())
+        throw runtime_error(path + ": " + output + " was solved for rules " + *text +
+                            ", decathlon_total plays " + ev.fingerprint().text());
+    return ev;
+}
+
+template<class E>
+static function<pmf::Dist(vector<double>)> solver_for(const E& ev){
+    return [ev](vector<double> u){
+        dp::Solver<E> s(ev);
+        s.set_utility(std::move(u));
+        s.solve();
+        return pmf::Dist::of(s.root().pmf);
+    };
+}
+
+static Event event_100m(const string& path){
+    sqlw::Db db(path);
+    const auto ev = stored_event<events::M100>(db, "100m", "max_rerolls", policy::m100::MAX_REROLLS, path);
+    return {"100m", path, sqlw::read_pmf_table(db, "pmf100m"),
+            events::M100::Score::MIN, events::M100::Score::MAX, solver_for(ev), ev.fingerprint().text()};
+}
+
+static Event event_longjump(const string& path){
+    sqlw::Db db(path);
+    if(db.has_table("lj_bo3_pmf")){
+        const auto ev = stored_event<events::LongJumpBo3>(db, "longjump_bo3", "max_runup",
+                                                           policy::longjump::MAX_RUNUP, path);
+        return {"longjump", path, sqlw::read_pmf_table(db, "lj_bo3_pmf"), events::lj::Score::MIN,
+                events::lj::Score::MAX, solver_for(ev), ev.fingerprint().text()};
+    }
+    // best of three independent attempts: P(best <= x) = P(attempt <= x)^3
+    fprintf(stderr,"note: %s has no lj_bo3_pmf (run with --bo3); using the single-attempt policy\n",
+            path.c_str());
+    const auto single = stored_event<events::LongJump>(db, "longjump", "max_runup",
+                                                       policy::longjump::MAX_RUNUP, path);
+    const events::LongJumpBo3 ev(single.rules);
+    pmf::Dist a = sqlw::read_pmf_table(db, "lj_attempt_pmf");
+    pmf::Dist d{a.lo, vector<double>(a.p.size())};
+    double cdf = 0, prev = 0;
+    for(size_t i=0; i<a.p.size(); ++i){ cdf += a.p[i]; double c3 = pow(cdf, 3); d.p[i] = c3 - prev; prev = c3; }
+    return {"longjump", path, d, events::lj::Score::MIN, events::lj::Score::MAX, solver_for(ev),
+            ev.fingerprint().text()};
+}
+
+static Event event_pmf(const string& spec){
+    size_t eq = spec.find('='), colon = spec.rfind(':');
+    if(eq==string::npos || colon==string::npos || colon < eq)
+        throw invalid_argument("--pmf expects NAME=DB:TABLE, got " + spec);
+    string name = spec.substr(0, eq), path = spec.substr(eq+1, colon-eq-1), table = spec.substr(colon+1);
+    sqlw::Db db(path);
+    pmf::Dist d = sqlw::read_pmf_table(db, table);
+    return {name, path + ":" + table, d, d.lo, d.hi(), nullptr, {}};
+}
+
+struct TargetPlay {
+    int target;
+    vector<pmf::Dist> p_reach;     // per position 0..n: p_reach[i].at(total before event i)
+    pmf::Dist total;               // total score under the target policy
+};
+
+// Key of the layer files of a sharded target solve: whatever the results
+// depend on (events in order, their PMFs and rules, the target).
+static uint64_t checkpoint_key(const vector<Event>& evs, int target, const shard::Spec& sh){
+    rules::Fingerprint f("decathlon_target", 1);
+    f.add("target", target).add("shards", sh.count);
+    for(size_t i=0; i<evs.size(); ++i){
+        const Event& e = evs[i];
+        rules::Fingerprint d("pmf", 0);      // hash of the PMF's bit patterns
+        d.add("lo", e.dist.lo);
+        for(double x: e.dist.p) d.add("p", (long long)bit_cast<uint64_t>(x));
+        f.add("event" + to_string(i), e.name + "|" + e.rules + "|" + (e.solve ? "solved" : "fixed") + "|" + d.hex());
+    }
+    return f.hash();
+}
+
+// Backward pass over (event, total so far), then the forward distribution.
+// With sh.uses_files(), only this shard's totals are solved at each position
+// and the rest are read from the other shards' layer files.
+static TargetPlay play_for(const vector<Event>& evs, int target, int threads, const shard::Spec& sh){
+    const int n = int(evs.size());
+    vector<int> lo(n+1, 0), hi(n+1, 0);            // range of the total before event i
+    for(int i=0; i<n; ++i){ lo[i+1] = lo[i] + evs[i].lo; hi[i+1] = hi[i] + evs[i].hi; }
+
+    TargetPlay r{target, vector<pmf::Dist>(n+1), {}};
+    r.p_reach[n] = {lo[n], vector<double>(hi[n] - lo[n] + 1)};
+    for(int t=lo[n]; t<=hi[n]; ++t) r.p_reach[n].p[t - lo[n]] = t >= target;
+
+    const string name = "target" + to_string(target);
+    const uint64_t key = sh.uses_files() ? checkpoint_key(evs, target, sh) : 0;
+    int resumed = 0;
+    vector<vector<pmf::Dist>> played(n);           // played[i][t - lo[i]]: event i's score from total t
+    for(int i=n-1; i>=0; --i){
+        const Event& e = evs[i];
+        const pmf::Dist& next = r.p_reach[i+1];
+        const int m = hi[i] - lo[i] + 1;
+        r.p_reach[i] = {lo[i], vector<double>(m)};
+        played[i].assign(m, e.dist);
+        auto solve_total = [&](int k){
+            const int t = lo[i] + k;
+            vector<double> u(e.hi - e.lo + 1);
+            for(int x=e.lo; x<=e.hi; ++x) u[x - e.lo] = next.at(t + x);
+            // nothing to play for when every outcome is already decided
+            bool flat = all_of(u.begin(), u.end(), [&](double v){ return fabs(v - u[0]) <= dp::TIE_EPS; });
+            if(e.solve && !flat) played[i][k] = e.solve(u);
+            double p = 0;
+            for(int x=e.lo; x<=e.hi; ++x) p += played[i][k].at(x) * u[x - e.lo];
+            r.p_reach[i].p[k] = p;
+        };
+        if(!sh.uses_files()){
+            par::parallel_for_dynamic(m, threads, solve_total);
+            continue;
+        }
+
+        // record: p_reach, then the played distribution (lo, p...)
+        optional<vector<shard::Record>> mine = shard::read_layer(sh, name, i, sh.index, key);
+        if(mine) ++resumed;
+        else {
+            vector<int> own;
+            for(int k=0; k<m; ++k) if(sh.owns(k)) own.push_back(k);
+            vector<shard::Record> recs(own.size());
+            par::parallel_for_dynamic(int(own.size()), threads, [&](int j){
+                const int k = own[j];
+                solve_total(k);
+                const pmf::Dist& d = played[i][k];
+                recs[j].k = k;
+                recs[j].v = {r.p_reach[i].p[k], double(d.lo)};
+                recs[j].v.insert(recs[j].v.end(), d.p.begin(), d.p.end());
+            });
+            shard::write_layer(sh, name, i, key, recs);
+            mine = std::move(recs);
+        }
+        vector<uint8_t> seen(m, 0);
+        for(int j=0; j<sh.count; ++j){
+            const vector<shard::Record> recs = j == sh.index ? *mine : shard::wait_layer(sh, name, i, j, key);
+            for(const shard::Record& rec: recs){
+                if(rec.k < 0 || rec.k >= m || rec.k % sh.count != j || seen[rec.k] || rec.v.size() < 2)
+                    throw runtime_error("bad record in " + sh.path(name, i, j));
+                seen[rec.k] = 1;
+                r.p_reach[i].p[rec.k] = rec.v[0];
+                played[i][rec.k] = {int(rec.v[1]), vector<double>(rec.v.begin() + 2, rec.v.end())};
+            }
+        }
+        if(count(seen.begin(), seen.end(), 0))
+            throw runtime_error("layer files for position " + to_string(i) + " of " + name + " do not cover every total");
+    }
+    if(resumed) fprintf(stderr,"target %d: %d of %d positions from checkpoints in %s\n",
+                        target, resumed, n, sh.dir.c_str());
+
+    pmf::Dist cur = pmf::Dist::point(0);
+    for(int i=0; i<n; ++i){
+        pmf::Dist out{lo[i+1], vector<double>(hi[i+1] - lo[i+1] + 1)};
+        for(int t=cur.lo; t<=cur.hi(); ++t){
+            const double w = cur.at(t);
+            if(w == 0) continue;
+            const pmf::Dist& d = played[i][t - lo[i]];
+            for(int x=d.lo; x<=d.hi(); ++x) out.p[t + x - out.lo] += w * d.at(x);
+        }
+        cur = std::move(out);
+    }
+    r.total = cur;
+    return r;
+}
+
+static void write_db(sqlw::Db& db, const vector<Event>& evs, const pmf::Dist& total,
+                     const vector<TargetPlay>& targets){
+    db.begin();
+    db.exec("DROP TABLE IF EXISTS decathlon_events;");
+    db.exec("CREATE TABLE decathlon_events(position INTEGER PRIMARY KEY, name TEXT NOT NULL, source TEXT NOT NULL,"
+            " ev REAL NOT NULL, sd REAL NOT NULL);");
+    {
+        sqlw::Inserter ins(db, "decathlon_events", {"position","name","source","ev","sd"});
+        for(size_t i=0; i<evs.size(); ++i)
+            ins.i(int(i)).text(evs[i].name.c_str()).text(evs[i].source.c_str())
+               .d(evs[i].dist.mean()).d(evs[i].dist.sd()).end_row();
+        ins.finish();
+    }
+    sqlw::write_pmf_table(db, "decathlon_total", total);
+
+    db.exec("DROP TABLE IF EXISTS decathlon_target;");
+    db.exec("DROP TABLE IF EXISTS decathlon_target_value;");
+    db.exec("DROP TABLE IF EXISTS decathlon_target_pmf;");
+    db.exec("CREATE TABLE decathlon_target(target INTEGER PRIMARY KEY, p_ev_play REAL NOT NULL,"
+            " p_target_play REAL NOT NULL, ev REAL NOT NULL, sd REAL NOT NULL);");
+    db.exec("CREATE TABLE decathlon_target_value(target INTEGER NOT NULL, position INTEGER NOT NULL,"
+            " total_before INTEGER NOT NULL, p_reach REAL NOT NULL,"
+            " PRIMARY KEY(target, position, total_before)) WITHOUT ROWID;");
+    db.exec("CREATE TABLE decathlon_target_pmf(target INTEGER NOT NULL, score INTEGER NOT NULL, pmf REAL NOT NULL,"
+            " PRIMARY KEY(target, score)) WITHOUT ROWID;");
+    sqlw::Inserter summary(db, "decathlon_target", {"target","p_ev_play","p_target_play","ev","sd"});
+    sqlw::Inserter value(db, "decathlon_target_value", {"target","position","total_before","p_reach"});
+    sqlw::Inserter dist(db, "decathlon_target_pmf", {"target","score","pmf"});
+    for(const TargetPlay& t: targets){
+        summary.i(t.target).d(total.tail(t.target)).d(t.total.tail(t.target))
+               .d(t.total.mean()).d(t.total.sd()).end_row();
+        for(int i=0; i<int(evs.size()); ++i)
+            for(size_t k=0; k<t.p_reach[i].p.size(); ++k)
+                value.i(t.target).i(i).i(t.p_reach[i].lo + int(k)).d(t.p_reach[i].p[k]).end_row();
+        for(size_t k=0; k<t.total.p.size(); ++k) dist.i(t.target).i(t.total.lo + int(k)).d(t.total.p[k]).end_row();
+    }
+    summary.finish();
+    value.finish();
+    dist.finish();
+    db.commit();
+}
+
+int main(int argc, char** argv){
+    string path = "decathlon_total.db";
+    vector<string> specs;      // "kind\tvalue", in command-line order
+    vector<int> targets;
+    int threads = 0;           // 0 = one per hardware thread
+    string shard_spec = "0/1", work_dir;
+    double shard_timeout = 3600;
+    for(int i=1; i<argc; ++i){
+        string a = argv[i];
+        if((a=="--100m" || a=="--longjump" || a=="--pmf") && i+1<argc) specs.push_back(a + "\t" + argv[++i]);
+        else if(a=="--target" && i+1<argc) targets.push_back(atoi(argv[++i]));
+        else if(a=="--threads" && i+1<argc) threads = atoi(argv[++i]);
+        else if(a=="--shard" && i+1<argc) shard_spec = argv[++i];
+        else if(a=="--work-dir" && i+1<argc) work_dir = argv[++i];
+        else if(a=="--shard-timeout" && i+1<argc) shard_timeout = atof(argv[++i]);
+        else if(a.rfind("--",0)==0){ fprintf(stderr,"unknown option %s\n", a.c_str()); return 1; }
+        else path = a;
+    }
+    if(specs.empty()){ fprintf(stderr,"no events: give --100m, --longjump and/or --pmf\n"); return 1; }
+    if(threads<=0) threads = par::hardware_threads();
+    shard::Spec sh;
+    try { sh = shard::Spec::parse(shard_spec); }
+    catch(const exception& e){ fprintf(stderr,"%s\n", e.what()); return 1; }
+    sh.dir = work_dir;
+    sh.timeout_s = shard_timeout;
+    if(sh.count > 1 && !sh.uses_files()){ fprintf(stderr,"--shard needs --work-dir, shared by every shard\n"); return 1; }
+
+    try {
+        vector<Event> evs;
+        for(const string& s: specs){
+            string kind = s.substr(0, s.find('\t')), arg = s.substr(s.find('\t')+1);
+            evs.push_back(kind=="--100m" ? event_100m(arg) : kind=="--longjump" ? event_longjump(arg) : event_pmf(arg));
+            const Event& e = evs.back();
+            if(fabs(e.dist.mass() - 1) > 1e-9)
+                fprintf(stderr,"warning: %s PMF has mass %.12f\n", e.name.c_str(), e.dist.mass());
+            fprintf(stderr,"%-10s EV=%.6f SD=%.6f  (%s)\n", e.name.c_str(), e.dist.mean(), e.dist.sd(), e.source.c_str());
+        }
+
+        pmf::Dist total = pmf::Dist::point(0);
+        for(const Event& e: evs) total = pmf::convolve(total, e.dist);
+        fprintf(stderr,"total      EV=%.6f SD=%.6f  range %d..%d\n", total.mean(), total.sd(), total.lo, total.hi());
+
+        if(sh.uses_files()) filesystem::create_directories(sh.dir);
+        vector<TargetPlay> plays;
+        for(int t: targets){
+            par::Stopwatch clock;
+            plays.push_back(play_for(evs, t, threads, sh));
+            const TargetPlay& p = plays.back();
+            fprintf(stderr,"target %d: P=%.6f playing for it (%.6f playing for EV), total EV=%.6f SD=%.6f  (%.0f ms)\n",
+                    t, p.total.tail(t), total.tail(t), p.total.mean(), p.total.sd(), clock.ms());
+            if(fabs(p.total.tail(t) - p.p_reach[0].at(0)) > 1e-9)
+                fprintf(stderr,"warning: forward and backward passes disagree (%.12f vs %.12f)\n",
+                        p.total.tail(t), p.p_reach[0].at(0));
+        }
+
+        if(sh.index != 0){
+            fprintf(stderr,"shard %d/%d done; shard 0 writes %s\n", sh.index, sh.count, path.c_str());
+            return 0;
+        }
+        sqlw::Db db(path);
+        write_db(db, evs, total, plays);
+        fprintf(stderr,"Wrote %s\n", path.c_str());
+    } catch(const exception& e){
+        fprintf(stderr,"%s\n", e.what());
+        return 2;
+    }
+    return 0;
+}
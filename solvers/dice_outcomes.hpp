@@ -0,0 +1,148 @@
+// Roll outcomes of N fair six-sided dice, generated at compile time and
+// shared by every event solver.
+//
+// Each distinct multiset of faces appears once, in lexicographic order of its
+// sorted faces, together with its multinomial multiplicity and probability.
+// Iterating the C(N+5,5) patterns with these weights gives exact expectations
+// over all 6^N ordered rolls. Each outcome also carries the quantities the
+// transition functions ask for on every visit: its dense multiset_index and
+// the sums of its k smallest and k largest faces.
+#pragma once
+#include <array>
+#include <cstdint>
+#include <span>
+
+namespace dice {
+
+inline constexpr int MAX_DICE = 8;
+
+struct Outcome {
+    uint8_t  n;                  // number of dice rolled
+    uint8_t  dice[MAX_DICE];     // sorted faces, dice[0..n)
+    uint8_t  count[7];           // count[face] for face 1..6 (count[0] unused)
+    uint16_t index;              // multiset_index(count)
+    uint8_t  low[MAX_DICE+1];    // low[k]  = sum of the k smallest faces, k = 0..n
+    uint8_t  high[MAX_DICE+1];   // high[k] = sum of the k largest faces
+    uint32_t mult;               // number of ordered rolls giving this pattern
+    double   prob;               // mult / 6^n
+};
+
+constexpr long long binom(int n, int k){
+    if(k<0 || k>n) return 0;
+    long long c = 1;
+    for(int i=1; i<=k; ++i) c = c*(n-k+i)/i;
+    return c;
+}
+
+// Number of distinct patterns of n dice: C(n+5, 5).
+constexpr int n_outcomes(int n){ return int(binom(n+5, 5)); }
+
+// Rank of a face-count vector among the patterns of the same dice count,
+// i.e. its position k in OUTCOMES<n> (lexicographic order of sorted faces).
+constexpr int pattern_rank(const uint8_t count[7]){
+    int n = 0; for(int f=1; f<=6; ++f) n += count[f];
+    int rank = 0, left = n, lo = 1;
+    for(int f=1; f<=6; ++f){
+        for(int c=0; c<count[f]; ++c){
+            // sequences that put a smaller face v in [lo, f) at this position
+            for(int v=lo; v<f; ++v) rank += int(binom(6-v + left-1, left-1));
+            lo = f; --left;
+        }
+    }
+    return rank;
+}
+
+// Dense index of any multiset of 0..MAX_DICE dice: all 0-dice patterns, then
+// all 1-dice patterns, ... (there are C(n+5,6) multisets of fewer than n dice).
+constexpr int multiset_index(const uint8_t count[7]){
+    int n = 0; for(int f=1; f<=6; ++f) n += count[f];
+    return int(binom(n+5, 6)) + pattern_rank(count);
+}
+
+// Number of multisets of at most n dice.
+constexpr int n_multisets(int n){ return int(binom(n+6, 6)); }
+
+template<int N>
+constexpr std::array<Outcome, n_outcomes(N)> make_outcomes(){
+    static_assert(0 <= N && N <= MAX_DICE);
+    std::array<Outcome, n_outcomes(N)> out{};
+    uint32_t fact[MAX_DICE+1]{1};
+    for(int i=1; i<=MAX_DICE; ++i) fact[i] = fact[i-1]*i;
+    double total = 1; for(int i=0; i<N; ++i) total *= 6;
+
+    int face[MAX_DICE+1]{};
+    for(int i=0; i<N; ++i) face[i] = 1;
+    for(int k=0; k<n_outcomes(N); ++k){
+        Outcome& o = out[k];
+        o.n = N;
+        for(int i=0; i<N; ++i){ o.dice[i] = face[i]; o.count[face[i]]++; }
+        o.mult = fact[N];
+        for(int f=1; f<=6; ++f) o.mult /= fact[o.count[f]];
+        o.prob = o.mult / total;
+        o.index = multiset_index(o.count);
+        for(int i=0; i<N; ++i){
+            o.low[i+1]  = o.low[i]  + o.dice[i];
+            o.high[i+1] = o.high[i] + o.dice[N-1-i];
+        }
+
+        // next nondecreasing sequence
+        int i = N-1;
+        while(i>=0 && face[i]==6) --i;
+        if(i<0) break;
+        face[i]++;
+        for(int j=i+1; j<N; ++j) face[j] = face[i];
+    }
+    return out;
+}
+
+template<int N>
+inline constexpr auto OUTCOMES = make_outcomes<N>();
+
+static_assert([]{
+    for(int k=0; k<n_outcomes(4); ++k) if(pattern_rank(OUTCOMES<4>[k].count)!=k) return false;
+    for(int k=0; k<n_outcomes(5); ++k)
+        if(multiset_index(OUTCOMES<5>[k].count)!=n_multisets(4)+k) return false;
+    for(int k=0; k<n_outcomes(5); ++k) if(OUTCOMES<5>[k].index!=n_multisets(4)+k) return false;
+    return n_multisets(5)==462;
+}(), "pattern_rank must match the OUTCOMES ordering");
+
+// OUTCOMES<N>[k].prob as a contiguous vector, for the expectation kernels.
+template<int N>
+inline constexpr auto WEIGHTS = []{
+    std::array<double, n_outcomes(N)> w{};
+    for(int k=0; k<n_outcomes(N); ++k) w[k] = OUTCOMES<N>[k].prob;
+    return w;
+}();
+
+// Runtime view of OUTCOMES<n> for solvers whose dice count is a loop variable.
+inline std::span<const Outcome> outcomes(int n){
+    switch(n){
+        case 0: return OUTCOMES<0>;
+        case 1: return OUTCOMES<1>;
+        case 2: return OUTCOMES<2>;
+        case 3: return OUTCOMES<3>;
+        case 4: return OUTCOMES<4>;
+        case 5: return OUTCOMES<5>;
+        case 6: return OUTCOMES<6>;
+        case 7: return OUTCOMES<7>;
+        case 8: return OUTCOMES<8>;
+    }
+    return {};
+}
+
+inline std::span<const double> weights(int n){
+    switch(n){
+        case 0: return WEIGHTS<0>;
+        case 1: return WEIGHTS<1>;
+        case 2: return WEIGHTS<2>;
+        case 3: return WEIGHTS<3>;
+        case 4: return WEIGHTS<4>;
+        case 5: return WEIGHTS<5>;
+        case 6: return WEIGHTS<6>;
+        case 7: return WEIGHTS<7>;
+        case 8: return WEIGHTS<8>;
+    }
+    return {};
+}
+
+} // namespace dice
@@ -0,0 +1,495 @@
+// Generic bottom-up solver for the dice events.
+//
+// An event is a DAG of chance nodes (one roll of some number of dice) and
+// decision states (one per chance node and roll outcome). Each action of a
+// decision is an Edge: a score increment plus either the chance node that
+// follows or the end of the event. The event describes this graph through a
+// small policy class with dense indices; Solver<Event> provides the rest:
+// reachability, the layer schedule, the action choice, and propagation of
+// moments and exact score PMFs. Everything is resolved at compile time, so
+// an event pays nothing for the abstraction over a hand-written solver.
+//
+// The objective is the expected score. set_utility(u) instead maximizes
+// E[u(score)] for any function u over the score range (a threshold, say).
+// That is only well defined per node when no score is collected before the
+// last edge, so it needs an event with TERMINAL_REWARDS. set_objective
+// selects the command-line objectives built on it (see Objective).
+// set_track_reach additionally propagates, for every threshold T at once,
+// the best achievable P(score >= T): the max is taken per threshold, so one
+// pass covers them all, whatever the event's rewards.
+//
+// Event interface:
+//   using Score = pmf::Pmf<LO, HI>;         range of the event score
+//   static constexpr int  N_ACTIONS;        action codes are 0..N_ACTIONS-1
+//   static constexpr bool SD_TIEBREAK;      EV ties go to the lower SD, else to the earlier action
+//   static constexpr bool ACTION_MOMENTS;   keep the moments of every action at every state
+//   static constexpr bool PRUNE_UNREACHABLE;  solve only nodes reachable from root()
+//   static constexpr bool TERMINAL_REWARDS; every edge into a chance node has reward 0
+//   int  n_states() const;                  decision states (size of the policy table)
+//   int  n_chance() const;                  chance nodes; edges only point to lower indices
+//   int  n_layers() const;                  layers are solved in order ...
+//   Range layer(int l) const;               ... and their chance nodes are independent
+//   int  root() const;                      chance node whose value is the whole event
+//   int  dice(int c) const;                 dice rolled at chance node c
+//   int  state(int c, int i, const dice::Outcome& o) const;   decision state after outcome i
+//   void actions(int c, int i, const dice::Outcome& o, F&& emit) const;
+//                                           emit(action, Edge) for every legal action
+// Optionally:
+//   static constexpr uint32_t POLICY_FLAGS; policy::Flags describing the table's layout
+//   Origin origin(int s) const;             chance node and outcome of state s ({-1, -1} if
+//                                           none), for LazySolver::decide_state
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "dice_outcomes.hpp"
+#include "moments_kernel.hpp"
+#include "parallel.hpp"
+#include "policy_format.hpp"
+#include "rules.hpp"
+#include "score_pmf.hpp"
+
+namespace dp {
+
+struct Moments {
+    double ev = 0, ev2 = 0;
+    double sd() const { return std::sqrt(std::max(0.0, ev2 - ev*ev)); }
+    // moments of score + r
+    Moments shifted(double r) const { return {r + ev, r*r + 2.0*r*ev + ev2}; }
+};
+
+inline constexpr int     TERMINAL  = -1;
+inline constexpr uint8_t NO_ACTION = 0xff;   // state not solved (unreachable)
+static_assert(NO_ACTION == policy::longjump::NO_ACTION);
+
+// Taking an action scores `reward` and continues at chance node `next`, or
+// ends the event when next == TERMINAL.
+struct Edge { int next; int reward; };
+
+struct Range { int lo, hi; };
+
+// EVs within TIE_EPS are a tie, so rounding noise from the reduction order
+// (FMA, SIMD width) cannot flip a choice.
+inline constexpr double TIE_EPS = 1e-12;
+
+// The expected-score choice: the higher EV, and for EV ties the lower SD with
+// SD_TIEBREAK (else the incumbent, i.e. the earlier action).
+template<class Event>
+bool prefer_ev(const Moments& cand, const Moments& inc){
+    if(cand.ev > inc.ev + TIE_EPS) return true;
+    if constexpr(Event::SD_TIEBREAK)
+        return std::fabs(cand.ev - inc.ev) <= TIE_EPS && cand.sd() < inc.sd();
+    return false;
+}
+
+// A decision state's chance node and roll outcome (index into dice::outcomes).
+struct Origin { int c, i; };
+
+// What a solve maximizes, parsed from "ev", "maxprob:T" or "meanvar:L":
+//   ev          E[score]
+//   maxprob:T   P(score >= T), ties broken by EV
+//   meanvar:L   E[score] - L*Var[score]. Not separable by stages, so it is
+//               solved by alternating maximization: the policy maximizing
+//               E[X - L*(X - c)^2] for fixed c, then c = E[X], which never
+//               decreases the objective and stops at a fixed point.
+struct Objective {
+    enum Kind { EV, MAXPROB, MEANVAR } kind = EV;
+    double param = 0;          // T or L
+
+    bool is_ev() const { return kind == EV; }
+
+    static Objective parse(const std::string& s){
+        if(s == "ev") return {};
+        size_t colon = s.find(':');
+        std::string name = s.substr(0, colon);
+        if(colon == std::string::npos || (name != "maxprob" && name != "meanvar"))
+            throw std::invalid_argument("objective must be ev, maxprob:T or meanvar:L, got " + s);
+        size_t used = 0;
+        double v = std::stod(s.substr(colon+1), &used);
+        if(used != s.size() - colon - 1) throw std::invalid_argument("bad objective parameter in " + s);
+        if(name == "maxprob") return {MAXPROB, std::ceil(v)};
+        if(v < 0) throw std::invalid_argument("meanvar: L must be >= 0");
+        return {MEANVAR, v};
+    }
+    std::string text() const {
+        if(kind == EV) return "ev";
+        char buf[32];
+        if(param == std::trunc(param) && std::fabs(param) < 1e15)
+            snprintf(buf, sizeof buf, "%.0f", param);   // "30", not "3e+01"
+        else
+            for(int prec=1; prec<=17; ++prec){      // shortest text that reads back exactly
+                snprintf(buf, sizeof buf, "%.*g", prec, param);
+                if(std::strtod(buf, nullptr) == param) break;
+            }
+        return (kind == MAXPROB ? "maxprob:" : "meanvar:") + std::string(buf);
+    }
+};
+
+// The event's rules plus the objective when it is not EV (so EV outputs keep
+// their fingerprints).
+template<class Event>
+rules::Fingerprint fingerprint(const Event& ev, const Objective& o){
+    rules::Fingerprint f = ev.fingerprint();
+    if(!o.is_ev()) f.add("objective", o.text());
+    return f;
+}
+
+// Hot-path counters (Solver::stats()); build with -DDP_STATS=0 to compile them out.
+#ifndef DP_STATS
+#define DP_STATS 1
+#endif
+inline constexpr bool STATS = DP_STATS;
+
+struct Stats {
+    uint64_t chance_solved = 0;    // chance nodes solved; each exactly once, so these are the memo misses
+    uint64_t chance_pruned = 0;    // unreachable chance nodes skipped
+    uint64_t states = 0;           // decision states evaluated
+    uint64_t edges = 0;            // action evaluations
+    uint64_t memo_hits = 0;        // edges that read an already-solved chance node
+    uint64_t pmf_adds = 0;         // histogram adds after coalescing
+    uint64_t pmf_coalesced = 0;    // contributions merged into a pending add
+    uint64_t table_bytes = 0;      // solver tables: values, actions, action moments (allocated once)
+    double reach_ms = 0, solve_ms = 0;
+};
+
+inline void print_stats(FILE* f, const char* label, const Stats& s){
+    if(!STATS){ fprintf(f, "%s: built with DP_STATS=0, no counters\n", label); return; }
+    fprintf(f, "%s: chance nodes solved %llu (pruned %llu), states %llu, edges %llu, memo hits %llu\n",
+            label, (unsigned long long)s.chance_solved, (unsigned long long)s.chance_pruned,
+            (unsigned long long)s.states, (unsigned long long)s.edges, (unsigned long long)s.memo_hits);
+    fprintf(f, "%s: pmf adds %llu (+%llu coalesced), tables %.2f MB, reachability %.3f ms, layers %.3f ms\n",
+            label, (unsigned long long)s.pmf_adds, (unsigned long long)s.pmf_coalesced,
+            s.table_bytes / 1048576.0, s.reach_ms, s.solve_ms);
+}
+
+template<class Event>
+class Solver {
+public:
+    using Score = typename Event::Score;
+    struct Value { Moments m; double u = 0; Score pmf; };   // u: E[utility], with set_utility
+
+    explicit Solver(const Event& ev = {}) : ev_(ev) {
+        value_.resize(ev_.n_chance());
+        action_.assign(ev_.n_states(), NO_ACTION);
+        if constexpr(Event::ACTION_MOMENTS)
+            for(int a=0; a<Event::N_ACTIONS; ++a){
+                aev_[a].assign(ev_.n_states(), NAN);
+                aev2_[a].assign(ev_.n_states(), NAN);
+            }
+    }
+
+    // Skip the score PMFs (value(c).pmf stays empty) when only moments and
+    // actions are needed; on by default.
+    void set_track_pmf(bool on){ track_pmf_ = on; }
+
+    // Maximize E[u[score - Score::MIN]] instead of the expected score; ties
+    // (within TIE_EPS) fall back to the EV rule. Call before solve().
+    void set_utility(std::vector<double> u) requires Event::TERMINAL_REWARDS {
+        if(int(u.size()) != Score::N) throw std::invalid_argument("dp::Solver: utility must cover the score range");
+        utility_ = std::move(u);
+    }
+    bool has_utility() const { return !utility_.empty(); }
+
+    // Objective of the next solve(); anything but EV needs TERMINAL_REWARDS.
+    void set_objective(const Objective& o){
+        if constexpr(!Event::TERMINAL_REWARDS)
+            if(!o.is_ev()) throw std::invalid_argument("objective " + o.text() + " needs an event scored at the end");
+        objective_ = o;
+    }
+    const Objective& objective() const { return objective_; }
+
+    // Also compute reach() (off by default).
+    void set_track_reach(bool on){ track_reach_ = on; }
+    bool tracks_reach() const { return track_reach_; }
+    // reach()[j]: the best achievable P(score >= Score::MIN + j) from the root,
+    // each threshold under its own policy.
+    const std::array<double, Score::N>& reach() const { return tail_[ev_.root()]; }
+    // Passes over the DAG the last solve() took (meanvar iterates).
+    int objective_iterations() const { return iterations_; }
+
+    // Solve every layer in order; on_layer(l, ms) is called after each.
+    template<class OnLayer>
+    void solve(int threads, OnLayer&& on_layer){
+        if constexpr(Event::TERMINAL_REWARDS){
+            if(objective_.kind == Objective::MAXPROB){
+                std::vector<double> u(Score::N);
+                for(int j=0; j<Score::N; ++j) u[j] = Score::MIN + j >= objective_.param;
+                utility_ = std::move(u);
+            } else if(objective_.kind == Objective::MEANVAR){
+                // alternate: the best policy for a fixed anchor c, then c = E[X]
+                utility_.clear();
+                solve_pass(threads, on_layer);
+                iterations_ = 1;
+                for(double c = root().m.ev; iterations_ < MAX_ITERATIONS; ){
+                    std::vector<double> u(Score::N);
+                    for(int j=0; j<Score::N; ++j){ double x = Score::MIN + j; u[j] = x - objective_.param*(x-c)*(x-c); }
+                    utility_ = std::move(u);
+                    solve_pass(threads, on_layer);
+                    ++iterations_;
+                    if(std::fabs(root().m.ev - c) <= 1e-10) break;
+                    c = root().m.ev;
+                }
+                return;
+            }
+        }
+        iterations_ = 1;
+        solve_pass(threads, on_layer);
+    }
+    void solve(int threads = 1){ solve(threads, [](int, double){}); }
+
+    const Event& event() const { return ev_; }
+    const Value& value(int c) const { return value_[c]; }
+    const Value& root() const { return value_[ev_.root()]; }
+    bool reachable(int c) const { return reach_[c]; }
+
+    std::span<const uint8_t> actions() const { return action_; }
+    uint8_t action(int s) const { return action_[s]; }
+
+    // Moments of taking action a at state s; ev is NaN where a is not legal.
+    Moments action_moments(int s, int a) const requires Event::ACTION_MOMENTS {
+        return {aev_[a][s], aev2_[a][s]};
+    }
+    // The same as whole columns over the states: E[X] and E[X^2] of action a.
+    std::span<const double> action_ev(int a) const requires Event::ACTION_MOMENTS { return aev_[a]; }
+    std::span<const double> action_ev2(int a) const requires Event::ACTION_MOMENTS { return aev2_[a]; }
+
+    // Counters of the last solve (all zero with DP_STATS=0, except table_bytes).
+    Stats stats() const {
+        Stats s;
+        s.chance_solved = tally_.solved;   s.chance_pruned = tally_.pruned;
+        s.states = tally_.states;          s.edges = tally_.edges;
+        s.memo_hits = tally_.hits;         s.pmf_adds = tally_.adds;
+        s.pmf_coalesced = tally_.merged;
+        s.table_bytes = value_.capacity()*sizeof(Value) + action_.capacity() + reach_.capacity()
+                      + tail_.capacity()*sizeof(tail_[0]);
+        for(int a=0; a<(Event::ACTION_MOMENTS ? Event::N_ACTIONS : 0); ++a)
+            s.table_bytes += (aev_[a].capacity() + aev2_[a].capacity())*sizeof(double);
+        s.reach_ms = reach_ms_;
+        s.solve_ms = solve_ms_;
+        return s;
+    }
+
+private:
+    static constexpr int MAX_OUTS = dice::n_outcomes(dice::MAX_DICE);
+    static constexpr int MAX_ITERATIONS = 100;   // meanvar passes
+
+    // One bottom-up pass with the current utility.
+    template<class OnLayer>
+    void solve_pass(int threads, OnLayer&& on_layer){
+        par::Stopwatch reach_clock;
+        mark_reachable();
+        if(track_reach_) tail_.assign(ev_.n_chance(), {});
+        if constexpr(STATS) reach_ms_ = reach_clock.ms();
+        for(int l=0; l<ev_.n_layers(); ++l){
+            par::Stopwatch clock;
+            Range r = ev_.layer(l);
+            par::parallel_for(r.hi - r.lo, threads, [&](int k){
+                int c = r.lo + k;
+                if(reach_[c]) solve_chance(c);
+                else if constexpr(STATS) tally_.pruned.fetch_add(1, std::memory_order_relaxed);
+            });
+            double ms = clock.ms();
+            if constexpr(STATS) solve_ms_ += ms;
+            on_layer(l, ms);
+        }
+    }
+
+    Moments edge_moments(const Edge& e) const {
+        if(e.next==TERMINAL) return {double(e.reward), double(e.reward)*double(e.reward)};
+        return value_[e.next].m.shifted(e.reward);
+    }
+
+    // utility of an edge; non-terminal edges score 0 (TERMINAL_REWARDS)
+    double edge_utility(const Edge& e) const {
+        if(e.next!=TERMINAL) return value_[e.next].u;
+        int i = e.reward - Score::MIN;
+        if(i < 0 || i >= Score::N) throw std::logic_error("dp::Solver: terminal reward outside the score range");
+        return utility_[i];
+    }
+
+    // r[j] = max(r[j], P(reward + X_next >= Score::MIN + j)) for every j
+    void max_tail(const Edge& e, double* r) const {
+        for(int j=0; j<Score::N; ++j){
+            const int k = j - e.reward;
+            double p = e.next==TERMINAL ? double(e.reward >= Score::MIN + j)
+                     : k <= 0 ? 1.0 : k >= Score::N ? 0.0 : tail_[e.next][k];
+            r[j] = std::max(r[j], p);
+        }
+    }
+
+    bool prefer(double cand_u, const Moments& cand, double inc_u, const Moments& inc) const {
+        if(has_utility() && std::fabs(cand_u - inc_u) > TIE_EPS) return cand_u > inc_u;
+        return prefer(cand, inc);
+    }
+    bool prefer(const Moments& cand, const Moments& inc) const { return prefer_ev<Event>(cand, inc); }
+
+    void check_edge(int c, const Edge& e) const {
+        if(e.next >= c) throw std::logic_error("dp::Solver: edge from chance node " + std::to_string(c) +
+                                               " to " + std::to_string(e.next) + " is not solved first");
+        if constexpr(Event::TERMINAL_REWARDS)
+            if(e.next!=TERMINAL && e.reward!=0) throw std::logic_error("dp::Solver: reward on a non-terminal edge");
+    }
+
+    // Chance nodes in decreasing index order, following every action.
+    void mark_reachable(){
+        reach_.assign(ev_.n_chance(), !Event::PRUNE_UNREACHABLE);
+        if constexpr(Event::PRUNE_UNREACHABLE){
+            reach_[ev_.root()] = 1;
+            for(int c=ev_.n_chance()-1; c>=0; --c){
+                if(!reach_[c]) continue;
+                auto outs = dice::outcomes(ev_.dice(c));
+                for(int i=0; i<int(outs.size()); ++i)
+                    ev_.actions(c, i, outs[i], [&](int, Edge e){
+                        check_edge(c, e);
+                        if(e.next!=TERMINAL) reach_[e.next] = 1;
+                    });
+            }
+        }
+    }
+
+    // PMF contributions are coalesced per (next, reward), so outcomes that share
+    // a continuation (every reroll, say) cost one histogram add between them.
+    static constexpr int MAX_PENDING = 32;
+    struct Pending { int next, reward; double w; };
+
+    void solve_chance(int c){
+        const int n = ev_.dice(c);
+        auto outs = dice::outcomes(n);
+        const double* w = dice::weights(n).data();
+        double kev[MAX_OUTS], kev2[MAX_OUTS];
+        const bool util = has_utility();
+        Value v;
+        std::array<double, Score::N> node_tail{};
+        double out_tail[Score::N];
+        Pending pend[MAX_PENDING]; int n_pend = 0;
+        uint64_t n_edges = 0, n_hits = 0, n_adds = 0, n_merged = 0;
+        auto flush = [&]{
+            for(int j=0; j<n_pend; ++j) v.pmf.add(value_[pend[j].next].pmf, pend[j].w, pend[j].reward);
+            if constexpr(STATS) n_adds += n_pend;
+            n_pend = 0;
+        };
+        auto add_pmf = [&](const Edge& e, double wi){
+            if(e.next==TERMINAL){ v.pmf.add_point(e.reward, wi); return; }
+            for(int j=0; j<n_pend; ++j)
+                if(pend[j].next==e.next && pend[j].reward==e.reward){
+                    pend[j].w += wi;
+                    if constexpr(STATS) ++n_merged;
+                    return;
+                }
+            if(n_pend==MAX_PENDING) flush();
+            pend[n_pend++] = {e.next, e.reward, wi};
+        };
+        for(int i=0; i<int(outs.size()); ++i){
+            const int s = ev_.state(c, i, outs[i]);
+            int best_a = -1; Edge best_e{}; Moments best_m; double best_u = 0;
+            if(track_reach_) std::fill(out_tail, out_tail + Score::N, 0.0);
+            ev_.actions(c, i, outs[i], [&](int a, Edge e){
+                check_edge(c, e);
+                if(track_reach_) max_tail(e, out_tail);
+                if constexpr(STATS){ ++n_edges; n_hits += e.next!=TERMINAL; }
+                Moments m = edge_moments(e);
+                if constexpr(Event::ACTION_MOMENTS){ aev_[a][s] = m.ev; aev2_[a][s] = m.ev2; }
+                if constexpr(Event::TERMINAL_REWARDS){
+                    double u = util ? edge_utility(e) : 0;
+                    if(best_a<0 || prefer(u, m, best_u, best_m)){ best_a = a; best_e = e; best_m = m; best_u = u; }
+                } else if(best_a<0 || prefer(m, best_m)){ best_a = a; best_e = e; best_m = m; }
+            });
+            if(best_a<0) throw std::logic_error("dp::Solver: decision state without actions");
+            action_[s] = uint8_t(best_a);
+            kev[i] = best_m.ev; kev2[i] = best_m.ev2;
+            if(util) v.u += w[i]*best_u;
+            if(track_reach_) for(int j=0; j<Score::N; ++j) node_tail[j] += w[i]*out_tail[j];
+            if(track_pmf_) add_pmf(best_e, w[i]);
+        }
+        flush();
+        kern::Pair m = kern::dot2(w, kev, kev2, outs.size());
+        v.m = {m.a, m.b};
+        value_[c] = v;
+        if(track_reach_) tail_[c] = node_tail;
+        if constexpr(STATS){
+            tally_.solved.fetch_add(1, std::memory_order_relaxed);
+            tally_.states.fetch_add(outs.size(), std::memory_order_relaxed);
+            tally_.edges.fetch_add(n_edges, std::memory_order_relaxed);
+            tally_.hits.fetch_add(n_hits, std::memory_order_relaxed);
+            tally_.adds.fetch_add(n_adds, std::memory_order_relaxed);
+            tally_.merged.fetch_add(n_merged, std::memory_order_relaxed);
+        }
+    }
+
+    struct Tally { std::atomic<uint64_t> solved{0}, pruned{0}, states{0}, edges{0}, hits{0}, adds{0}, merged{0}; };
+
+    Event ev_;
+    bool track_pmf_ = true;
+    std::vector<double> utility_;   // empty: maximize EV
+    Objective objective_;
+    int iterations_ = 0;
+    bool track_reach_ = false;
+    std::vector<std::array<double, Score::N>> tail_;   // per chance node, see reach()
+    Tally tally_;
+    double reach_ms_ = 0, solve_ms_ = 0;
+    std::vector<Value> value_;
+    std::vector<uint8_t> reach_;
+    std::vector<uint8_t> action_;
+    std::vector<double> aev_[Event::ACTION_MOMENTS ? Event::N_ACTIONS : 1],
+                        aev2_[Event::ACTION_MOMENTS ? Event::N_ACTIONS : 1];
+};
+
+// Dense binary policy (policy_format.hpp): the action table, plus per-action
+// EV/SD sections when the event keeps action moments. rules_hash identifies
+// the rules solved (rules::Fingerprint::hash). policy::COMPACT packs the
+// actions into bits and keeps only the stored action's moments, quantized.
+template<class Event>
+void write_policy_bin(const Solver<Event>& solver, policy::Event id, const std::string& path,
+                      uint64_t rules_hash = 0, policy::Encoding encoding = policy::FULL){
+    const int n = solver.event().n_states();
+    policy::Writer w(id, n);
+    w.set_root(solver.root().m.ev, solver.root().m.sd());
+    w.set_rules_hash(rules_hash);
+    uint32_t flags = 0;
+    if constexpr(requires { Event::POLICY_FLAGS; }) flags = Event::POLICY_FLAGS;
+    w.set_flags(flags);
+    if(encoding == policy::COMPACT){
+        w.set_flags(flags | policy::FLAG_COMPACT);
+        const policy::PackedActions packed = policy::pack_actions(solver.actions());
+        w.add<uint64_t>(policy::packed_action_section(packed.bits, packed.has_none), packed.words);
+        std::vector<int16_t> ev, sd;
+        if constexpr(Event::ACTION_MOMENTS){
+            ev.resize(n); sd.resize(n);
+            for(int s=0; s<n; ++s){
+                const int a = solver.actions()[s];
+                const Moments m = a < Event::N_ACTIONS ? solver.action_moments(s, a) : Moments{NAN, NAN};
+                ev[s] = policy::quantize(m.ev);
+                sd[s] = policy::quantize(std::isnan(m.ev) ? NAN : m.sd());
+            }
+            w.add<int16_t>(policy::SEC_EV_Q, ev);
+            w.add<int16_t>(policy::SEC_SD_Q, sd);
+        }
+        w.write(path);
+        return;
+    }
+    w.add<uint8_t>(policy::SEC_ACTION, solver.actions());
+    std::vector<double> ev[Event::N_ACTIONS], sd[Event::N_ACTIONS];
+    if constexpr(Event::ACTION_MOMENTS)
+        for(int a=0; a<Event::N_ACTIONS; ++a){
+            ev[a].resize(n); sd[a].resize(n);
+            for(int s=0; s<n; ++s){
+                Moments m = solver.action_moments(s, a);
+                ev[a][s] = m.ev;
+                sd[a][s] = std::isnan(m.ev) ? NAN : m.sd();
+            }
+            w.add<double>(policy::ev_section(a), ev[a]);
+            w.add<double>(policy::sd_section(a), sd[a]);
+        }
+    w.write(path);
+}
+
+} // namespace dp
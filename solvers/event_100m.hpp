@@ -0,0 +1,213 @@
+// 100m as a dp::Solver event (see dp_engine.hpp).
+//
+// Two sets of four dice with max_rerolls rerolls shared between them; a set
+// scores the sum of its faces, with each 6 counting -6. Decision states use
+// the perfect index of policy::m100, laid out in PRIMARY KEY order:
+//   stage 1: (rerolls, pattern)             -> [0, n_stage1)
+//   stage 2: (rerolls, pattern, set1_score) -> [n_stage1, n_states)
+// where pattern is the rank of the sorted dice in dice::OUTCOMES<4>.
+// Chance nodes are the rolls that lead to them:
+//   stage 2, r rerolls left, set1_score s1 -> r*N_S1 + (s1 - S1_MIN)   [0, n_c2)
+//   stage 1, r rerolls left                -> n_c2 + r
+// Both depend only on r, not on max_rerolls, except for the stage offsets.
+//
+// Under the expected score, stage 2 does not depend on set1_score beyond
+// adding it: M100Offset below solves it once per (rerolls, pattern).
+#pragma once
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+
+#include "dice_outcomes.hpp"
+#include "dp_engine.hpp"
+#include "policy_format.hpp"
+#include "rules.hpp"
+#include "score_pmf.hpp"
+
+namespace events {
+
+// Rule parameters that may vary per solve.
+struct M100Rules {
+    int max_rerolls = policy::m100::MAX_REROLLS;   // shared by both sets
+};
+
+struct M100 {
+    static constexpr int SET_DICE    = 4;
+    static constexpr int SIX_SCORE   = -6;    // what a 6 counts for in a set
+    static constexpr int N_PATTERNS  = dice::n_outcomes(SET_DICE);
+    static constexpr int S1_MIN = -24, S1_MAX = 20;
+    static constexpr int N_S1       = S1_MAX - S1_MIN + 1;
+    static constexpr int REVISION   = 1;      // bump when the solver output changes for the same rules
+
+    using Rules = M100Rules;
+
+    enum Action : uint8_t { FREEZE = policy::m100::FREEZE, REROLL = policy::m100::REROLL };
+
+    // set score of each pattern
+    static constexpr auto PAT_SCORE = []{
+        std::array<int,N_PATTERNS> a{};
+        for(int k=0; k<N_PATTERNS; ++k)
+            for(int i=0; i<SET_DICE; ++i){ int v = dice::OUTCOMES<SET_DICE>[k].dice[i]; a[k] += (v==6 ? SIX_SCORE : v); }
+        return a;
+    }();
+
+    struct State {
+        int stage;            // 1 or 2
+        int rerolls;          // 0..max_rerolls
+        int pat;              // index into dice::OUTCOMES<4>
+        int set1_score;       // ignored for stage 1
+    };
+
+    Rules rules;
+
+    constexpr M100(Rules r = {}) : rules(r) {
+        if(r.max_rerolls < 0 || r.max_rerolls > 250) throw std::invalid_argument("100m: max_rerolls must be in 0..250");
+    }
+
+    // Everything that determines the solution.
+    rules::Fingerprint fingerprint() const {
+        rules::Fingerprint f("100m", REVISION);
+        f.add("set_dice", SET_DICE).add("six_score", SIX_SCORE).add("max_rerolls", rules.max_rerolls);
+        return f;
+    }
+
+    constexpr int n_stage1() const { return policy::m100::n_stage1(rules.max_rerolls); }
+    constexpr int n_c2() const { return (rules.max_rerolls+1) * N_S1; }
+
+    constexpr int state_index(const State& s) const {
+        int base = s.rerolls*N_PATTERNS + s.pat;
+        return s.stage==1 ? base : n_stage1() + base*N_S1 + (s.set1_score - S1_MIN);
+    }
+    constexpr State state_at(int idx) const {
+        if(idx < n_stage1()) return {1, idx/N_PATTERNS, idx%N_PATTERNS, 0};
+        int j = idx - n_stage1(), base = j/N_S1;
+        return {2, base/N_PATTERNS, base%N_PATTERNS, j%N_S1 + S1_MIN};
+    }
+
+    constexpr dp::Origin origin(int idx) const {
+        if(idx < 0 || idx >= n_states()) return {-1, -1};
+        const State s = state_at(idx);
+        return {s.stage==1 ? n_c2() + s.rerolls : s.rerolls*N_S1 + (s.set1_score - S1_MIN), s.pat};
+    }
+
+    // Where the state with this index lives in the solver table, and the score
+    // to add to its moments (see M100Offset::fold).
+    struct Folded { int state, offset; };
+    constexpr Folded fold(int idx) const { return {idx, 0}; }
+
+    // ---- dp::Solver event interface
+    using Score = pmf::Pmf<2*S1_MIN, 2*S1_MAX>;     // set1 + set2
+    static constexpr int  N_ACTIONS = 2;
+    static constexpr bool SD_TIEBREAK = true;       // tie -> lower SD -> freeze
+    static constexpr bool ACTION_MOMENTS = true;
+    static constexpr bool PRUNE_UNREACHABLE = false; // the table covers every set1_score
+    static constexpr bool TERMINAL_REWARDS = true;   // both sets score on the last freeze
+
+    constexpr int n_states() const { return policy::m100::n_states(rules.max_rerolls); }
+    constexpr int n_chance() const { return n_c2() + rules.max_rerolls + 1; }
+    // every stage-2 layer, then every stage-1 layer, rerolls ascending
+    constexpr int n_layers() const { return 2*(rules.max_rerolls+1); }
+    constexpr dp::Range layer(int l) const {
+        if(l <= rules.max_rerolls) return {l*N_S1, (l+1)*N_S1};
+        int c = n_c2() + l - (rules.max_rerolls+1);
+        return {c, c+1};
+    }
+    constexpr int layer_stage(int l) const { return l <= rules.max_rerolls ? 2 : 1; }
+    constexpr int layer_rerolls(int l) const { return l <= rules.max_rerolls ? l : l - (rules.max_rerolls+1); }
+
+    constexpr int root() const { return n_c2() + rules.max_rerolls; }
+    constexpr int dice(int) const { return SET_DICE; }
+
+    constexpr int state(int c, int pat, const dice::Outcome&) const {
+        if(c >= n_c2()) return state_index({1, c - n_c2(), pat, 0});
+        return state_index({2, c / N_S1, pat, c % N_S1 + S1_MIN});
+    }
+
+    template<class F>
+    constexpr void actions(int c, int pat, const dice::Outcome&, F&& emit) const {
+        if(c >= n_c2()){
+            int r = c - n_c2();
+            emit(FREEZE, dp::Edge{r*N_S1 + (PAT_SCORE[pat] - S1_MIN), 0});   // roll set 2
+            if(r>0) emit(REROLL, dp::Edge{c - 1, 0});
+        } else {
+            int r = c / N_S1, j = c % N_S1;
+            emit(FREEZE, dp::Edge{dp::TERMINAL, S1_MIN + j + PAT_SCORE[pat]});
+            if(r>0) emit(REROLL, dp::Edge{c - N_S1, 0});
+        }
+    }
+};
+
+static_assert(M100{}.n_states() == policy::m100::N_STATES, "policy file index must match the solver table");
+
+// M100 with stage 2 solved once per (rerolls, pattern), ~45x fewer states:
+// set 1 is scored on the edge into stage 2, so a stage-2 value is that of set
+// 2 alone. Same rules and fingerprint, same expected-score policy; M100 is
+// still needed for other objectives, where set1_score changes the decision
+// (TERMINAL_REWARDS is false here, so set_objective refuses them).
+//   stage 1: as in M100                  -> [0, n_stage1)
+//   stage 2: (rerolls, pattern)          -> [n_stage1, 2*n_stage1)
+// Chance nodes: stage 2 with r rerolls left -> r, stage 1 -> max_rerolls+1 + r.
+// Policy files record the layout with FLAG_SET1_OFFSET
+// (policy::m100::stored_index).
+struct M100Offset {
+    using Rules = M100Rules;
+    using State = M100::State;
+    using Folded = M100::Folded;
+    using Action = M100::Action;
+    static constexpr int N_PATTERNS = M100::N_PATTERNS;
+    static constexpr auto& PAT_SCORE = M100::PAT_SCORE;
+
+    Rules rules;
+
+    constexpr M100Offset(Rules r = {}) : rules(r) { (void)M100(r); }   // same rule checks
+
+    rules::Fingerprint fingerprint() const { return M100(rules).fingerprint(); }
+
+    constexpr int n_stage1() const { return policy::m100::n_stage1(rules.max_rerolls); }
+
+    // An M100 state index -> (this table's index, set1_score to add).
+    constexpr Folded fold(int idx) const {
+        const auto f = policy::m100::stored_index(idx, n_stage1());
+        return {int(f.index), f.offset};
+    }
+
+    // ---- dp::Solver event interface
+    using Score = M100::Score;
+    static constexpr int  N_ACTIONS = M100::N_ACTIONS;
+    static constexpr bool SD_TIEBREAK = M100::SD_TIEBREAK;
+    static constexpr bool ACTION_MOMENTS = true;
+    static constexpr bool PRUNE_UNREACHABLE = false;
+    static constexpr bool TERMINAL_REWARDS = false;  // set 1 scores on the way into stage 2
+    static constexpr uint32_t POLICY_FLAGS = policy::FLAG_SET1_OFFSET;
+
+    constexpr int n_states() const { return 2*n_stage1(); }
+    constexpr int n_chance() const { return 2*(rules.max_rerolls+1); }
+    constexpr int n_layers() const { return n_chance(); }
+    constexpr dp::Range layer(int l) const { return {l, l+1}; }
+    constexpr int layer_stage(int l) const { return l <= rules.max_rerolls ? 2 : 1; }
+    constexpr int layer_rerolls(int l) const { return l <= rules.max_rerolls ? l : l - (rules.max_rerolls+1); }
+
+    constexpr int root() const { return n_chance() - 1; }
+    constexpr int dice(int) const { return M100::SET_DICE; }
+
+    constexpr dp::Origin origin(int idx) const {
+        if(idx < 0 || idx >= n_states()) return {-1, -1};
+        const int base = idx < n_stage1() ? idx : idx - n_stage1(), r = base / N_PATTERNS;
+        return {idx < n_stage1() ? rules.max_rerolls+1 + r : r, base % N_PATTERNS};
+    }
+
+    constexpr int state(int c, int pat, const dice::Outcome&) const {
+        const int r = layer_rerolls(c), base = r*N_PATTERNS + pat;
+        return c > rules.max_rerolls ? base : n_stage1() + base;
+    }
+
+    template<class F>
+    constexpr void actions(int c, int pat, const dice::Outcome&, F&& emit) const {
+        const int r = layer_rerolls(c);
+        if(c > rules.max_rerolls) emit(M100::FREEZE, dp::Edge{r, PAT_SCORE[pat]});   // roll set 2
+        else emit(M100::FREEZE, dp::Edge{dp::TERMINAL, PAT_SCORE[pat]});
+        if(r>0) emit(M100::REROLL, dp::Edge{c - 1, 0});
+    }
+};
+
+} // namespace events
@@ -0,0 +1,366 @@
+// Long jump as dp::Solver events (see dp_engine.hpp).
+//
+// One attempt: in the run-up, roll the remaining dice and freeze at least one
+// (the frozen run-up sum may not exceed max_runup, 8 by default), or stop. The jump then
+// rolls as many dice as were frozen in the run-up, freezing at least one per
+// roll until all are frozen; the attempt scores the sum of the jump dice.
+// Freezing the k smallest dice (run-up) or k largest (jump) dominates every
+// other choice of k dice, so an action is just the freeze count k (0 = stop):
+// a run-up state with a lower sum has every option of one with a higher sum,
+// and the jump's value only grows with its sum. The AnyFreeze variants drop
+// that argument and offer every distinct freeze, to check it (see
+// lj::other_freezes); their action codes are not freeze counts.
+//
+//   LongJump     a single attempt, maximizing its expected score
+//   LongJumpBo3  best of N_ATTEMPTS attempts, maximizing the expected best
+//   LongJumpAnyFreeze, LongJumpBo3AnyFreeze   the same with every freeze
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+#include "dice_outcomes.hpp"
+#include "dp_engine.hpp"
+#include "policy_format.hpp"
+#include "rules.hpp"
+#include "score_pmf.hpp"
+
+namespace events {
+
+// Rule parameters that may vary per solve.
+struct LongJumpRules {
+    int max_runup = policy::longjump::MAX_RUNUP;   // largest legal frozen run-up sum
+};
+
+namespace lj {
+    enum Phase : int { RUNUP_POST = policy::longjump::RUNUP_POST, JUMP_POST = policy::longjump::JUMP_POST };
+
+    inline constexpr int N_DICE    = policy::longjump::N_DICE;
+    inline constexpr int N_COUNTS  = policy::longjump::N_COUNTS;   // multisets of 0..5 dice
+    inline constexpr int MAX_SCORE = 6*N_DICE;
+
+    // Attempt (and event) score: the jump sum of up to five dice.
+    using Score = pmf::Pmf<0, MAX_SCORE>;
+
+    // Face counts of each multiset, by dice::multiset_index.
+    inline constexpr auto COUNTS_AT = []{
+        std::array<std::array<uint8_t,7>, N_COUNTS> a{};
+        auto fill = [&](const auto& outs){
+            for(const dice::Outcome& o: outs)
+                std::copy(o.count, o.count+7, a[o.index].begin());
+        };
+        [&]<size_t... N>(std::index_sequence<N...>){ (fill(dice::OUTCOMES<N>), ...); }
+            (std::make_index_sequence<N_DICE+1>{});
+        return a;
+    }();
+
+    inline constexpr int REVISION = 1;   // bump when the solver output changes for the same rules
+
+    inline void check(const LongJumpRules& r){
+        if(r.max_runup < 0 || r.max_runup > 6*N_DICE)
+            throw std::invalid_argument("long jump: max_runup must be in 0..30");
+    }
+
+    // Number of dice of the multiset with dice::multiset_index k.
+    constexpr int n_dice_at(int k){
+        int n = 0;
+        for(int f=1; f<=6; ++f) n += COUNTS_AT[k][f];
+        return n;
+    }
+
+    // Calls f(k, sum of the k smallest dice) for k = 1..n while the sum stays <= limit.
+    template<class F>
+    constexpr void smallest(const dice::Outcome& o, int limit, F&& f){
+        for(int k=1; k<=o.n && o.low[k]<=limit; ++k) f(k, int(o.low[k]));
+    }
+    // Calls f(k, sum of the k largest dice) for k = 1..n.
+    template<class F>
+    constexpr void largest(const dice::Outcome& o, F&& f){
+        for(int k=1; k<=o.n; ++k) f(k, int(o.high[k]));
+    }
+
+    // Action codes beyond the freeze counts (AnyFreeze events):
+    // SUBSET_CODE + r freezes the sub-multiset of the roll with rank r, mixed
+    // radix over faces 1..6 with digit c[f] in 0..count[f].
+    inline constexpr int MAX_SUBSETS = 1 << N_DICE;     // sub-multisets of a roll, at most
+    inline constexpr int SUBSET_CODE = N_DICE + 1;
+
+    // The freezes of k dice whose (k, sum) neither the k smallest (run-up)
+    // nor the k largest (jump) have, once per (k, sum) since freezes with the
+    // same count and sum lead to the same state; per roll and phase, in rank
+    // order (so ties go to the lowest code).
+    struct Freeze { uint8_t code, k, sum; };
+    inline constexpr int MAX_OTHER = 22;                // most for any roll of up to 5 dice
+    struct Freezes { uint8_t n = 0; Freeze f[MAX_OTHER]{}; };
+
+    inline constexpr auto OTHER_FREEZES = []{
+        static_assert(6*N_DICE < 32, "sums are tracked in a 32-bit mask");
+        std::array<std::array<Freezes,2>, N_COUNTS> t{};   // [multiset][runup]
+        auto fill = [&](const auto& outs){
+            for(const dice::Outcome& o: outs)
+                for(int runup=0; runup<2; ++runup){
+                    Freezes& out = t[o.index][runup];
+                    uint32_t seen[N_DICE+1]{};
+                    for(int k=1; k<=o.n; ++k) seen[k] = uint32_t(1) << (runup ? o.low[k] : o.high[k]);
+                    int n_subsets = 1;
+                    for(int face=1; face<=6; ++face) n_subsets *= o.count[face] + 1;
+                    for(int r=1; r<n_subsets; ++r){
+                        int k = 0, sum = 0;
+                        for(int face=1, x=r; face<=6; ++face){
+                            const int c = x % (o.count[face] + 1);
+                            x /= o.count[face] + 1;
+                            k += c; sum += c*face;
+                        }
+                        if(seen[k] >> sum & 1) continue;
+                        seen[k] |= uint32_t(1) << sum;
+                        if(out.n == MAX_OTHER) throw "lj::MAX_OTHER too small";
+                        out.f[out.n++] = {uint8_t(SUBSET_CODE + r), uint8_t(k), uint8_t(sum)};
+                    }
+                }
+        };
+        [&]<size_t... N>(std::index_sequence<N...>){ (fill(dice::OUTCOMES<N>), ...); }
+            (std::make_index_sequence<N_DICE+1>{});
+        return t;
+    }();
+
+    // Calls f(code, k, sum) for OTHER_FREEZES of roll o with sum <= limit.
+    template<class F>
+    constexpr void other_freezes(const dice::Outcome& o, int limit, bool runup, F&& f){
+        const Freezes& fr = OTHER_FREEZES[o.index][runup];
+        for(int i=0; i<fr.n; ++i) if(fr.f[i].sum <= limit) f(int(fr.f[i].code), int(fr.f[i].k), int(fr.f[i].sum));
+    }
+
+    // Face counts frozen by action code a after roll o.
+    constexpr std::array<uint8_t,7> frozen(const dice::Outcome& o, int a, bool runup){
+        std::array<uint8_t,7> c{};
+        if(a < SUBSET_CODE){
+            for(int i=0; i<a; ++i) c[o.dice[runup ? i : o.n-1-i]]++;
+            return c;
+        }
+        for(int face=1, x=a-SUBSET_CODE; face<=6; ++face){ c[face] = uint8_t(x % (o.count[face] + 1)); x /= o.count[face] + 1; }
+        return c;
+    }
+}
+
+// Single attempt. Chance nodes are pre-roll states:
+//   jump, n dice to roll                 -> n-1                          [0, N_DICE)
+//   run-up, n dice to roll, run-up sum s -> N_DICE + (n-1)*(max_runup+1) + s
+// and decision states use policy::longjump::index (run-up (s, counts), then
+// jump (counts)); the jump does not need its sum so far, since the objective
+// is linear in it. Rolled-out dice (n == 0) are folded into the edges.
+template<bool AnyFreeze = false>
+struct BasicLongJump {
+    using Rules = LongJumpRules;
+    using Score = lj::Score;
+    // freeze counts 0..5, then with AnyFreeze the other freezes
+    static constexpr int  N_ACTIONS = AnyFreeze ? lj::SUBSET_CODE + lj::MAX_SUBSETS : lj::N_DICE + 1;
+    static constexpr bool SD_TIEBREAK = false;          // tie -> fewest dice frozen
+    static constexpr bool ACTION_MOMENTS = false;
+    static constexpr bool PRUNE_UNREACHABLE = true;
+    static constexpr bool TERMINAL_REWARDS = false;     // the jump scores die by die
+
+    Rules rules;
+
+    BasicLongJump(Rules r = {}) : rules(r) { lj::check(r); }
+
+    rules::Fingerprint fingerprint() const {
+        rules::Fingerprint f("longjump", lj::REVISION);
+        f.add("n_dice", lj::N_DICE).add("max_runup", rules.max_runup)
+         .add("freeze", AnyFreeze ? "any" : "k-smallest/k-largest");
+        return f;
+    }
+
+    constexpr int n_runup() const { return policy::longjump::n_runup(rules.max_runup); }
+
+    static constexpr int jump(int n){ return n-1; }
+    constexpr int runup(int n, int s) const { return lj::N_DICE + (n-1)*(rules.max_runup+1) + s; }
+
+    static constexpr int runup_post(int s, int k){ return s*lj::N_COUNTS + k; }
+    constexpr int jump_post(int k) const { return n_runup() + k; }
+
+    struct Post { int phase, sum_frozen, counts; };     // decoded decision state
+    constexpr Post post_at(int idx) const {
+        if(idx < n_runup()) return {lj::RUNUP_POST, idx / lj::N_COUNTS, idx % lj::N_COUNTS};
+        return {lj::JUMP_POST, 0, idx - n_runup()};
+    }
+
+    constexpr dp::Origin origin(int idx) const {
+        if(idx < 0 || idx >= n_states()) return {-1, -1};
+        const Post p = post_at(idx);
+        const int n = lj::n_dice_at(p.counts);
+        if(n == 0) return {-1, -1};
+        return {p.phase==lj::RUNUP_POST ? runup(n, p.sum_frozen) : jump(n), p.counts - int(dice::binom(n+5, 6))};
+    }
+
+    constexpr int n_states() const { return policy::longjump::n_states(rules.max_runup); }
+    constexpr int n_chance() const { return runup(lj::N_DICE, rules.max_runup) + 1; }
+    // jump for n = 1..5, then run-up for n = 1..5
+    constexpr int n_layers() const { return 2*lj::N_DICE; }
+    constexpr dp::Range layer(int l) const {
+        if(l < lj::N_DICE) return {jump(l+1), jump(l+1)+1};
+        int n = l - lj::N_DICE + 1;
+        return {runup(n, 0), runup(n, rules.max_runup)+1};
+    }
+    constexpr int root() const { return runup(lj::N_DICE, 0); }
+    constexpr int dice(int c) const {
+        return c < lj::N_DICE ? c+1 : (c - lj::N_DICE)/(rules.max_runup+1) + 1;
+    }
+
+    constexpr int state(int c, int, const dice::Outcome& o) const {
+        int k = o.index;
+        return c < lj::N_DICE ? jump_post(k) : runup_post((c - lj::N_DICE) % (rules.max_runup+1), k);
+    }
+
+    template<class F>
+    constexpr void actions(int c, int, const dice::Outcome& o, F&& emit) const {
+        const int n = o.n;
+        if(c < lj::N_DICE){
+            // any k dice leave the same jump(n-k) to play, so the largest sum wins even with AnyFreeze
+            lj::largest(o, [&](int k, int sum){
+                emit(k, dp::Edge{n==k ? dp::TERMINAL : jump(n-k), sum});
+            });
+            return;
+        }
+        const int s = (c - lj::N_DICE) % (rules.max_runup+1);
+        auto freeze = [&](int a, int k, int sum){ emit(a, dp::Edge{n==k ? jump(lj::N_DICE) : runup(n-k, s+sum), 0}); };
+        // stop: jump with the 5-n dice frozen so far
+        emit(0, dp::Edge{n==lj::N_DICE ? dp::TERMINAL : jump(lj::N_DICE-n), 0});
+        lj::smallest(o, rules.max_runup - s, [&](int k, int sum){ freeze(k, k, sum); });
+        if constexpr(AnyFreeze) lj::other_freezes(o, rules.max_runup - s, true, freeze);
+    }
+};
+
+using LongJump = BasicLongJump<>;
+using LongJumpAnyFreeze = BasicLongJump<true>;
+
+// Best of N_ATTEMPTS. V[a][b] is the expected event score before attempt a
+// with best score b so far; an attempt scoring x continues with
+// V[a+1][max(b,x)], and V[N_ATTEMPTS][b] = b. That terminal is nonlinear in
+// x, so the jump state carries the jump sum frozen so far (and the policy
+// depends on a and b). Chance nodes come in one block per (a, b), laid out
+// last attempt first so that every edge points to a lower index:
+//   block(a, b) = ((N_ATTEMPTS-1-a)*N_BEST + b) * block_size
+//   jump, n dice to roll, jump sum js   -> block + (n-1)*(MAX_JSUM+1) + js
+//   run-up, n dice to roll, run-up sum s -> block + N_JUMP + (n-1)*(max_runup+1) + s
+// Decision states are (a, b, phase, sum, counts), dense; see index().
+template<bool AnyFreeze = false>
+struct BasicLongJumpBo3 {
+    using Rules = LongJumpRules;
+    using Score = lj::Score;
+    static constexpr int  N_ACTIONS = BasicLongJump<AnyFreeze>::N_ACTIONS;
+    static constexpr bool SD_TIEBREAK = false;
+    static constexpr bool ACTION_MOMENTS = false;
+    static constexpr bool PRUNE_UNREACHABLE = true;
+    static constexpr bool TERMINAL_REWARDS = true;      // the best score, at the end
+
+    static constexpr int N_ATTEMPTS = 3;
+    static constexpr int N_BEST     = lj::MAX_SCORE + 1;
+    static constexpr int MAX_JSUM   = 6*(lj::N_DICE-1);    // frozen jump sum before a roll
+    static constexpr int N_JUMP     = lj::N_DICE*(MAX_JSUM+1);
+    static constexpr int N_JUMP_POST = (MAX_JSUM+1)*lj::N_COUNTS;
+
+    Rules rules;
+
+    BasicLongJumpBo3(Rules r = {}) : rules(r) { lj::check(r); }
+
+    rules::Fingerprint fingerprint() const {
+        rules::Fingerprint f("longjump_bo3", lj::REVISION);
+        f.add("n_dice", lj::N_DICE).add("max_runup", rules.max_runup)
+         .add("freeze", AnyFreeze ? "any" : "k-smallest/k-largest").add("attempts", N_ATTEMPTS);
+        return f;
+    }
+
+    constexpr int block_size() const { return N_JUMP + lj::N_DICE*(rules.max_runup+1); }
+    constexpr int n_runup_post() const { return (rules.max_runup+1)*lj::N_COUNTS; }
+    constexpr int n_post() const { return n_runup_post() + N_JUMP_POST; }   // per (a, b)
+
+    constexpr int block(int a, int b) const { return ((N_ATTEMPTS-1-a)*N_BEST + b)*block_size(); }
+    constexpr int jump(int a, int b, int n, int js) const { return block(a,b) + (n-1)*(MAX_JSUM+1) + js; }
+    constexpr int runup(int a, int b, int n, int s) const {
+        return block(a,b) + N_JUMP + (n-1)*(rules.max_runup+1) + s;
+    }
+    constexpr int attempt_root(int a, int b) const { return runup(a, b, lj::N_DICE, 0); }
+
+    // sum is the run-up sum for RUNUP_POST and the jump sum for JUMP_POST
+    constexpr int index(int a, int b, int phase, int sum, int k) const {
+        return (a*N_BEST + b)*n_post() + (phase==lj::RUNUP_POST ? 0 : n_runup_post()) + sum*lj::N_COUNTS + k;
+    }
+    struct Post { int attempt, best, phase, sum_frozen, counts; };
+    constexpr Post post_at(int idx) const {
+        int ab = idx / n_post(), r = idx % n_post();
+        bool run = r < n_runup_post();
+        if(!run) r -= n_runup_post();
+        return {ab / N_BEST, ab % N_BEST, run ? lj::RUNUP_POST : lj::JUMP_POST, r / lj::N_COUNTS, r % lj::N_COUNTS};
+    }
+
+    constexpr dp::Origin origin(int idx) const {
+        if(idx < 0 || idx >= n_states()) return {-1, -1};
+        const Post p = post_at(idx);
+        const int n = lj::n_dice_at(p.counts);
+        if(n == 0) return {-1, -1};
+        const int c = p.phase==lj::RUNUP_POST ? runup(p.attempt, p.best, n, p.sum_frozen)
+                                              : jump(p.attempt, p.best, n, p.sum_frozen);
+        return {c, p.counts - int(dice::binom(n+5, 6))};
+    }
+
+    constexpr int n_states() const { return N_ATTEMPTS*N_BEST*n_post(); }
+    constexpr int n_chance() const { return N_ATTEMPTS*N_BEST*block_size(); }
+    // per block: jump for n = 1..5, then run-up for n = 1..5
+    constexpr int n_layers() const { return N_ATTEMPTS*N_BEST*2*lj::N_DICE; }
+    constexpr dp::Range layer(int l) const {
+        const int R1 = rules.max_runup+1;
+        int base = (l / (2*lj::N_DICE))*block_size(), sub = l % (2*lj::N_DICE);
+        if(sub < lj::N_DICE) return {base + sub*(MAX_JSUM+1), base + (sub+1)*(MAX_JSUM+1)};
+        sub -= lj::N_DICE;
+        return {base + N_JUMP + sub*R1, base + N_JUMP + (sub+1)*R1};
+    }
+    constexpr int root() const { return attempt_root(0, 0); }
+
+    struct Node { int a, b; bool jump; int n, sum; };
+    constexpr Node node_at(int c) const {
+        const int R1 = rules.max_runup+1;
+        int blk = c / block_size(), r = c % block_size();
+        int a = N_ATTEMPTS-1 - blk / N_BEST, b = blk % N_BEST;
+        if(r < N_JUMP) return {a, b, true, r/(MAX_JSUM+1) + 1, r%(MAX_JSUM+1)};
+        r -= N_JUMP;
+        return {a, b, false, r/R1 + 1, r%R1};
+    }
+    constexpr int dice(int c) const { return node_at(c).n; }
+
+    constexpr int state(int c, int, const dice::Outcome& o) const {
+        Node v = node_at(c);
+        return index(v.a, v.b, v.jump ? lj::JUMP_POST : lj::RUNUP_POST, v.sum, o.index);
+    }
+
+    template<class F>
+    constexpr void actions(int c, int, const dice::Outcome& o, F&& emit) const {
+        const Node v = node_at(c);
+        const int n = o.n;
+        // the attempt ends with score x
+        auto end = [&](int x){
+            int best = std::max(v.b, x);
+            return v.a+1 == N_ATTEMPTS ? dp::Edge{dp::TERMINAL, best} : dp::Edge{attempt_root(v.a+1, best), 0};
+        };
+        if(v.jump){
+            auto freeze = [&](int a, int k, int sum){
+                emit(a, n==k ? end(v.sum+sum) : dp::Edge{jump(v.a, v.b, n-k, v.sum+sum), 0});
+            };
+            lj::largest(o, [&](int k, int sum){ freeze(k, k, sum); });
+            if constexpr(AnyFreeze) lj::other_freezes(o, lj::MAX_SCORE, false, freeze);
+            return;
+        }
+        auto freeze = [&](int a, int k, int sum){
+            emit(a, dp::Edge{n==k ? jump(v.a, v.b, lj::N_DICE, 0) : runup(v.a, v.b, n-k, v.sum+sum), 0});
+        };
+        emit(0, n==lj::N_DICE ? end(0) : dp::Edge{jump(v.a, v.b, lj::N_DICE-n, 0), 0});
+        lj::smallest(o, rules.max_runup - v.sum, [&](int k, int sum){ freeze(k, k, sum); });
+        if constexpr(AnyFreeze) lj::other_freezes(o, rules.max_runup - v.sum, true, freeze);
+    }
+};
+
+using LongJumpBo3 = BasicLongJumpBo3<>;
+using LongJumpBo3AnyFreeze = BasicLongJumpBo3<true>;
+
+} // namespace events
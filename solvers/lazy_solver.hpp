@@ -0,0 +1,214 @@
+// Solve-on-demand counterpart of dp::Solver for the expected-score objective.
+//
+// LazySolver<Event> solves a chance node the first time its value is asked
+// for, recursing into the nodes its actions lead to, and keeps the values in
+// a bounded cache instead of a table over the whole event. A server can then
+// answer its first query without a precompute pass, and pays only for the
+// nodes behind the states that are actually played. Values and decisions are
+// the same as dp::Solver's (same reduction, same tie rule), bit for bit.
+//
+// The cache holds chance-node moments, SHARDS ways by node index, each shard
+// behind its own mutex with CLOCK replacement (a hit sets the entry's
+// reference bit; the hand clears bits until it finds an unreferenced entry to
+// evict). Nodes are solved outside the lock, so concurrent callers may solve
+// the same node twice; the result is identical and only one copy is kept.
+// While a node is being solved its children are held locally, so every child
+// is solved at most once per parent even when the cache is smaller than the
+// working set. Grandchildren and deeper are not held that way: a cache well
+// below the number of nodes in play re-solves evicted subtrees over and over,
+// which grows quickly with the depth of the event (the best-of-three long
+// jump needs a few thousand nodes, the 100m a few hundred).
+//
+// Counters (hits, misses = nodes solved, evictions) follow DP_STATS.
+#pragma once
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "dice_outcomes.hpp"
+#include "dp_engine.hpp"
+#include "moments_kernel.hpp"
+
+namespace dp {
+
+struct CacheStats {
+    uint64_t hits = 0, misses = 0, evictions = 0;
+    uint64_t entries = 0, capacity = 0;
+};
+
+inline void print_cache_stats(FILE* f, const char* label, const CacheStats& s){
+    fprintf(f, "%s: cache %llu/%llu nodes", label, (unsigned long long)s.entries, (unsigned long long)s.capacity);
+    if(!STATS){ fprintf(f, " (built with DP_STATS=0, no counters)\n"); return; }
+    const uint64_t n = s.hits + s.misses;
+    fprintf(f, ", hits %llu, misses %llu (%.1f%% hit), evictions %llu\n", (unsigned long long)s.hits,
+            (unsigned long long)s.misses, n ? 100.0*s.hits/n : 0.0, (unsigned long long)s.evictions);
+}
+
+template<class Event>
+class LazySolver {
+public:
+    static constexpr int SHARDS = 16;
+
+    // Best action after one roll, with the moments of every action (ev NaN
+    // where the action is not legal).
+    struct Decision {
+        int action = -1;
+        Moments m;
+        std::array<Moments, Event::N_ACTIONS> per_action;
+    };
+
+    // capacity: cached chance nodes, rounded up to a multiple of SHARDS.
+    explicit LazySolver(const Event& ev = {}, size_t capacity = 4096) : ev_(ev) {
+        const size_t per = std::max<size_t>(1, (capacity + SHARDS - 1) / SHARDS);
+        for(Shard& s: shards_){ s.cap = per; s.slots.reserve(per); s.where.reserve(per); }
+    }
+
+    const Event& event() const { return ev_; }
+
+    // Moments of the event score from chance node c on.
+    Moments value(int c){
+        check_node(c);
+        return lookup(c);
+    }
+    Moments root(){ return value(ev_.root()); }
+
+    // Decision after outcome i (index into dice::outcomes(ev.dice(c))) at chance node c.
+    Decision decide(int c, int i){
+        check_node(c);
+        const auto outs = dice::outcomes(ev_.dice(c));
+        if(i < 0 || i >= int(outs.size())) throw std::out_of_range("dp::LazySolver: no outcome " + std::to_string(i));
+        Children kids;
+        return decide(c, i, outs[i], kids);
+    }
+
+    // Decision at a decision state index of the event's policy table.
+    Decision decide_state(int s) requires requires(const Event& e){ e.origin(0); } {
+        const Origin o = ev_.origin(s);
+        if(o.c < 0) throw std::out_of_range("dp::LazySolver: no decision state " + std::to_string(s));
+        return decide(o.c, o.i);
+    }
+
+    CacheStats cache_stats() const {
+        CacheStats st;
+        st.hits = tally_.hits; st.misses = tally_.misses; st.evictions = tally_.evictions;
+        for(const Shard& s: shards_){
+            std::lock_guard lock(s.mu);
+            st.entries += s.slots.size();
+            st.capacity += s.cap;
+        }
+        return st;
+    }
+
+    // Drop every cached value (the counters are kept).
+    void clear(){
+        for(Shard& s: shards_){
+            std::lock_guard lock(s.mu);
+            s.slots.clear(); s.where.clear(); s.hand = 0;
+        }
+    }
+
+private:
+    static constexpr int MAX_OUTS = dice::n_outcomes(dice::MAX_DICE);
+    static constexpr int MAX_CHILDREN = 64;   // distinct children held while solving a node
+
+    struct Slot { int c; Moments m; bool ref; };
+    struct Shard {
+        mutable std::mutex mu;
+        std::vector<Slot> slots;
+        std::unordered_map<int, uint32_t> where;   // chance node -> slot
+        size_t cap = 0, hand = 0;
+    };
+
+    // Children already resolved by the node being solved.
+    struct Children {
+        int n = 0;
+        int c[MAX_CHILDREN];
+        Moments m[MAX_CHILDREN];
+    };
+
+    void check_node(int c) const {
+        if(c < 0 || c >= ev_.n_chance()) throw std::out_of_range("dp::LazySolver: no chance node " + std::to_string(c));
+    }
+
+    Moments lookup(int c){
+        Shard& sh = shards_[c % SHARDS];
+        {
+            std::lock_guard lock(sh.mu);
+            if(auto it = sh.where.find(c); it != sh.where.end()){
+                Slot& s = sh.slots[it->second];
+                s.ref = true;
+                if constexpr(STATS) tally_.hits.fetch_add(1, std::memory_order_relaxed);
+                return s.m;
+            }
+        }
+        if constexpr(STATS) tally_.misses.fetch_add(1, std::memory_order_relaxed);
+        const Moments m = solve_node(c);
+        std::lock_guard lock(sh.mu);
+        if(sh.where.count(c)) return m;                  // solved concurrently
+        if(sh.slots.size() < sh.cap){
+            sh.where.emplace(c, uint32_t(sh.slots.size()));
+            sh.slots.push_back({c, m, false});
+            return m;
+        }
+        while(sh.slots[sh.hand].ref){ sh.slots[sh.hand].ref = false; sh.hand = (sh.hand + 1) % sh.cap; }
+        Slot& victim = sh.slots[sh.hand];
+        sh.where.erase(victim.c);
+        sh.where.emplace(c, uint32_t(sh.hand));
+        victim = {c, m, false};
+        sh.hand = (sh.hand + 1) % sh.cap;
+        if constexpr(STATS) tally_.evictions.fetch_add(1, std::memory_order_relaxed);
+        return m;
+    }
+
+    Moments child(int next, Children& kids){
+        for(int j=0; j<kids.n; ++j) if(kids.c[j] == next) return kids.m[j];
+        const Moments m = lookup(next);
+        if(kids.n < MAX_CHILDREN){ kids.c[kids.n] = next; kids.m[kids.n] = m; ++kids.n; }
+        return m;
+    }
+
+    Decision decide(int c, int i, const dice::Outcome& o, Children& kids){
+        Decision d;
+        for(Moments& m: d.per_action) m = {NAN, NAN};
+        ev_.actions(c, i, o, [&](int a, Edge e){
+            if(e.next >= c) throw std::logic_error("dp::LazySolver: edge from chance node " + std::to_string(c) +
+                                                   " to " + std::to_string(e.next) + " does not descend");
+            const Moments m = e.next==TERMINAL ? Moments{double(e.reward), double(e.reward)*double(e.reward)}
+                                               : child(e.next, kids).shifted(e.reward);
+            d.per_action[a] = m;
+            if(d.action < 0 || prefer_ev<Event>(m, d.m)){ d.action = a; d.m = m; }
+        });
+        if(d.action < 0) throw std::logic_error("dp::LazySolver: decision state without actions");
+        return d;
+    }
+
+    // Same reduction as Solver::solve_chance, so the moments match exactly.
+    Moments solve_node(int c){
+        const int n = ev_.dice(c);
+        const auto outs = dice::outcomes(n);
+        const double* w = dice::weights(n).data();
+        double kev[MAX_OUTS], kev2[MAX_OUTS];
+        Children kids;
+        for(int i=0; i<int(outs.size()); ++i){
+            const Decision d = decide(c, i, outs[i], kids);
+            kev[i] = d.m.ev; kev2[i] = d.m.ev2;
+        }
+        const kern::Pair m = kern::dot2(w, kev, kev2, outs.size());
+        return {m.a, m.b};
+    }
+
+    struct Tally { std::atomic<uint64_t> hits{0}, misses{0}, evictions{0}; };
+
+    Event ev_;
+    std::array<Shard, SHARDS> shards_;
+    Tally tally_;
+};
+
+} // namespace dp
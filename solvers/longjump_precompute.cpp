@@ -1,205 +1,218 @@
-// g++ -O3 -std=c++20 longjump_precompute_simple.cpp -lsqlite3 -o longjump_precompute_simple
-// Usage: ./longjump_precompute_simple longjump_policy_simple.db
+// g++ -O3 -std=c++20 -pthread solvers/longjump_precompute.cpp -lsqlite3 -o solvers/longjump_precompute
+// Usage: ./longjump_precompute [longjump_policy.db] [--policy-bin longjump_policy.bin] [--compact]
+//                              [--sql-batch ROWS] [--bo3] [--max-runup S] [--force] [--stats]
+//                              [--objective ev|maxprob:T|meanvar:L]
+//                              [--arrow longjump_states.arrow] [--arrow-bo3 longjump_bo3_states.arrow] [--arrow-pmf]
+//        ./longjump_precompute --exact-freeze [--bo3] [--max-runup S] [--objective ...] [--stats]
 //
 // Long Jump (Knizia's Decathlon) — Optimizes single-attempt EV and stores
 // policy as just the number of dice to freeze at each step (freeze smallest
-// first in run-up, largest first in jump).
+// first in run-up, largest first in jump). The events (events::LongJump and
+// events::LongJumpBo3, event_longjump.hpp) are solved with dp::Solver.
 //
 // Tables:
-//   lj_post_simple(phase,sum_frozen,n1..n6,freeze_count)
+//   lj_post_simple(phase,sum_frozen,n1..n6,freeze_count)   sum_frozen=0 for JUMP_POST
 //   lj_meta(key,value)
+//   lj_attempt_pmf(score,pmf,cdf)   exact single-attempt score distribution
+//   lj_attempt_reach(target,p_max,p_policy)   best achievable P(attempt >= target)
+// With --bo3, also the best-of-three policy, conditioned on the attempt and
+// the best score so far (see events::LongJumpBo3):
+//   lj_bo3_post(attempt,best,phase,sum_frozen,n1..n6,freeze_count)
+//       attempt 0..2; sum_frozen is the jump sum so far for JUMP_POST
+//   lj_bo3_value(attempt,best,ev)   expected event score before each attempt
+//   lj_bo3_pmf(score,pmf,cdf)       event score distribution
+//   lj_bo3_reach(target,p_max,p_policy)
+// --objective (dp::Objective) sets what the best-of-three policy maximizes:
+// the expected best (default), P(best >= T), or E - L*Var. The attempt is not
+// scored at its end (the jump state does not carry its sum), so the
+// single-attempt policy always maximizes EV; its reach table still gives the
+// best P(attempt >= T) for every T.
+// With --policy-bin, the same freeze counts are also written as a dense
+// binary policy (policy_format.hpp, indexed by policy::longjump::index);
+// --compact packs them into 3 bits a state.
+// --arrow / --arrow-bo3 also write the single-attempt / best-of-three states
+// as Arrow IPC files (store_arrow.hpp) for dataframes, --arrow-pmf with each
+// state's score PMF; they are rewritten whenever they are asked for.
+//
+// Each output records the rule fingerprint it was solved for (solver_rules
+// rows "longjump" and "longjump_bo3", rules_hash in the binary header) and is
+// only regenerated when that changes, or with --force. The run-up limit
+// changes every state's value, so there is no partial update.
+//
+// --stats prints each solver's counters (dp::Stats).
+//
+// --exact-freeze writes nothing: it checks that freezing the k smallest /
+// k largest dice loses nothing, by solving again with every distinct freeze
+// of every roll (events::LongJumpAnyFreeze, LongJumpBo3AnyFreeze). Those
+// evaluate each (k, sum) of frozen dice once, and in the single-attempt jump
+// only the largest sum, since the rest of the attempt does not depend on
+// which dice were frozen. It reports the decision states where another
+// freeze is strictly better and the EV difference, and exits with status 3
+// if there are any.
 
 #include <bits/stdc++.h>
-#include <sqlite3.h>
+#include "dp_engine.hpp"
+#include "event_longjump.hpp"
+#include "sqlite_writer.hpp"
+#include "store_arrow.hpp"
+#include "store_longjump.hpp"
 using namespace std;
 
-enum Phase : int { RUNUP_POST=1, JUMP_POST=3 };
-
-struct Counts {
-    int c[7];
-    Counts(){ memset(c,0,sizeof(c)); }
-    int total() const { int t=0; for(int i=1;i<=6;i++) t+=c[i]; return t; }
-    int sum() const { int s=0; for(int i=1;i<=6;i++) s+=i*c[i]; return s; }
-    bool operator==(const Counts &o) const {
-        for(int i=1;i<=6;i++) if(c[i]!=o.c[i]) return false;
-        return true;
-    }
-};
-struct CountsHash {
-    size_t operator()(const Counts &x) const noexcept {
-        size_t h=0;
-        for(int i=1;i<=6;i++) h = h*1315423911u + x.c[i];
-        return h;
+using LongJump = events::LongJump;
+using LongJumpBo3 = events::LongJumpBo3;
+
+// Solves the event with the k smallest/largest freezes (Event) and with every
+// freeze (AnyFreeze); returns the number of decision states where another
+// freeze is better.
+template<class Event, class AnyFreeze>
+static int64_t check_freezes(const char* label, const events::LongJumpRules& rules, const dp::Objective& objective,
+                             bool stats){
+    dp::Solver<Event> k_only{Event(rules)};
+    dp::Solver<AnyFreeze> any{AnyFreeze(rules)};
+    if constexpr(Event::TERMINAL_REWARDS){ k_only.set_objective(objective); any.set_objective(objective); }
+    k_only.set_track_pmf(false);
+    any.set_track_pmf(false);
+    par::Stopwatch clock;
+    k_only.solve();
+    const double ms_k = clock.ms();
+    clock = {};
+    any.solve();
+    const double ms_any = clock.ms();
+
+    int64_t states = 0, better = 0;
+    for(uint8_t a: any.actions()){
+        if(a == dp::NO_ACTION) continue;
+        ++states;
+        better += a >= events::lj::SUBSET_CODE;
     }
-};
-
-static vector<pair<Counts,double>> outcomes_cache[6];
+    const dp::Stats sk = k_only.stats(), sa = any.stats();
+    printf("%s: EV %.9f with any freeze, %.9f with the k smallest/largest (diff %.3g)\n",
+           label, any.root().m.ev, k_only.root().m.ev, any.root().m.ev - k_only.root().m.ev);
+    printf("%s: another freeze is better at %lld of %lld decision states\n", label, (long long)better, (long long)states);
+    if(dp::STATS)
+        printf("%s: %llu actions evaluated (%llu with the k smallest/largest), %.1f ms (%.1f ms)\n", label,
+               (unsigned long long)sa.edges, (unsigned long long)sk.edges, ms_any, ms_k);
+    if(stats){ dp::print_stats(stderr, label, sk); dp::print_stats(stderr, label, sa); }
+    return better;
+}
 
-static void build_outcomes(){
-    for(int n=1;n<=5;n++){
-        map<array<int,6>, double> m;
-        int total = pow(6,n);
-        function<void(int,array<int,6>&)> rec = [&](int left, array<int,6>& a){
-            if(left==0){ m[a] += 1.0/total; return; }
-            for(int face=1; face<=6; ++face){
-                a[face-1]++; rec(left-1,a); a[face-1]--;
-            }
-        };
-        array<int,6> a{}; rec(n,a);
-        vector<pair<Counts,double>> vec;
-        for(auto &kv: m){
-            Counts cnt; for(int i=1;i<=6;i++) cnt.c[i]=kv.first[i-1];
-            vec.push_back({cnt, kv.second});
+int main(int argc,char** argv){
+    string path="longjump_policy.db", bin_path, arrow_path, arrow_bo3_path;
+    int sql_batch=256;
+    bool bo3=false, force=false, stats=false, compact=false, arrow_pmf=false, exact_freeze=false;
+    events::LongJumpRules rules;
+    dp::Objective objective;
+    for(int i=1;i<argc;i++){
+        string a=argv[i];
+        if(a=="--policy-bin" && i+1<argc) bin_path=argv[++i];
+        else if(a=="--bo3") bo3=true;
+        else if(a=="--arrow" && i+1<argc) arrow_path=argv[++i];
+        else if(a=="--arrow-bo3" && i+1<argc) arrow_bo3_path=argv[++i];
+        else if(a=="--arrow-pmf") arrow_pmf=true;
+        else if(a=="--sql-batch" && i+1<argc) sql_batch=atoi(argv[++i]);
+        else if(a=="--max-runup" && i+1<argc) rules.max_runup=atoi(argv[++i]);
+        else if(a=="--objective" && i+1<argc){
+            try { objective=dp::Objective::parse(argv[++i]); }
+            catch(const exception& e){ fprintf(stderr,"%s\n", e.what()); return 1; }
         }
-        outcomes_cache[n] = move(vec);
+        else if(a=="--compact") compact=true;
+        else if(a=="--force") force=true;
+        else if(a=="--stats") stats=true;
+        else if(a=="--exact-freeze") exact_freeze=true;
+        else if(a.rfind("--",0)==0){ fprintf(stderr,"unknown option %s\n", a.c_str()); return 1; }
+        else path=a;
     }
-}
-
-struct RunupKey { int sum_frozen; Counts cnt; };
-struct JumpKey   { Counts cnt; };
-
-struct RKHash { size_t operator()(const RunupKey& k) const noexcept {
-    CountsHash h; size_t x=1469598103934665603ull;
-    x ^= (size_t)k.sum_frozen + 0x9e3779b97f4a7c15ull + (x<<6)+(x>>2);
-    x ^= h(k.cnt) + 0x9e3779b97f4a7c15ull + (x<<6)+(x>>2);
-    return x;
-}};
-struct RKEq { bool operator()(const RunupKey& a,const RunupKey& b) const noexcept {
-    return a.sum_frozen==b.sum_frozen && a.cnt==b.cnt;
-}};
-struct JKHash { size_t operator()(const JumpKey& k) const noexcept {
-    CountsHash h; return h(k.cnt);
-}};
-struct JKEq { bool operator()(const JumpKey& a,const JumpKey& b) const noexcept {
-    return a.cnt==b.cnt;
-}};
-
-static unordered_map<RunupKey,int,RKHash,RKEq> best_runup_freeze;
-static unordered_map<JumpKey,int,JKHash,JKEq>   best_jump_freeze;
 
-struct Moments { double ev=0, ev2=0; };
-
-static map<pair<int,int>, Moments> memo_runup;
-static map<int, Moments> memo_jump;
-
-static Moments solve_jump_pre(int n_rem){
-    if(n_rem==0) return {0.0,0.0};
-    if(memo_jump.count(n_rem)) return memo_jump[n_rem];
-    double ev=0, ev2=0;
-    for(auto& pr: outcomes_cache[n_rem]){
-        const Counts& cnt=pr.first; double p=pr.second;
-        double best_ev=-1e100, best_ev2=0; int best_fc=1;
-        for(int freeze_count=1; freeze_count<=n_rem; ++freeze_count){
-            // freeze_count largest dice
-            int frozen_sum=0;
-            int needed=freeze_count;
-            for(int face=6; face>=1 && needed>0; --face){
-                int take=min(cnt.c[face], needed);
-                frozen_sum += face*take;
-                needed -= take;
-            }
-            Moments tail=solve_jump_pre(n_rem-freeze_count);
-            double e=frozen_sum+tail.ev;
-            double e2=frozen_sum*frozen_sum + 2.0*frozen_sum*tail.ev + tail.ev2;
-            if(e>best_ev){ best_ev=e; best_ev2=e2; best_fc=freeze_count; }
-        }
-        best_jump_freeze[{cnt}] = best_fc;
-        ev += p*best_ev; ev2 += p*best_ev2;
+    if(!objective.is_ev() && !bo3){
+        fprintf(stderr,"--objective applies to the best-of-three policy; add --bo3\n"); return 1;
+    }
+    if(!arrow_bo3_path.empty() && !bo3){
+        fprintf(stderr,"--arrow-bo3 needs --bo3\n"); return 1;
     }
-    return memo_jump[n_rem] = {ev,ev2};
-}
 
-static Moments solve_runup_pre(int n_rem, int s){
-    if(s>8) return {0.0,0.0};
-    if(memo_runup.count({n_rem,s})) return memo_runup[{n_rem,s}];
-    int k=5-n_rem;
-    Moments stopM=solve_jump_pre(k);
-    double ev=0, ev2=0;
-    for(auto& pr: outcomes_cache[n_rem]){
-        const Counts& cnt=pr.first; double p=pr.second;
-        double best_ev=stopM.ev, best_ev2=stopM.ev2; int best_fc=0; // 0 means stop
-        for(int freeze_count=1; freeze_count<=n_rem; ++freeze_count){
-            // freeze_count smallest dice
-            int frozen_sum=0;
-            int needed=freeze_count;
-            for(int face=1; face<=6 && needed>0; ++face){
-                int take=min(cnt.c[face], needed);
-                frozen_sum += face*take;
-                needed -= take;
-            }
-            if(s+frozen_sum>8) continue;
-            Moments tail=solve_runup_pre(n_rem-freeze_count, s+frozen_sum);
-            if(tail.ev>best_ev){ best_ev=tail.ev; best_ev2=tail.ev2; best_fc=freeze_count; }
+    if(exact_freeze){
+        try {
+            int64_t better = check_freezes<LongJump, events::LongJumpAnyFreeze>("longjump", rules, objective, stats);
+            if(bo3) better += check_freezes<LongJumpBo3, events::LongJumpBo3AnyFreeze>("longjump_bo3", rules, objective, stats);
+            return better ? 3 : 0;
+        } catch(const exception& e){
+            fprintf(stderr,"%s\n", e.what());
+            return 2;
         }
-        best_runup_freeze[{s,cnt}] = best_fc;
-        ev += p*best_ev; ev2 += p*best_ev2;
     }
-    return memo_runup[{n_rem,s}] = {ev,ev2};
-}
 
-int main(int argc,char** argv){
-    build_outcomes();
-    Moments attemptM=solve_runup_pre(5,0);
-
-    string path=(argc>=2? argv[1] : "longjump_policy_simple.db");
-    sqlite3* db=nullptr;
-    if(sqlite3_open(path.c_str(),&db)!=SQLITE_OK){ fprintf(stderr,"sqlite open failed\n"); return 1; }
-
-    auto sql_exec=[&](const char* sql){
-        char* err=nullptr;
-        if(sqlite3_exec(db,sql,nullptr,nullptr,&err)!=SQLITE_OK){
-            fprintf(stderr,"sqlite error: %s\n", err?err:"(unknown)"); sqlite3_free(err); exit(2);
+    try {
+        const LongJump single_ev(rules);
+        const LongJumpBo3 bo3_ev(rules);
+        const rules::Fingerprint fp=single_ev.fingerprint(), fp3=dp::fingerprint(bo3_ev, objective);
+        const policy::Encoding encoding=compact ? policy::COMPACT : policy::FULL;
+
+        sqlw::Db db(path);
+        const bool db_current = !force && sqlw::read_rules(db, fp.output()) == fp.text();
+        const bool bin_current = bin_path.empty() || (!force && policy::stored_rules_hash(bin_path, encoding) == fp.hash());
+        const bool bo3_current = !bo3 || (!force && sqlw::read_rules(db, fp3.output()) == fp3.text());
+        if(db_current && bin_current && bo3_current && arrow_path.empty() && arrow_bo3_path.empty()){
+            fprintf(stderr,"%s is up to date (rules %s), nothing to do\n", path.c_str(), fp.hex().c_str());
+            return 0;
         }
-    };
-    sql_exec("PRAGMA journal_mode=OFF;");
-    sql_exec("PRAGMA synchronous=OFF;");
-    sql_exec("DROP TABLE IF EXISTS lj_post_simple;");
-    sql_exec("DROP TABLE IF EXISTS lj_meta;");
-    sql_exec("CREATE TABLE lj_post_simple(phase INTEGER,sum_frozen INTEGER,"
-             "n1 INTEGER,n2 INTEGER,n3 INTEGER,n4 INTEGER,n5 INTEGER,n6 INTEGER,"
-             "freeze_count INTEGER,"
-             "PRIMARY KEY(phase,sum_frozen,n1,n2,n3,n4,n5,n6));");
-    sql_exec("CREATE TABLE lj_meta(key TEXT PRIMARY KEY,value REAL);");
 
-    sqlite3_stmt* ins=nullptr;
-    string q="INSERT OR REPLACE INTO lj_post_simple VALUES(?,?,?,?,?,?,?,?,?,?,?);";
-    if(sqlite3_prepare_v2(db,q.c_str(),-1,&ins,nullptr)!=SQLITE_OK){ fprintf(stderr,"prepare failed\n"); return 2; }
-    sql_exec("BEGIN;");
-    for(auto& kv: best_runup_freeze){
-        sqlite3_reset(ins);
-        sqlite3_bind_int(ins,1,RUNUP_POST);
-        sqlite3_bind_int(ins,2,kv.first.sum_frozen);
-        for(int i=1;i<=6;i++) sqlite3_bind_int(ins,2+i,kv.first.cnt.c[i]);
-        sqlite3_bind_int(ins,9,kv.second);
-        if(sqlite3_step(ins)!=SQLITE_DONE){ fprintf(stderr,"insert failed\n"); return 3; }
-    }
-    for(auto& kv: best_jump_freeze){
-        sqlite3_reset(ins);
-        sqlite3_bind_int(ins,1,JUMP_POST);
-        sqlite3_bind_null(ins,2);
-        for(int i=1;i<=6;i++) sqlite3_bind_int(ins,2+i,kv.first.cnt.c[i]);
-        sqlite3_bind_int(ins,9,kv.second);
-        if(sqlite3_step(ins)!=SQLITE_DONE){ fprintf(stderr,"insert failed\n"); return 4; }
-    }
-    sql_exec("COMMIT;");
-    sqlite3_finalize(ins);
-
-    sqlite3_stmt* insm=nullptr;
-    if(sqlite3_prepare_v2(db,"INSERT OR REPLACE INTO lj_meta(key,value) VALUES(?,?);",-1,&insm,nullptr)!=SQLITE_OK){
-        fprintf(stderr,"prepare meta failed\n"); return 5;
+        dp::Solver<LongJump> single(single_ev);
+        single.set_track_reach(true);
+        single.solve();
+        if(stats) dp::print_stats(stderr, "longjump", single.stats());
+        const auto& attempt=single.root();
+        if(fabs(attempt.pmf.mass()-1)>1e-9 || fabs(attempt.pmf.mean()-attempt.m.ev)>1e-9)
+            fprintf(stderr,"warning: score PMF disagrees with the moments (mass=%.12f, mean=%.12f)\n",
+                    attempt.pmf.mass(), attempt.pmf.mean());
+        if(!db_current){
+            store::write_longjump(db, single, sql_batch);
+            fprintf(stderr,"Wrote policy to %s (attempt EV=%.6f, SD=%.6f)\n", path.c_str(),
+                    attempt.m.ev, attempt.m.sd());
+        }
+        if(!bin_current){
+            dp::write_policy_bin(single, policy::EVENT_LONGJUMP, bin_path, fp.hash(), encoding);
+            fprintf(stderr,"Wrote %sbinary policy to %s (%llu bytes)\n", compact ? "compact " : "", bin_path.c_str(),
+                    (unsigned long long)filesystem::file_size(bin_path));
+        }
+        if(!arrow_path.empty()){
+            store::write_longjump_arrow(single, arrow_path, arrow_pmf);
+            fprintf(stderr,"Wrote Arrow table to %s (%llu bytes)\n", arrow_path.c_str(),
+                    (unsigned long long)filesystem::file_size(arrow_path));
+        }
+        if(!bo3_current || !arrow_bo3_path.empty()){
+            // the best-of-three table is large, so only allocate it when it is written
+            dp::Solver<LongJumpBo3> best3(bo3_ev);
+            best3.set_objective(objective);
+            best3.set_track_reach(true);
+            best3.solve();
+            if(!arrow_bo3_path.empty()){
+                store::write_longjump_bo3_arrow(best3, arrow_bo3_path, arrow_pmf);
+                fprintf(stderr,"Wrote Arrow table to %s (%llu bytes)\n", arrow_bo3_path.c_str(),
+                        (unsigned long long)filesystem::file_size(arrow_bo3_path));
+            }
+            if(stats) dp::print_stats(stderr, "longjump_bo3", best3.stats());
+            if(!bo3_current) store::write_longjump_bo3(db, best3, sql_batch);
+            // best of three independent attempts played for single-attempt EV
+            auto cdf=attempt.pmf.cdf();
+            double iid=0;
+            for(int x=0; x<LongJump::Score::N; ++x) iid += x*(pow(cdf[x],3) - (x ? pow(cdf[x-1],3) : 0.0));
+            fprintf(stderr,"Best of three: EV=%.6f, SD=%.6f (%.6f with the single-attempt policy)\n",
+                    best3.root().m.ev, best3.root().pmf.sd(), iid);
+            if(objective.kind==dp::Objective::MAXPROB){
+                int t=int(objective.param);
+                double p=0;
+                for(int x=max(t,0); x<=LongJump::Score::MAX; ++x) p += best3.root().pmf[x];
+                fprintf(stderr,"%s: P(best >= %d) = %.6f (best possible %.6f)\n", objective.text().c_str(), t, p,
+                        t<=0 ? 1.0 : t>LongJump::Score::MAX ? 0.0 : best3.reach()[t]);
+            } else if(objective.kind==dp::Objective::MEANVAR){
+                double sd=best3.root().pmf.sd();
+                fprintf(stderr,"%s: E - L*Var = %.6f after %d pass(es)\n", objective.text().c_str(),
+                        best3.root().m.ev - objective.param*sd*sd, best3.objective_iterations());
+            }
+        }
+    } catch(const exception& e){
+        fprintf(stderr,"%s\n", e.what());
+        return 2;
     }
-    auto put=[&](const char* k,double v){
-        sqlite3_reset(insm);
-        sqlite3_bind_text(insm,1,k,-1,SQLITE_TRANSIENT);
-        sqlite3_bind_double(insm,2,v);
-        if(sqlite3_step(insm)!=SQLITE_DONE){ fprintf(stderr,"insert meta failed\n"); exit(6); }
-    };
-    put("attempt_ev",attemptM.ev);
-    double var=max(0.0,attemptM.ev2 - attemptM.ev*attemptM.ev);
-    put("attempt_sd",sqrt(var));
-    sqlite3_finalize(insm);
-    sqlite3_close(db);
-
-    fprintf(stderr,"Wrote policy to %s (attempt EV=%.6f, SD=%.6f)\n", path.c_str(), attemptM.ev, sqrt(var));
     return 0;
 }
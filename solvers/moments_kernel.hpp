@@ -0,0 +1,103 @@
+// Vectorized expectation kernels for the DP reductions.
+//
+// Every chance node in the solvers is a probability-weighted sum of the first
+// and second moments of its children. With the children stored as contiguous
+// SoA arrays (ev[], ev2[]), that is a pair of dot products with the outcome
+// weight vector, or, when children of several chance nodes are interleaved
+// row by row, a transposed matrix-vector product.
+//
+// AVX2 (+FMA) and NEON paths are picked at compile time (-march=native or
+// -mavx2 -mfma); the scalar fallback is always available and is what the
+// default build uses.
+#pragma once
+#include <cstddef>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace kern {
+
+struct Pair { double a = 0, b = 0; };
+
+#if defined(__AVX2__)
+static inline __m256d fma4(__m256d x, __m256d y, __m256d acc){
+#if defined(__FMA__)
+    return _mm256_fmadd_pd(x, y, acc);
+#else
+    return _mm256_add_pd(_mm256_mul_pd(x, y), acc);
+#endif
+}
+static inline double hsum4(__m256d v){
+    __m128d lo = _mm256_castpd256_pd128(v), hi = _mm256_extractf128_pd(v, 1);
+    lo = _mm_add_pd(lo, hi);
+    return _mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo)));
+}
+#endif
+
+// (sum w[i]*a[i], sum w[i]*b[i]) for i in [0, n).
+static inline Pair dot2(const double* w, const double* a, const double* b, size_t n){
+    size_t i = 0;
+    Pair r;
+#if defined(__AVX2__)
+    __m256d sa0 = _mm256_setzero_pd(), sa1 = _mm256_setzero_pd();
+    __m256d sb0 = _mm256_setzero_pd(), sb1 = _mm256_setzero_pd();
+    for(; i+8<=n; i+=8){
+        __m256d w0 = _mm256_loadu_pd(w+i), w1 = _mm256_loadu_pd(w+i+4);
+        sa0 = fma4(w0, _mm256_loadu_pd(a+i),   sa0);
+        sa1 = fma4(w1, _mm256_loadu_pd(a+i+4), sa1);
+        sb0 = fma4(w0, _mm256_loadu_pd(b+i),   sb0);
+        sb1 = fma4(w1, _mm256_loadu_pd(b+i+4), sb1);
+    }
+    r.a = hsum4(_mm256_add_pd(sa0, sa1));
+    r.b = hsum4(_mm256_add_pd(sb0, sb1));
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    float64x2_t sa0 = vdupq_n_f64(0), sa1 = vdupq_n_f64(0);
+    float64x2_t sb0 = vdupq_n_f64(0), sb1 = vdupq_n_f64(0);
+    for(; i+4<=n; i+=4){
+        float64x2_t w0 = vld1q_f64(w+i), w1 = vld1q_f64(w+i+2);
+        sa0 = vfmaq_f64(sa0, w0, vld1q_f64(a+i));
+        sa1 = vfmaq_f64(sa1, w1, vld1q_f64(a+i+2));
+        sb0 = vfmaq_f64(sb0, w0, vld1q_f64(b+i));
+        sb1 = vfmaq_f64(sb1, w1, vld1q_f64(b+i+2));
+    }
+    r.a = vaddvq_f64(vaddq_f64(sa0, sa1));
+    r.b = vaddvq_f64(vaddq_f64(sb0, sb1));
+#endif
+    for(; i<n; ++i){ r.a += w[i]*a[i]; r.b += w[i]*b[i]; }
+    return r;
+}
+
+// Column sums of two row-major matrices weighted by row:
+//   out_a[c] = sum_k w[k]*a[k*stride + c],  out_b likewise,  c in [0, cols).
+// Rows are accumulated in order, so each column sees the same summation
+// sequence as a scalar loop over k.
+static inline void weighted_rows2(const double* w, size_t rows,
+                                  const double* a, const double* b, size_t stride, size_t cols,
+                                  double* out_a, double* out_b){
+    for(size_t c=0; c<cols; ++c){ out_a[c] = 0; out_b[c] = 0; }
+    for(size_t k=0; k<rows; ++k){
+        const double wk = w[k];
+        const double* ra = a + k*stride;
+        const double* rb = b + k*stride;
+        size_t c = 0;
+#if defined(__AVX2__)
+        __m256d vw = _mm256_set1_pd(wk);
+        for(; c+4<=cols; c+=4){
+            _mm256_storeu_pd(out_a+c, fma4(vw, _mm256_loadu_pd(ra+c), _mm256_loadu_pd(out_a+c)));
+            _mm256_storeu_pd(out_b+c, fma4(vw, _mm256_loadu_pd(rb+c), _mm256_loadu_pd(out_b+c)));
+        }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        float64x2_t vw = vdupq_n_f64(wk);
+        for(; c+2<=cols; c+=2){
+            vst1q_f64(out_a+c, vfmaq_f64(vld1q_f64(out_a+c), vw, vld1q_f64(ra+c)));
+            vst1q_f64(out_b+c, vfmaq_f64(vld1q_f64(out_b+c), vw, vld1q_f64(rb+c)));
+        }
+#endif
+        for(; c<cols; ++c){ out_a[c] += wk*ra[c]; out_b[c] += wk*rb[c]; }
+    }
+}
+
+} // namespace kern
@@ -0,0 +1,60 @@
+// Minimal fork/join helpers for layer-parallel DP sweeps.
+//
+// parallel_for splits [0, n) into one contiguous chunk per thread and returns
+// once every chunk is done, so consecutive calls act as a barrier between
+// layers. With threads <= 1 the body runs inline on the calling thread.
+// parallel_for_dynamic hands out indices one at a time instead, for a few
+// tasks of very different cost.
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace par {
+
+template<class F>
+void parallel_for(int n, int threads, F&& body){
+    threads = std::max(1, std::min(threads, n));
+    if(threads == 1){
+        for(int i=0; i<n; ++i) body(i);
+        return;
+    }
+    std::vector<std::jthread> pool;
+    pool.reserve(threads-1);
+    auto chunk = [&](int t){
+        int lo = int((long long)n*t/threads), hi = int((long long)n*(t+1)/threads);
+        for(int i=lo; i<hi; ++i) body(i);
+    };
+    for(int t=1; t<threads; ++t) pool.emplace_back(chunk, t);
+    chunk(0);
+}
+
+template<class F>
+void parallel_for_dynamic(int n, int threads, F&& body){
+    threads = std::max(1, std::min(threads, n));
+    std::atomic<int> next{0};
+    auto worker = [&]{
+        for(int i; (i = next.fetch_add(1, std::memory_order_relaxed)) < n; ) body(i);
+    };
+    std::vector<std::jthread> pool;
+    pool.reserve(threads-1);
+    for(int t=1; t<threads; ++t) pool.emplace_back(worker);
+    worker();
+}
+
+inline int hardware_threads(){
+    unsigned h = std::thread::hardware_concurrency();
+    return h ? int(h) : 1;
+}
+
+// Wall-clock stopwatch in milliseconds.
+struct Stopwatch {
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    double ms() const {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    }
+};
+
+} // namespace par
@@ -0,0 +1,440 @@
+// g++ -O3 -std=c++20 solvers/policy_diff.cpp -lsqlite3 -o solvers/policy_diff
+// Usage: ./policy_diff A B [--tol EV] [--sd-tol SD] [--quiet]
+//
+// Compares two stored policies, state by state, for regression checks after
+// a solver or rules change. A and B are each a binary policy file
+// (policy_format.hpp: plain, compact or folded) or a DB written by
+// 100m_precompute / longjump_precompute, in any combination; the kind is
+// told by the file's magic. Every table the two have in common is compared:
+//   100m           states100m, or a 100m policy file
+//   longjump       lj_post_simple, or a long jump policy file (actions only)
+//   longjump_bo3   lj_bo3_post (actions only)
+//
+// Both sides are first laid out densely over the event's state index
+// (folded 100m files are fanned out to every set1_score), so the comparison
+// is a straight pass over arrays. If the reroll budget or run-up limit
+// differs, only the states both layouts have are compared.
+//
+// Per solver layer (100m: stage and rerolls left; long jump: phase and dice
+// rolled) it reports the states compared, action flips, the flips that are
+// EV ties within --tol in A (both actions' moments known), and max/mean
+// |dEV| and |dSD| of the chosen action's moments, plus the worst state. It
+// prints "moments only in one" when one side has a value that the other
+// lacks. The exit status is 3 when anything other than a tie flip is
+// beyond tolerance (--tol, default 1e-9; --sd-tol, default --tol), 0
+// otherwise. Compare compact files with --tol 0.002 (their step is 1/256).
+// --quiet prints the totals only.
+#include <bits/stdc++.h>
+#include <sqlite3.h>
+#include "dice_outcomes.hpp"
+#include "event_100m.hpp"
+#include "event_longjump.hpp"
+#include "parallel.hpp"
+#include "policy_format.hpp"
+#include "sqlite_writer.hpp"
+using namespace std;
+
+using M100 = events::M100;
+using LongJump = events::LongJump;
+using LongJumpBo3 = events::LongJumpBo3;
+namespace lj = events::lj;
+
+static constexpr uint8_t NONE = 0xff;
+
+// One event's policy over its dense state index.
+struct Table {
+    string name;                 // 100m, longjump, longjump_bo3
+    int param = 0;               // max_rerolls / max_runup of the layout
+    string rules;                // fingerprint text, if recorded
+    uint64_t rules_hash = 0;     // 0 if not recorded
+    vector<uint8_t> action;      // NONE: no decision stored
+    vector<double> ev, sd;       // of the stored action; empty if the source has no moments
+    vector<double> aev[M100::N_ACTIONS];   // 100m: EV of every action (NaN if illegal), if known
+};
+
+static uint64_t n_states(const string& name, int param){
+    if(name=="100m") return M100({param}).n_states();
+    if(name=="longjump") return LongJump({param}).n_states();
+    return LongJumpBo3({param}).n_states();
+}
+
+static Table blank(const string& name, int param, bool moments){
+    Table t;
+    t.name = name; t.param = param;
+    const size_t n = n_states(name, param);
+    t.action.assign(n, NONE);
+    if(moments){
+        t.ev.assign(n, NAN); t.sd.assign(n, NAN);
+        if(name=="100m") for(auto& v: t.aev) v.assign(n, NAN);
+    }
+    return t;
+}
+
+// ------------------------------------------------------------------ loading
+
+static Table load_bin(const string& path){
+    policy::File f(path);
+    const auto& h = f.header();
+    const policy::ActionCodes act = f.actions();
+    if(act.size()!=f.n_states()) throw runtime_error("policy file has no action section: " + path);
+    if(f.event()==policy::EVENT_LONGJUMP){
+        const int64_t rows = int64_t(f.n_states()) / lj::N_COUNTS;
+        if(rows < 2 || int64_t(f.n_states()) % lj::N_COUNTS) throw runtime_error("unexpected long jump layout: " + path);
+        Table t = blank("longjump", int(rows - 2), false);
+        for(uint64_t s=0; s<f.n_states(); ++s) t.action[s] = act[s];
+        t.rules_hash = h.rules_hash;
+        return t;
+    }
+    if(f.event()!=policy::EVENT_100M) throw runtime_error("unknown event in " + path);
+    const bool folded = h.flags & policy::FLAG_SET1_OFFSET;
+    const uint64_t n_stage1 = folded ? f.n_states()/2 : f.n_states()/(1 + M100::N_S1);
+    if(n_stage1 % M100::N_PATTERNS || n_stage1 == 0) throw runtime_error("unexpected 100m layout: " + path);
+    Table t = blank("100m", int(n_stage1 / M100::N_PATTERNS) - 1, true);
+    if(t.action.size() != (folded ? n_stage1*(1 + M100::N_S1) : f.n_states()))
+        throw runtime_error("unexpected 100m layout: " + path);
+    t.rules_hash = h.rules_hash;
+    const auto ev_q = f.section<int16_t>(policy::SEC_EV_Q), sd_q = f.section<int16_t>(policy::SEC_SD_Q);
+    span<const double> ev[M100::N_ACTIONS], sd[M100::N_ACTIONS];
+    for(int a=0; a<M100::N_ACTIONS; ++a){
+        ev[a] = f.section<double>(policy::ev_section(a));
+        sd[a] = f.section<double>(policy::sd_section(a));
+    }
+    for(size_t s=0; s<t.action.size(); ++s){
+        const auto [i, offset] = folded ? policy::m100::stored_index(int64_t(s), int64_t(n_stage1))
+                                        : policy::m100::Stored{int64_t(s), 0};
+        const uint8_t a = act[uint64_t(i)];
+        t.action[s] = a;
+        if(!ev_q.empty()){
+            t.ev[s] = policy::dequantize(ev_q[i]) + offset;
+            t.sd[s] = policy::dequantize(sd_q[i]);
+            continue;
+        }
+        for(int b=0; b<M100::N_ACTIONS; ++b) if(!ev[b].empty()) t.aev[b][s] = ev[b][i] + offset;
+        if(a < M100::N_ACTIONS && !ev[a].empty()){ t.ev[s] = ev[a][i] + offset; t.sd[s] = sd[a][i]; }
+    }
+    if(!ev_q.empty()) for(auto& v: t.aev) v.clear();
+    return t;
+}
+
+static void read_rules(sqlw::Db& db, Table& t){
+    if(auto r = sqlw::read_rules(db, t.name)) t.rules = *r;
+    if(auto h = db.query_text("SELECT hash FROM solver_rules WHERE output=?;", t.name)) t.rules_hash = stoull(*h, nullptr, 16);
+}
+
+// The layout parameter: from the recorded rules, else the largest value in the table.
+static int db_param(sqlw::Db& db, const string& output, const string& key, const string& sql){
+    if(db.has_table("solver_rules"))
+        if(auto r = sqlw::read_rules(db, output))
+            if(auto v = rules::Fingerprint::value(*r, key)) return stoi(*v);
+    sqlite3_stmt* st = db.prepare(sql);
+    int v = sqlite3_step(st)==SQLITE_ROW ? sqlite3_column_int(st, 0) : 0;
+    sqlite3_finalize(st);
+    return v;
+}
+
+// Steps every row of `sql`, calling row(st); finalizes even if row throws.
+template<class F>
+static void each_row(sqlw::Db& db, const string& sql, F&& row){
+    sqlite3_stmt* st = db.prepare(sql);
+    try { while(sqlite3_step(st)==SQLITE_ROW) row(st); }
+    catch(...){ sqlite3_finalize(st); throw; }
+    sqlite3_finalize(st);
+}
+
+static double col_or_nan(sqlite3_stmt* st, int c){
+    return sqlite3_column_type(st, c)==SQLITE_NULL ? NAN : sqlite3_column_double(st, c);
+}
+
+static int counts_index(sqlite3_stmt* st, int first){
+    uint8_t c[7]{};
+    for(int f=1; f<=6; ++f) c[f] = uint8_t(sqlite3_column_int(st, first + f - 1));
+    return dice::multiset_index(c);
+}
+
+// Event name -> the DB table holding its policy.
+static const pair<const char*, const char*> DB_TABLES[] = {
+    {"100m", "states100m"}, {"longjump", "lj_post_simple"}, {"longjump_bo3", "lj_bo3_post"}};
+
+static vector<Table> load_db(const string& path, const set<string>& want){
+    sqlw::Db db(path);
+    vector<Table> out;
+    if(want.count("100m")){
+        Table t = blank("100m", db_param(db, "100m", "max_rerolls", "SELECT MAX(rerolls) FROM states100m;"), true);
+        read_rules(db, t);
+        const M100 ev({t.param});
+        each_row(db, "SELECT stage,rerolls,d1,d2,d3,d4,set1_score,ev_freeze,sd_freeze,ev_reroll,sd_reroll,best"
+                     " FROM states100m;", [&](sqlite3_stmt* st){
+            uint8_t count[7]{};
+            for(int k=0; k<4; ++k) count[sqlite3_column_int(st, 2 + k)]++;
+            const M100::State s{sqlite3_column_int(st, 0), sqlite3_column_int(st, 1), dice::pattern_rank(count),
+                                sqlite3_column_int(st, 6)};
+            if(s.rerolls > t.param) return;
+            const int idx = ev.state_index(s);
+            const int a = sqlite3_column_int(st, 11);
+            t.action[idx] = uint8_t(a);
+            t.aev[M100::FREEZE][idx] = col_or_nan(st, 7);
+            t.aev[M100::REROLL][idx] = col_or_nan(st, 9);
+            t.ev[idx] = col_or_nan(st, a==M100::FREEZE ? 7 : 9);
+            t.sd[idx] = col_or_nan(st, a==M100::FREEZE ? 8 : 10);
+        });
+        out.push_back(std::move(t));
+    }
+    if(want.count("longjump")){
+        Table t = blank("longjump", db_param(db, "longjump", "max_runup",
+                                             "SELECT MAX(sum_frozen) FROM lj_post_simple WHERE phase=1;"), false);
+        read_rules(db, t);
+        const LongJump ev({t.param});
+        each_row(db, "SELECT phase,sum_frozen,n1,n2,n3,n4,n5,n6,freeze_count FROM lj_post_simple;",
+                 [&](sqlite3_stmt* st){
+            const int k = counts_index(st, 2), sum = sqlite3_column_int(st, 1);
+            if(sum > t.param) return;
+            const int idx = sqlite3_column_int(st, 0)==lj::RUNUP_POST ? ev.runup_post(sum, k) : ev.jump_post(k);
+            t.action[idx] = uint8_t(sqlite3_column_int(st, 8));
+        });
+        out.push_back(std::move(t));
+    }
+    if(want.count("longjump_bo3")){
+        Table t = blank("longjump_bo3", db_param(db, "longjump_bo3", "max_runup",
+                                                 "SELECT MAX(sum_frozen) FROM lj_bo3_post WHERE phase=1;"), false);
+        read_rules(db, t);
+        const LongJumpBo3 ev({t.param});
+        each_row(db, "SELECT attempt,best,phase,sum_frozen,n1,n2,n3,n4,n5,n6,freeze_count FROM lj_bo3_post;",
+                 [&](sqlite3_stmt* st){
+            const int sum = sqlite3_column_int(st, 3), phase = sqlite3_column_int(st, 2);
+            if(phase==lj::RUNUP_POST && sum > t.param) return;
+            const int idx = ev.index(sqlite3_column_int(st, 0), sqlite3_column_int(st, 1), phase, sum, counts_index(st, 4));
+            t.action[idx] = uint8_t(sqlite3_column_int(st, 10));
+        });
+        out.push_back(std::move(t));
+    }
+    return out;
+}
+
+static bool is_bin(const string& path){
+    if(!filesystem::exists(path)) throw runtime_error("no such file: " + path);
+    char magic[16]{};
+    if(FILE* f = fopen(path.c_str(), "rb")){ if(fread(magic, 1, sizeof magic, f)){} fclose(f); }
+    if(memcmp(magic, policy::MAGIC, sizeof(policy::MAGIC))==0) return true;
+    if(memcmp(magic, "SQLite format 3", 16)==0) return false;
+    throw runtime_error("neither a policy file nor a SQLite DB: " + path);
+}
+
+// Events with a policy in path, read from the header or the schema only.
+static set<string> events_in(const string& path){
+    if(is_bin(path)){
+        const policy::File f(path);
+        if(f.event()==policy::EVENT_100M) return {"100m"};
+        if(f.event()==policy::EVENT_LONGJUMP) return {"longjump"};
+        throw runtime_error("unknown event in " + path);
+    }
+    sqlw::Db db(path);
+    set<string> out;
+    for(const auto& [name, table]: DB_TABLES) if(db.has_table(table)) out.insert(name);
+    if(out.empty()) throw runtime_error("no policy tables in " + path);
+    return out;
+}
+
+// The tables of path for the events in want.
+static vector<Table> load(const string& path, const set<string>& want){
+    if(is_bin(path)) return {load_bin(path)};
+    return load_db(path, want);
+}
+
+// --------------------------------------------------------------- layout
+
+// Layer of every state of the table's layout, with the layer names.
+struct Layers { vector<uint16_t> of; vector<string> names; };
+
+static Layers layers(const string& name, int param){
+    Layers L;
+    const size_t n = n_states(name, param);
+    L.of.resize(n);
+    if(name=="100m"){
+        const M100 ev({param});
+        for(int stage=1; stage<=2; ++stage)
+            for(int r=0; r<=param; ++r) L.names.push_back("stage=" + to_string(stage) + " rerolls=" + to_string(r));
+        for(size_t s=0; s<n; ++s){
+            const M100::State st = ev.state_at(int(s));
+            L.of[s] = uint16_t((st.stage-1)*(param+1) + st.rerolls);
+        }
+        return L;
+    }
+    // long jump: phase and dice rolled, per attempt for best of three
+    const int attempts = name=="longjump" ? 1 : LongJumpBo3::N_ATTEMPTS;
+    for(int a=0; a<attempts; ++a)
+        for(const char* ph: {"runup", "jump"})
+            for(int d=0; d<=lj::N_DICE; ++d)
+                L.names.push_back((attempts>1 ? "attempt=" + to_string(a) + " " : string()) + ph + " dice=" + to_string(d));
+    auto layer = [&](int a, int phase, int counts){
+        return uint16_t((a*2 + (phase==lj::JUMP_POST))*(lj::N_DICE+1) + lj::n_dice_at(counts));
+    };
+    if(name=="longjump"){
+        const LongJump ev({param});
+        for(size_t s=0; s<n; ++s){ const auto p = ev.post_at(int(s)); L.of[s] = layer(0, p.phase, p.counts); }
+    } else {
+        const LongJumpBo3 ev({param});
+        for(size_t s=0; s<n; ++s){ const auto p = ev.post_at(int(s)); L.of[s] = layer(p.attempt, p.phase, p.counts); }
+    }
+    return L;
+}
+
+// Index in a layout with parameter `to` of every state of the layout with
+// `from` (<= to), which it contains.
+static vector<uint32_t> embed(const string& name, int from, int to){
+    const size_t n = n_states(name, from);
+    vector<uint32_t> at(n);
+    if(name=="100m"){
+        const M100 small({from}), big({to});
+        for(size_t s=0; s<n; ++s) at[s] = uint32_t(big.state_index(small.state_at(int(s))));
+    } else if(name=="longjump"){
+        const LongJump small({from}), big({to});
+        for(size_t s=0; s<n; ++s){
+            const auto p = small.post_at(int(s));
+            at[s] = uint32_t(p.phase==lj::RUNUP_POST ? big.runup_post(p.sum_frozen, p.counts) : big.jump_post(p.counts));
+        }
+    } else {
+        const LongJumpBo3 small({from}), big({to});
+        for(size_t s=0; s<n; ++s){
+            const auto p = small.post_at(int(s));
+            at[s] = uint32_t(big.index(p.attempt, p.best, p.phase, p.sum_frozen, p.counts));
+        }
+    }
+    return at;
+}
+
+// t restricted to the states of the layout with parameter `param`.
+static Table restrict(const Table& t, int param){
+    if(param == t.param) return t;
+    const vector<uint32_t> at = embed(t.name, param, t.param);
+    Table r = t;
+    r.param = param;
+    auto gather = [&](vector<double>& v){ if(!v.empty()){ vector<double> g(at.size()); for(size_t s=0; s<at.size(); ++s) g[s] = v[at[s]]; v = std::move(g); } };
+    r.action.resize(at.size());
+    for(size_t s=0; s<at.size(); ++s) r.action[s] = t.action[at[s]];
+    gather(r.ev); gather(r.sd);
+    for(auto& v: r.aev) gather(v);
+    return r;
+}
+
+// --------------------------------------------------------------- compare
+
+struct Stat {
+    int64_t states = 0, flips = 0, ties = 0, missing = 0;
+    double max_dev = 0, sum_dev = 0, max_dsd = 0, sum_dsd = 0;
+    int64_t n_dev = 0;
+    int64_t worst = -1;          // state with the largest |dEV|
+
+    void merge(const Stat& o){
+        states += o.states; flips += o.flips; ties += o.ties; missing += o.missing;
+        if(o.max_dev > max_dev){ max_dev = o.max_dev; worst = o.worst; }
+        sum_dev += o.sum_dev; max_dsd = max(max_dsd, o.max_dsd); sum_dsd += o.sum_dsd; n_dev += o.n_dev;
+    }
+};
+
+// Prints the per-layer report; true if anything is beyond tolerance.
+static bool compare(const Table& a, const Table& b, double tol, double sd_tol, bool quiet){
+    const size_t n = a.action.size();
+    const Layers L = layers(a.name, a.param);
+    vector<Stat> per(L.names.size());
+    const bool moments = !a.ev.empty() && !b.ev.empty();
+    const bool ties = !a.aev[0].empty();
+
+    par::Stopwatch clock;
+    // |dEV| and |dSD| first, in a branch-free pass over the arrays
+    vector<double> dev, dsd;
+    if(moments){
+        dev.resize(n); dsd.resize(n);
+        for(size_t s=0; s<n; ++s){
+            const double e = fabs(a.ev[s] - b.ev[s]), d = fabs(a.sd[s] - b.sd[s]);
+            dev[s] = e == e ? e : 0.0;           // NaN on either side: counted as missing below
+            dsd[s] = d == d ? d : 0.0;
+        }
+    }
+    for(size_t s=0; s<n; ++s){
+        if(a.action[s]==NONE && b.action[s]==NONE) continue;
+        Stat& st = per[L.of[s]];
+        ++st.states;
+        if(a.action[s] != b.action[s]){
+            ++st.flips;
+            const uint8_t x = a.action[s], y = b.action[s];
+            if(ties && x < M100::N_ACTIONS && y < M100::N_ACTIONS && fabs(a.aev[x][s] - a.aev[y][s]) <= tol) ++st.ties;
+        }
+        if(!moments) continue;
+        if(isnan(a.ev[s]) != isnan(b.ev[s]) || isnan(a.sd[s]) != isnan(b.sd[s])) ++st.missing;
+        if(dev[s] > st.max_dev){ st.max_dev = dev[s]; st.worst = int64_t(s); }
+        st.sum_dev += dev[s]; st.max_dsd = max(st.max_dsd, dsd[s]); st.sum_dsd += dsd[s];
+        ++st.n_dev;
+    }
+    const double ms = clock.ms();
+
+    auto failing = [&](const Stat& st){
+        return st.flips > st.ties || st.missing > 0 || st.max_dev > tol || st.max_dsd > sd_tol;
+    };
+    auto line = [&](const string& label, const Stat& st){
+        printf("%-24s %9lld %7lld %6lld", label.c_str(), (long long)st.states, (long long)st.flips, (long long)st.ties);
+        if(moments) printf(" %11.3g %11.3g %11.3g %11.3g", st.max_dev, st.n_dev ? st.sum_dev/st.n_dev : 0.0,
+                           st.max_dsd, st.n_dev ? st.sum_dsd/st.n_dev : 0.0);
+        printf("%s\n", failing(st) ? "  !" : "");
+    };
+
+    printf("%s: %zu states (layout %s=%d)", a.name.c_str(), n, a.name=="100m" ? "max_rerolls" : "max_runup", a.param);
+    if(a.rules_hash && b.rules_hash) printf(", rules %s", a.rules_hash==b.rules_hash ? "match" : "differ");
+    printf("\n%-24s %9s %7s %6s", "layer", "states", "flips", "ties");
+    if(moments) printf(" %11s %11s %11s %11s", "max|dEV|", "mean|dEV|", "max|dSD|", "mean|dSD|");
+    printf("\n");
+    Stat total;
+    for(size_t l=0; l<per.size(); ++l){
+        if(per[l].states == 0) continue;
+        if(!quiet) line(L.names[l], per[l]);
+        total.merge(per[l]);
+    }
+    line("total", total);
+    if(total.missing) printf("moments only in one: %lld states\n", (long long)total.missing);
+    if(moments && total.worst >= 0 && total.max_dev > 0)
+        printf("worst |dEV| at state %lld: EV %.9f vs %.9f\n", (long long)total.worst, a.ev[total.worst], b.ev[total.worst]);
+    if(!moments) printf("(no moments to compare: actions only)\n");
+    printf("compared in %.3f ms\n", ms);
+    return failing(total);
+}
+
+int main(int argc, char** argv){
+    vector<string> paths;
+    double tol = 1e-9, sd_tol = -1;
+    bool quiet = false;
+    for(int i=1; i<argc; ++i){
+        string a = argv[i];
+        if(a=="--tol" && i+1<argc) tol = atof(argv[++i]);
+        else if(a=="--sd-tol" && i+1<argc) sd_tol = atof(argv[++i]);
+        else if(a=="--quiet") quiet = true;
+        else if(a.rfind("--",0)==0){ fprintf(stderr,"unknown option %s\n", a.c_str()); return 1; }
+        else paths.push_back(a);
+    }
+    if(paths.size()!=2){ fprintf(stderr,"usage: policy_diff A B [--tol EV] [--sd-tol SD] [--quiet]\n"); return 1; }
+    if(sd_tol < 0) sd_tol = tol;
+
+    try {
+        par::Stopwatch clock;
+        const set<string> ea = events_in(paths[0]), eb = events_in(paths[1]);
+        set<string> common;
+        set_intersection(ea.begin(), ea.end(), eb.begin(), eb.end(), inserter(common, common.end()));
+        if(common.empty()){ fprintf(stderr,"%s and %s have no event in common\n", paths[0].c_str(), paths[1].c_str()); return 1; }
+        const vector<Table> A = load(paths[0], common), B = load(paths[1], common);
+        const double load_ms = clock.ms();
+        bool differ = false, any = false;
+        for(const Table& a: A)
+            for(const Table& b: B){
+                if(a.name != b.name) continue;
+                if(any) printf("\n");
+                any = true;
+                const int param = min(a.param, b.param);
+                if(a.param != b.param)
+                    printf("%s: layouts differ (%d vs %d), comparing the states they share\n", a.name.c_str(), a.param, b.param);
+                differ |= compare(restrict(a, param), restrict(b, param), tol, sd_tol, quiet);
+            }
+        printf("loaded in %.3f ms; %s\n", load_ms, differ ? "DIFFERENT" : "same within tolerance");
+        return differ ? 3 : 0;
+    } catch(const exception& e){
+        fprintf(stderr,"%s\n", e.what());
+        return 2;
+    }
+}
@@ -0,0 +1,66 @@
+// Policy tables compiled into the program.
+//
+// policy_header turns a binary policy file into a header of constexpr arrays
+// plus one policy::Embedded describing them, so a bot or client can link the
+// policy statically: no file, no mmap, no SQLite at startup. The lookups are
+// those of libdecathlon_policy (decathlon_policy.h) over the same perfect
+// state index (policy::m100::index, policy::longjump::index), and they are
+// constexpr, so a policy can also be queried at compile time.
+//
+// As in the file: a folded 100m table (FLAG_SET1_OFFSET) stores stage 2 once
+// per (rerolls, dice) and adds set1_score to the EV; a table generated from a
+// compact file has the moments of the stored action only (best_only), to
+// within 1/512.
+#pragma once
+#include <cstdint>
+
+#include "policy_format.hpp"
+
+namespace policy {
+
+struct Embedded {
+    Event event;
+    uint32_t flags;                // Flags of the source file
+    uint64_t rules_hash;
+    double root_ev, root_sd;
+    int64_t n_stored;              // rows of every array
+    const uint8_t* action;         // NO_ACTION where unreachable
+    int n_actions;                 // entries of ev/sd; 0: no moments
+    const double* const* ev;       // ev[a][row], nullptr if action a has none; NaN where a is illegal
+    const double* const* sd;
+    bool best_only;                // ev[0]/sd[0] are the stored action's moments, whatever it is
+
+    constexpr bool folded() const { return flags & FLAG_SET1_OFFSET; }
+
+    // Number of valid state indices (more than n_stored when folded).
+    constexpr int64_t n_index() const { return folded() ? n_stored / 2 * (1 + m100::N_S1) : n_stored; }
+    constexpr bool valid(int64_t s) const { return s >= 0 && s < n_index(); }
+
+    // State index -> row and the score to add to its EV.
+    constexpr m100::Stored row(int64_t s) const {
+        return folded() ? m100::stored_index(s, n_stored / 2) : m100::Stored{s, 0};
+    }
+
+    // Best action at s, or -1 if s is invalid or unreachable.
+    constexpr int best(int64_t s) const {
+        if(!valid(s)) return -1;
+        const uint8_t a = action[row(s).index];
+        return a == longjump::NO_ACTION ? -1 : a;
+    }
+
+    // Moments of taking action a at s; false if a is not available there or
+    // the table has no moments for it.
+    constexpr bool moments(int64_t s, int a, double& e, double& d) const {
+        if(!valid(s) || a < 0) return false;
+        const auto [i, offset] = row(s);
+        const int col = best_only ? 0 : a;
+        if((best_only && a != best(s)) || col >= n_actions || !ev[col]) return false;
+        const double x = ev[col][i];
+        if(x != x) return false;               // NaN: not legal (std::isnan is not constexpr)
+        e = x + offset;
+        d = sd[col][i];
+        return true;
+    }
+};
+
+} // namespace policy
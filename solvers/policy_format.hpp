@@ -0,0 +1,440 @@
+// Versioned, fixed-layout binary policy file written alongside the SQLite DBs.
+//
+// Layout (little-endian throughout):
+//   Header                      64 bytes
+//   Section[n_sections]         24 bytes each
+//   payloads                    each starting on a 64-byte boundary
+//
+// Every per-state section is a dense array indexed by the event's perfect
+// state index (policy::m100::index, policy::longjump::index), so a reader can
+// mmap the file and answer a lookup with one array access and no parsing.
+// Files are written to "<path>.tmp" and renamed into place, so readers never
+// observe a partially written policy.
+//
+// A compact file (FLAG_COMPACT, written with Encoding COMPACT) replaces the
+// u8 actions with a bit-packed array (SEC_ACTION_BITS) and the per-action f64
+// moments with int16 fixed-point moments of the stored action only
+// (SEC_EV_Q/SEC_SD_Q, steps of Q_STEP = 1/256, so the error is at most 1/512).
+// The 100m then takes 1 bit + 4 bytes per state instead of 33 bytes, the long
+// jump 3 bits. Such files are version 2; plain files stay version 1, so older
+// readers refuse compact files instead of misreading them. File::actions()
+// decodes either encoding.
+//
+// A folded 100m file (FLAG_SET1_OFFSET, see m100::stored_index) is version 3
+// whatever its encoding: a reader that does not know the flag would take the
+// folded rows for the full table and return wrong values without an error.
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "dice_outcomes.hpp"
+
+namespace policy {
+
+static_assert(std::endian::native == std::endian::little,
+              "policy files are little-endian and mapped without conversion");
+
+inline constexpr char     MAGIC[8] = {'D','D','P','O','L','I','C','Y'};
+inline constexpr uint32_t VERSION  = 3;   // newest version read; files record the oldest that can read them
+
+enum Flags : uint32_t {
+    FLAG_COMPACT     = 1,
+    FLAG_SET1_OFFSET = 2,  // 100m: stage 2 stored once per (rerolls, pattern), see m100::stored_index
+};
+enum Encoding { FULL, COMPACT };
+
+enum Event : uint32_t { EVENT_100M = 1, EVENT_LONGJUMP = 2 };
+
+enum SectionId : uint32_t {
+    SEC_ACTION = 1,        // u8 per state: chosen action code
+    SEC_EV     = 0x100,    // f64 per state: EV of action a is section SEC_EV + a (NaN if unavailable)
+    SEC_SD     = 0x200,    // f64 per state: SD of action a is section SEC_SD + a
+    SEC_ACTION_BITS = 0x10,// u64 words: action codes of SEC_ACTION, `bits` each, LSB first;
+                           // section SEC_ACTION_BITS + bits, or + 0x10 + bits if the
+                           // all-ones code stands for longjump::NO_ACTION
+    SEC_EV_Q   = 0x300,    // i16 per state: EV of the stored action in units of Q_STEP, Q_NAN if none
+    SEC_SD_Q   = 0x301,    // i16 per state: its SD
+};
+
+constexpr uint32_t ev_section(int action){ return SEC_EV + uint32_t(action); }
+constexpr uint32_t sd_section(int action){ return SEC_SD + uint32_t(action); }
+constexpr uint32_t packed_action_section(int bits, bool has_none){
+    return SEC_ACTION_BITS + (has_none ? 0x10 : 0) + uint32_t(bits);
+}
+
+enum ElemType : uint32_t { ELEM_U8 = 1, ELEM_F64 = 2, ELEM_I16 = 3, ELEM_U64 = 4 };
+
+template<class T> constexpr ElemType elem_type();
+template<> constexpr ElemType elem_type<uint8_t>(){ return ELEM_U8; }
+template<> constexpr ElemType elem_type<double>(){ return ELEM_F64; }
+template<> constexpr ElemType elem_type<int16_t>(){ return ELEM_I16; }
+template<> constexpr ElemType elem_type<uint64_t>(){ return ELEM_U64; }
+
+inline constexpr size_t elem_size(uint32_t e){
+    return e==ELEM_U8 ? 1 : e==ELEM_F64 ? 8 : e==ELEM_I16 ? 2 : e==ELEM_U64 ? 8 : 0;
+}
+inline constexpr uint32_t elem_version(uint32_t e){ return e==ELEM_U8 || e==ELEM_F64 ? 1 : 2; }
+inline constexpr uint32_t flags_version(uint32_t f){ return f & FLAG_SET1_OFFSET ? 3 : f & FLAG_COMPACT ? 2 : 1; }
+
+// ------------------------------------------------------------ compact values
+
+inline constexpr double  Q_STEP = 1.0 / 256;
+inline constexpr int16_t Q_NAN  = INT16_MIN;
+
+// Throws if v is outside the representable range (about +-128).
+inline int16_t quantize(double v){
+    if(std::isnan(v)) return Q_NAN;
+    double q = std::nearbyint(v / Q_STEP);
+    if(!(q > INT16_MIN && q <= INT16_MAX)) throw std::runtime_error("value out of range for the compact policy encoding");
+    return int16_t(q);
+}
+constexpr double dequantize(int16_t q){ return q==Q_NAN ? NAN : q * Q_STEP; }
+
+// Action codes packed `bits` to a state. With has_none, NO_ACTION (0xff) is
+// stored as the all-ones code, which no ordinary action may use.
+struct PackedActions {
+    std::vector<uint64_t> words;
+    int bits = 0;
+    bool has_none = false;
+};
+
+inline PackedActions pack_actions(std::span<const uint8_t> act){
+    PackedActions p;
+    int top = 0;
+    for(uint8_t a: act){ if(a==0xff) p.has_none = true; else top = std::max(top, int(a)); }
+    p.bits = std::max(1, int(std::bit_width(unsigned(top + p.has_none))));
+    if(p.bits > 8) throw std::runtime_error("action code too large to pack");
+    const uint64_t none = (uint64_t(1) << p.bits) - 1;
+    p.words.assign((act.size()*p.bits + 63) / 64, 0);
+    for(size_t s=0; s<act.size(); ++s){
+        uint64_t v = act[s]==0xff ? none : act[s], bit = s*p.bits;
+        p.words[bit/64] |= v << bit%64;
+        if(bit%64 + p.bits > 64) p.words[bit/64 + 1] |= v >> (64 - bit%64);
+    }
+    return p;
+}
+
+// Read-only view of the action codes of either encoding.
+class ActionCodes {
+public:
+    ActionCodes() = default;
+    explicit ActionCodes(std::span<const uint8_t> bytes) : bytes_(bytes), n_(bytes.size()) {}
+    ActionCodes(std::span<const uint64_t> words, uint64_t n, int bits, bool has_none)
+        : words_(words), n_(n), bits_(bits), none_(has_none ? (uint64_t(1) << bits) - 1 : ~uint64_t(0)) {}
+
+    uint64_t size() const { return n_; }
+
+    uint8_t operator[](uint64_t s) const {
+        if(!bits_) return bytes_[s];
+        const uint64_t bit = s*bits_, o = bit%64;
+        uint64_t v = words_[bit/64] >> o;
+        if(o + bits_ > 64) v |= words_[bit/64 + 1] << (64 - o);
+        v &= (uint64_t(1) << bits_) - 1;
+        return v==none_ ? 0xff : uint8_t(v);
+    }
+
+private:
+    std::span<const uint8_t> bytes_;
+    std::span<const uint64_t> words_;
+    uint64_t n_ = 0;
+    int bits_ = 0;                 // 0: one byte per state
+    uint64_t none_ = 0;
+};
+
+struct Header {
+    char     magic[8];
+    uint32_t version;
+    uint32_t event;        // Event
+    uint64_t n_states;     // length of every per-state section
+    uint32_t n_sections;
+    uint32_t flags;        // Flags
+    double   root_ev;      // expected score of the whole event under the policy
+    double   root_sd;
+    uint64_t file_size;
+    uint64_t rules_hash;   // rules::Fingerprint::hash of the rules solved, 0 if not recorded
+};
+static_assert(sizeof(Header)==64);
+
+struct Section {
+    uint32_t id;           // SectionId
+    uint32_t elem;         // ElemType
+    uint64_t offset;       // from start of file
+    uint64_t count;        // number of elements
+};
+static_assert(sizeof(Section)==24);
+
+// ---------------------------------------------------------------- state index
+
+// 100m: same layout as the solver table (see event_100m.hpp). The layout
+// depends on the reroll budget; the defaults are the standard rules.
+namespace m100 {
+    inline constexpr int MAX_REROLLS = 5;
+    inline constexpr int N_PATTERNS  = dice::n_outcomes(4);
+    inline constexpr int S1_MIN = -24, S1_MAX = 20, N_S1 = S1_MAX - S1_MIN + 1;
+    constexpr int n_stage1(int max_rerolls = MAX_REROLLS){ return (max_rerolls+1) * N_PATTERNS; }
+    constexpr int n_states(int max_rerolls = MAX_REROLLS){ return n_stage1(max_rerolls) * (1 + N_S1); }
+    inline constexpr int N_STAGE1 = n_stage1();
+    inline constexpr int N_STATES = n_states();
+    enum Action : uint8_t { FREEZE = 0, REROLL = 1 };
+
+    // dice in any order; set1_score is ignored for stage 1. Returns -1 if out of range.
+    constexpr int index(int stage, int rerolls, const int dice[4], int set1_score,
+                        int max_rerolls = MAX_REROLLS){
+        uint8_t count[7]{};
+        for(int i=0; i<4; ++i){ if(dice[i]<1 || dice[i]>6) return -1; count[dice[i]]++; }
+        if(rerolls<0 || rerolls>max_rerolls) return -1;
+        int base = rerolls*N_PATTERNS + dice::pattern_rank(count);
+        if(stage==1) return base;
+        if(stage!=2 || set1_score<S1_MIN || set1_score>S1_MAX) return -1;
+        return n_stage1(max_rerolls) + base*N_S1 + (set1_score - S1_MIN);
+    }
+
+    // In a FLAG_SET1_OFFSET file (n_states = 2*n_stage1) stage 2 holds the
+    // moments of set 2 alone: index() maps to `index` there, and the EV is
+    // that plus `offset` (the set1 score). The SD and the action are as stored.
+    struct Stored { int64_t index; int offset; };
+    constexpr Stored stored_index(int64_t idx, int64_t n_stage1){
+        if(idx < n_stage1) return {idx, 0};
+        const int64_t j = idx - n_stage1;
+        return {n_stage1 + j / N_S1, int(j % N_S1) + S1_MIN};
+    }
+}
+
+// Long jump post-roll decision states:
+//   RUNUP_POST: (sum_frozen 0..max_runup, counts of the rolled dice) -> [0, N_RUNUP)
+//   JUMP_POST : (counts of the rolled dice)                          -> [N_RUNUP, N_STATES)
+// counts are ranked with dice::multiset_index over 0..5 dice.
+namespace longjump {
+    inline constexpr int N_DICE    = 5;
+    inline constexpr int MAX_RUNUP = 8;
+    inline constexpr int N_COUNTS  = dice::n_multisets(N_DICE);
+    constexpr int n_runup(int max_runup = MAX_RUNUP){ return (max_runup+1) * N_COUNTS; }
+    constexpr int n_states(int max_runup = MAX_RUNUP){ return n_runup(max_runup) + N_COUNTS; }
+    inline constexpr int N_RUNUP   = n_runup();
+    inline constexpr int N_STATES  = n_states();
+    enum Phase : int { RUNUP_POST = 1, JUMP_POST = 3 };
+    inline constexpr uint8_t NO_ACTION = 0xff;   // unreachable state
+
+    // count[face] for face 1..6. Returns -1 if out of range.
+    constexpr int index(int phase, int sum_frozen, const int count[7], int max_runup = MAX_RUNUP){
+        uint8_t c[7]{};
+        int n = 0;
+        for(int f=1; f<=6; ++f){ if(count[f]<0) return -1; c[f] = count[f]; n += count[f]; }
+        if(n>N_DICE) return -1;
+        int k = dice::multiset_index(c);
+        if(phase==JUMP_POST) return n_runup(max_runup) + k;
+        if(phase!=RUNUP_POST || sum_frozen<0 || sum_frozen>max_runup) return -1;
+        return sum_frozen*N_COUNTS + k;
+    }
+}
+
+// The reroll budget (100m) or run-up limit (long jump) whose state index a
+// file with this header is laid out for, told from n_states and the flags;
+// -1 if n_states fits no layout of the event.
+inline int layout_param(const Header& h){
+    if(h.n_states > uint64_t(INT_MAX)) return -1;
+    const int64_t n = int64_t(h.n_states);
+    if(h.event==EVENT_100M){
+        const int64_t stage1 = h.flags & FLAG_SET1_OFFSET ? n/2 : n/(1 + m100::N_S1);
+        const int64_t r = stage1 / m100::N_PATTERNS - 1;
+        if(r < 0 || n != (h.flags & FLAG_SET1_OFFSET ? 2*stage1 : m100::n_states(int(r)))
+           || stage1 != m100::n_stage1(int(r))) return -1;
+        return int(r);
+    }
+    if(h.event==EVENT_LONGJUMP){
+        const int64_t r = n / longjump::N_COUNTS - 2;
+        if(r < 0 || n != longjump::n_states(int(r))) return -1;
+        return int(r);
+    }
+    return -1;
+}
+
+// --------------------------------------------------------------------- writer
+
+class Writer {
+public:
+    Writer(Event event, uint64_t n_states) : event_(event), n_states_(n_states) {}
+
+    void set_root(double ev, double sd){ root_ev_ = ev; root_sd_ = sd; }
+    void set_rules_hash(uint64_t h){ rules_hash_ = h; }
+    void set_flags(uint32_t f){ flags_ = f; }
+
+    // The data is not copied; it must stay alive until write().
+    template<class T>
+    void add(uint32_t id, std::span<const T> data){
+        secs_.push_back({id, elem_type<T>(), data.data(), data.size()});
+    }
+
+    void write(const std::string& path) const {
+        Header h{};
+        memcpy(h.magic, MAGIC, sizeof(MAGIC));
+        h.version = flags_version(flags_);
+        for(auto& s: secs_) h.version = std::max(h.version, elem_version(s.elem));
+        h.event = event_;
+        h.n_states = n_states_;
+        h.n_sections = uint32_t(secs_.size());
+        h.flags = flags_;
+        h.root_ev = root_ev_;
+        h.root_sd = root_sd_;
+        h.rules_hash = rules_hash_;
+
+        std::vector<Section> table;
+        uint64_t off = align(sizeof(Header) + secs_.size()*sizeof(Section));
+        for(auto& s: secs_){
+            table.push_back({s.id, s.elem, off, s.count});
+            off = align(off + s.count*elem_size(s.elem));
+        }
+        h.file_size = off;
+
+        std::string tmp = path + ".tmp";
+        FILE* f = fopen(tmp.c_str(), "wb");
+        if(!f) throw std::runtime_error("cannot create " + tmp);
+        bool ok = fwrite(&h, sizeof(h), 1, f)==1;
+        if(!table.empty()) ok = ok && fwrite(table.data(), sizeof(Section), table.size(), f)==table.size();
+        for(size_t i=0; ok && i<secs_.size(); ++i){
+            ok = pad_to(f, table[i].offset);
+            size_t bytes = secs_[i].count*elem_size(secs_[i].elem);
+            ok = ok && fwrite(secs_[i].data, 1, bytes, f)==bytes;
+        }
+        ok = ok && pad_to(f, h.file_size);
+        ok = (fclose(f)==0) && ok;
+        if(!ok || rename(tmp.c_str(), path.c_str())!=0){
+            remove(tmp.c_str());
+            throw std::runtime_error("failed writing policy file " + path);
+        }
+    }
+
+private:
+    struct Pending { uint32_t id, elem; const void* data; uint64_t count; };
+    static uint64_t align(uint64_t x){ return (x + 63) & ~uint64_t(63); }
+    static bool pad_to(FILE* f, uint64_t off){
+        static const char zeros[64]{};
+        long pos = ftell(f);
+        if(pos<0 || uint64_t(pos)>off) return false;
+        for(uint64_t left = off - uint64_t(pos); left; ){
+            size_t n = left < sizeof(zeros) ? size_t(left) : sizeof(zeros);
+            if(fwrite(zeros, 1, n, f)!=n) return false;
+            left -= n;
+        }
+        return true;
+    }
+
+    Event event_;
+    uint64_t n_states_;
+    double root_ev_ = NAN, root_sd_ = NAN;
+    uint64_t rules_hash_ = 0;
+    uint32_t flags_ = 0;
+    std::vector<Pending> secs_;
+};
+
+// --------------------------------------------------------------------- reader
+
+// Read-only mmap of a policy file. Sections are returned as spans into the
+// mapping and stay valid for the lifetime of the File.
+class File {
+public:
+    explicit File(const std::string& path){
+        int fd = open(path.c_str(), O_RDONLY);
+        if(fd<0) throw std::runtime_error("cannot open " + path);
+        struct stat st{};
+        if(fstat(fd, &st)!=0 || st.st_size < (off_t)sizeof(Header)){
+            close(fd); throw std::runtime_error("not a policy file: " + path);
+        }
+        size_ = size_t(st.st_size);
+        void* p = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if(p==MAP_FAILED) throw std::runtime_error("mmap failed: " + path);
+        base_ = static_cast<const uint8_t*>(p);
+        std::string err = validate();
+        if(!err.empty()){ unmap(); throw std::runtime_error(err + ": " + path); }
+    }
+    ~File(){ unmap(); }
+    File(const File&) = delete;
+    File& operator=(const File&) = delete;
+    File(File&& o) noexcept : base_(o.base_), size_(o.size_) { o.base_ = nullptr; o.size_ = 0; }
+
+    const Header& header() const { return *reinterpret_cast<const Header*>(base_); }
+    Event event() const { return Event(header().event); }
+    uint64_t n_states() const { return header().n_states; }
+
+    std::span<const Section> sections() const {
+        return {reinterpret_cast<const Section*>(base_ + sizeof(Header)), header().n_sections};
+    }
+
+    // Empty span if the section is absent; throws if it has a different element type.
+    template<class T>
+    std::span<const T> section(uint32_t id) const {
+        for(const Section& s: sections()){
+            if(s.id!=id) continue;
+            if(s.elem!=elem_type<T>()) throw std::runtime_error("policy section has unexpected type");
+            return {reinterpret_cast<const T*>(base_ + s.offset), size_t(s.count)};
+        }
+        return {};
+    }
+
+    bool compact() const { return header().flags & FLAG_COMPACT; }
+
+    // The action codes, packed or not; empty if the file stores none.
+    ActionCodes actions() const {
+        if(auto a = section<uint8_t>(SEC_ACTION); !a.empty()) return ActionCodes(a);
+        for(const Section& s: sections()){
+            const uint32_t rel = s.id - SEC_ACTION_BITS, bits = rel & 0xf;
+            if(s.id < SEC_ACTION_BITS || rel > 0x1f || bits < 1 || bits > 8) continue;
+            auto words = section<uint64_t>(s.id);
+            if(words.size() < (n_states()*bits + 63) / 64) throw std::runtime_error("packed action section too short");
+            return ActionCodes(words, n_states(), int(bits), rel & 0x10);
+        }
+        return {};
+    }
+
+private:
+    std::string validate() const {
+        const Header& h = header();
+        if(memcmp(h.magic, MAGIC, sizeof(MAGIC))!=0) return "bad policy magic";
+        if(h.version<1 || h.version>VERSION) return "unsupported policy version";
+        if(h.file_size!=size_) return "truncated policy file";
+        if(sizeof(Header) + uint64_t(h.n_sections)*sizeof(Section) > size_) return "corrupt section table";
+        for(const Section& s: sections()){
+            uint64_t es = elem_size(s.elem);
+            if(es==0 || s.offset%64 || s.offset > size_ || s.count > (size_ - s.offset)/es)
+                return "corrupt policy section";
+        }
+        return {};
+    }
+    void unmap(){ if(base_) munmap(const_cast<uint8_t*>(base_), size_); base_ = nullptr; }
+
+    const uint8_t* base_ = nullptr;
+    size_t size_ = 0;
+};
+
+// rules_hash of an existing policy file; 0 if it is missing, unreadable or
+// has none recorded (or, with `encoding` and `layout`, is not in that
+// encoding or does not have the FLAG_SET1_OFFSET bit of `layout`).
+inline uint64_t stored_rules_hash(const std::string& path){
+    try { return File(path).header().rules_hash; }
+    catch(const std::exception&){ return 0; }
+}
+inline uint64_t stored_rules_hash(const std::string& path, Encoding encoding, uint32_t layout = 0){
+    try {
+        File f(path);
+        const bool same = f.compact() == (encoding == COMPACT) &&
+                          (f.header().flags & FLAG_SET1_OFFSET) == (layout & FLAG_SET1_OFFSET);
+        return same ? f.header().rules_hash : 0;
+    } catch(const std::exception&){ return 0; }
+}
+
+} // namespace policy
@@ -0,0 +1,146 @@
+// g++ -O3 -std=c++20 solvers/policy_header.cpp -o solvers/policy_header
+// Usage: ./policy_header POLICY.bin OUT.hpp [--namespace NAME] [--no-moments]
+//
+// Writes a binary policy file (either event, any encoding) as a C++ header of
+// constexpr arrays and a policy::Embedded over them (policy_embedded.hpp), so
+// a client can compile the policy in instead of opening the file:
+//
+//   #include "100m_policy.gen.hpp"          // compile with -Isolvers
+//   int s = embedded::m100::index(2, 3, dice, set1_score);
+//   int a = embedded::m100::POLICY.best(s);
+//
+// The arrays are the file's sections as stored, so a folded 100m file stays
+// folded (1512 rows instead of 34776). Packed actions are widened to a byte
+// and compact moments dequantized; every double is written as a hex float,
+// so the values are the file's bit for bit. The namespace defaults to
+// embedded::m100 or embedded::longjump; index() there is the event's
+// policy::*::index for the layout in the file. --no-moments keeps the actions
+// only.
+#include <bits/stdc++.h>
+#include "policy_format.hpp"
+using namespace std;
+
+static constexpr int MAX_ACTIONS = 8;   // action codes with per-action moment sections, as decathlon_policy.cpp
+
+static string hex_double(double x){
+    if(isnan(x)) return "NaN";
+    if(isinf(x)) return x > 0 ? "std::numeric_limits<double>::infinity()" : "-std::numeric_limits<double>::infinity()";
+    char buf[40];
+    snprintf(buf, sizeof buf, "%a", x);
+    return buf;
+}
+
+template<class F>
+static void write_array(FILE* f, const char* type, const string& name, int64_t n, int per_line, F&& item){
+    fprintf(f, "inline constexpr %s %s[%lld] = {", type, name.c_str(), (long long)n);
+    for(int64_t i=0; i<n; ++i){
+        fprintf(f, "%s%s", i % per_line ? " " : "\n    ", item(i).c_str());
+        if(i+1 < n) fputc(',', f);
+    }
+    fprintf(f, "\n};\n");
+}
+
+int main(int argc, char** argv){
+    vector<string> paths;
+    string ns;
+    bool moments = true;
+    for(int i=1; i<argc; ++i){
+        string a = argv[i];
+        if(a=="--namespace" && i+1<argc) ns = argv[++i];
+        else if(a=="--no-moments") moments = false;
+        else if(a.rfind("--",0)==0){ fprintf(stderr,"unknown option %s\n", a.c_str()); return 1; }
+        else paths.push_back(a);
+    }
+    if(paths.size()!=2){ fprintf(stderr,"usage: policy_header POLICY.bin OUT.hpp [--namespace NAME] [--no-moments]\n"); return 1; }
+
+    try {
+        const policy::File file(paths[0]);
+        const policy::Header& h = file.header();
+        const int64_t n = int64_t(file.n_states());
+        const policy::ActionCodes act = file.actions();
+        if(act.size() != uint64_t(n)) throw runtime_error("policy file has no action section: " + paths[0]);
+
+        // layout parameter and index() of the event
+        string event, layout, index_fn;
+        if(file.event()==policy::EVENT_100M){
+            const int64_t n_stage1 = h.flags & policy::FLAG_SET1_OFFSET ? n/2 : n/(1 + policy::m100::N_S1);
+            const int r = int(n_stage1 / policy::m100::N_PATTERNS) - 1;
+            if(r < 0 || n_stage1 % policy::m100::N_PATTERNS ||
+               n != (h.flags & policy::FLAG_SET1_OFFSET ? 2*n_stage1 : policy::m100::n_states(r)))
+                throw runtime_error("unexpected 100m layout: " + paths[0]);
+            event = "m100";
+            layout = "inline constexpr int MAX_REROLLS = " + to_string(r) + ";\n";
+            index_fn = "// policy::m100::index for this table's reroll budget.\n"
+                       "constexpr int index(int stage, int rerolls, const int dice[4], int set1_score){\n"
+                       "    return policy::m100::index(stage, rerolls, dice, set1_score, MAX_REROLLS);\n}\n";
+        } else if(file.event()==policy::EVENT_LONGJUMP){
+            const int r = int(n / policy::longjump::N_COUNTS) - 2;
+            if(r < 0 || n != policy::longjump::n_states(r)) throw runtime_error("unexpected long jump layout: " + paths[0]);
+            event = "longjump";
+            layout = "inline constexpr int MAX_RUNUP = " + to_string(r) + ";\n";
+            index_fn = "// policy::longjump::index for this table's run-up limit; count[face] for face 1..6.\n"
+                       "constexpr int index(int phase, int sum_frozen, const int count[7]){\n"
+                       "    return policy::longjump::index(phase, sum_frozen, count, MAX_RUNUP);\n}\n";
+        } else throw runtime_error("unknown event in " + paths[0]);
+        if(ns.empty()) ns = "embedded::" + event;
+
+        // moment columns: per action, or the stored action's (compact)
+        vector<vector<double>> ev, sd;
+        const bool best_only = moments && file.compact();
+        if(best_only){
+            const auto ev_q = file.section<int16_t>(policy::SEC_EV_Q), sd_q = file.section<int16_t>(policy::SEC_SD_Q);
+            if(!ev_q.empty()){
+                if(ev_q.size() != size_t(n) || sd_q.size() != size_t(n)) throw runtime_error("inconsistent moment sections");
+                ev.emplace_back(n); sd.emplace_back(n);
+                for(int64_t s=0; s<n; ++s){ ev[0][s] = policy::dequantize(ev_q[s]); sd[0][s] = policy::dequantize(sd_q[s]); }
+            }
+        } else if(moments)
+            for(int a=0; a<MAX_ACTIONS; ++a){
+                const auto e = file.section<double>(policy::ev_section(a)), d = file.section<double>(policy::sd_section(a));
+                if(e.size() != d.size() || (!e.empty() && e.size() != size_t(n))) throw runtime_error("inconsistent moment sections");
+                if(e.empty()) continue;
+                ev.resize(a+1); sd.resize(a+1);
+                ev[a].assign(e.begin(), e.end()); sd[a].assign(d.begin(), d.end());
+            }
+
+        const string tmp = paths[1] + ".tmp";
+        FILE* f = fopen(tmp.c_str(), "w");
+        if(!f) throw runtime_error("cannot write " + tmp);
+        fprintf(f, "// Generated by policy_header from %s; do not edit.\n", filesystem::path(paths[0]).filename().c_str());
+        fprintf(f, "// %s policy, rules_hash %016llx, root EV %.6f SD %.6f; %lld rows%s, %s.\n",
+                event=="m100" ? "100m" : "Long jump", (unsigned long long)h.rules_hash, h.root_ev, h.root_sd,
+                (long long)n, h.flags & policy::FLAG_SET1_OFFSET ? " (folded stage 2)" : "",
+                ev.empty() ? "actions only" : best_only ? "stored action's moments (to within 1/512)" : "moments of every action");
+        fprintf(f, "// Lookups: %s::POLICY (policy::Embedded, policy_embedded.hpp).\n", ns.c_str());
+        fprintf(f, "#pragma once\n#include <cstdint>\n#include <limits>\n\n#include \"policy_embedded.hpp\"\n\n");
+        fprintf(f, "namespace %s {\n\nnamespace detail {\n\n", ns.c_str());
+        fprintf(f, "inline constexpr double NaN = std::numeric_limits<double>::quiet_NaN();\n\n");
+        write_array(f, "uint8_t", "ACTION", n, 24, [&](int64_t s){ return to_string(act[uint64_t(s)]); });
+        for(size_t a=0; a<ev.size(); ++a){
+            if(ev[a].empty()) continue;
+            write_array(f, "double", "EV" + to_string(a), n, 4, [&](int64_t s){ return hex_double(ev[a][s]); });
+            write_array(f, "double", "SD" + to_string(a), n, 4, [&](int64_t s){ return hex_double(sd[a][s]); });
+        }
+        auto ptrs = [&](const char* name){
+            fprintf(f, "inline constexpr const double* %s[] = {", name);
+            for(size_t a=0; a<ev.size(); ++a) fprintf(f, "%s%s", a ? ", " : "", ev[a].empty() ? "nullptr" : (name + to_string(a)).c_str());
+            fprintf(f, "};\n");
+        };
+        if(!ev.empty()){ ptrs("EV"); ptrs("SD"); }
+        fprintf(f, "\n} // namespace detail\n\n%s", layout.c_str());
+        fprintf(f, "inline constexpr policy::Embedded POLICY{\n    policy::%s, %uu, 0x%016llxull, %s, %s, %lld,\n"
+                   "    detail::ACTION, %d, %s, %s, %s};\n\n",
+                event=="m100" ? "EVENT_100M" : "EVENT_LONGJUMP", unsigned(h.flags), (unsigned long long)h.rules_hash, hex_double(h.root_ev).c_str(),
+                hex_double(h.root_sd).c_str(), (long long)n, int(ev.size()),
+                ev.empty() ? "nullptr" : "detail::EV", ev.empty() ? "nullptr" : "detail::SD", best_only ? "true" : "false");
+        fprintf(f, "%s\n} // namespace %s\n", index_fn.c_str(), ns.c_str());
+        if(fclose(f) != 0) throw runtime_error("cannot write " + tmp);
+        filesystem::rename(tmp, paths[1]);
+        fprintf(stderr,"Wrote %s (%lld rows, %s)\n", paths[1].c_str(), (long long)n,
+                ev.empty() ? "actions only" : best_only ? "stored action's moments" : "every action's moments");
+    } catch(const exception& e){
+        fprintf(stderr,"%s\n", e.what());
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,257 @@
+// g++ -O3 -std=c++20 -pthread solvers/policy_server.cpp solvers/decathlon_policy.cpp -o solvers/policy_server
+// Usage: ./policy_server SOCKET policy.bin [policy.bin ...] [--poll-ms MS]
+//
+// Serves batched lookups into binary policy files (one per event) over a
+// Unix stream socket, through libdecathlon_policy (decathlon_policy.h).
+// Every file is re-checked every --poll-ms (default 200) and on SIGHUP; the
+// solvers write policies to "<path>.tmp" and rename them into place, so a new
+// inode means a complete new file. It is opened and validated off the request
+// path and published with an atomic shared_ptr swap: each request takes one
+// snapshot, so a batch is answered from a single generation, and the old
+// mapping is unmapped when its last in-flight request finishes. A file that
+// fails to open is reported and the previous generation keeps serving, as it
+// does when the new file is for another event or state layout (reroll budget,
+// run-up limit, number of states): clients compute indices for the layout
+// served, and a request does not say which one it used.
+//
+// Wire format (little-endian, one response per request, any number per
+// connection):
+//   request   u32 magic "DPQ1", u32 op, u32 event, u32 n, then op-specific:
+//     OP_LOOKUP  n x i32 state index (dp_state_index_100m / dp_state_index_longjump
+//                of the served file, whose layout OP_INFO's n_states gives)
+//     OP_INFO    nothing (event and n ignored)
+//   response  u32 magic, u32 status, u32 generation, u32 n, u64 rules_hash,
+//             then OP_LOOKUP: n x dp_result {i32 action, u32 pad, f64 ev, f64 sd}
+//                  OP_INFO:   n x Info (one per loaded event)
+// status is 0, or ERR_* (the response then has no records). generation
+// counts the loads of the event's file, starting at 1.
+#include <bits/stdc++.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "decathlon_policy.h"
+#include "parallel.hpp"
+using namespace std;
+
+static constexpr uint32_t MAGIC = 0x31515044;      // "DPQ1"
+enum : uint32_t { OP_LOOKUP = 1, OP_INFO = 2 };
+enum : uint32_t { OK = 0, ERR_BAD_REQUEST = 1, ERR_NO_EVENT = 2, ERR_TOO_MANY = 3 };
+static constexpr uint32_t MAX_BATCH = 1u << 20;
+
+struct Request  { uint32_t magic, op, event, n; };
+struct Response { uint32_t magic, status, generation, n; uint64_t rules_hash; };
+struct Info     { uint32_t event, generation; uint64_t n_states, rules_hash; double root_ev, root_sd; };
+static_assert(sizeof(Request)==16 && sizeof(Response)==24 && sizeof(Info)==40);
+static_assert(sizeof(dp_result)==24, "dp_result is sent as is");
+
+// One opened policy file.
+struct Loaded {
+    shared_ptr<dp_policy> policy;
+    uint32_t generation;
+    uint64_t rules_hash;
+};
+
+// A served file: the current generation plus what identifies it on disk.
+struct Slot {
+    string path;
+    // set by the first load, before serving; never written after
+    int event = 0, layout = 0;
+    uint64_t n_states = 0;
+    atomic<shared_ptr<const Loaded>> current;
+    dev_t dev = 0; ino_t ino = 0; timespec mtime{}; off_t size = 0;
+};
+
+// set by the signal handler, read by main and the watcher thread
+static atomic<int> g_stop{0}, g_reload{0};
+static_assert(atomic<int>::is_always_lock_free, "used from a signal handler");
+
+// (Re)load s if the file on disk is not the one served. Returns false only
+// when there is no usable generation at all.
+static bool refresh(Slot& s){
+    struct stat st{};
+    if(stat(s.path.c_str(), &st)!=0){
+        if(!s.current.load()) fprintf(stderr,"cannot stat %s\n", s.path.c_str());
+        return bool(s.current.load());
+    }
+    if(s.current.load() && st.st_dev==s.dev && st.st_ino==s.ino && st.st_size==s.size &&
+       st.st_mtim.tv_sec==s.mtime.tv_sec && st.st_mtim.tv_nsec==s.mtime.tv_nsec)
+        return true;
+    dp_policy* p = dp_open(s.path.c_str());
+    if(!p){
+        fprintf(stderr,"reload of %s failed: %s (keeping generation %u)\n", s.path.c_str(), dp_last_error(),
+                s.current.load() ? s.current.load()->generation : 0);
+        return bool(s.current.load());
+    }
+    if(s.event && (dp_event(p)!=s.event || dp_layout(p)!=s.layout || dp_num_states(p)!=s.n_states)){
+        fprintf(stderr,"reload of %s failed: event %d, layout %d, %llu states changed to %d, %d, %llu"
+                " (keeping generation %u)\n", s.path.c_str(), s.event, s.layout, (unsigned long long)s.n_states,
+                dp_event(p), dp_layout(p), (unsigned long long)dp_num_states(p), s.current.load()->generation);
+        dp_close(p);
+        s.dev = st.st_dev; s.ino = st.st_ino; s.mtime = st.st_mtim; s.size = st.st_size;   // not retried until it changes
+        return true;
+    }
+    auto old = s.current.load();
+    auto next = make_shared<const Loaded>(Loaded{shared_ptr<dp_policy>(p, dp_close),
+                                                 old ? old->generation + 1 : 1, dp_rules_hash(p)});
+    if(!s.event){                                       // first load only: main, before any connection
+        s.event = dp_event(p);
+        s.layout = dp_layout(p);
+        s.n_states = dp_num_states(p);
+    }
+    s.current.store(next);
+    s.dev = st.st_dev; s.ino = st.st_ino; s.mtime = st.st_mtim; s.size = st.st_size;
+    fprintf(stderr,"serving %s: event %d, generation %u, %llu states, rules %016llx\n", s.path.c_str(), s.event,
+            next->generation, (unsigned long long)dp_num_states(p), (unsigned long long)next->rules_hash);
+    return true;
+}
+
+static bool read_all(int fd, void* buf, size_t n){
+    auto* p = static_cast<char*>(buf);
+    while(n){
+        ssize_t r = read(fd, p, n);
+        if(r<0 && errno==EINTR) continue;
+        if(r<=0) return false;
+        p += r; n -= size_t(r);
+    }
+    return true;
+}
+
+static bool write_all(int fd, const void* buf, size_t n){
+    auto* p = static_cast<const char*>(buf);
+    while(n){
+        ssize_t r = send(fd, p, n, MSG_NOSIGNAL);
+        if(r<0 && errno==EINTR) continue;
+        if(r<=0) return false;
+        p += r; n -= size_t(r);
+    }
+    return true;
+}
+
+static void serve(int fd, deque<Slot>& slots){
+    vector<int32_t> states;
+    vector<dp_result> out;
+    for(Request q; read_all(fd, &q, sizeof q); ){
+        Response r{MAGIC, OK, 0, 0, 0};
+        if(q.magic!=MAGIC || (q.op!=OP_LOOKUP && q.op!=OP_INFO)){
+            r.status = ERR_BAD_REQUEST;
+            write_all(fd, &r, sizeof r);
+            break;                                       // the stream cannot be resynchronized
+        }
+        if(q.op==OP_INFO){
+            vector<Info> info;
+            for(Slot& s: slots){
+                auto cur = s.current.load();
+                double ev, sd;
+                dp_root_moments(cur->policy.get(), &ev, &sd);
+                info.push_back({uint32_t(s.event), cur->generation, dp_num_states(cur->policy.get()),
+                                cur->rules_hash, ev, sd});
+            }
+            r.n = uint32_t(info.size());
+            if(!write_all(fd, &r, sizeof r) || !write_all(fd, info.data(), info.size()*sizeof(Info))) break;
+            continue;
+        }
+        if(q.n > MAX_BATCH){
+            r.status = ERR_TOO_MANY;
+            write_all(fd, &r, sizeof r);
+            break;
+        }
+        states.resize(q.n);
+        if(!read_all(fd, states.data(), q.n*sizeof(int32_t))) break;
+        Slot* slot = nullptr;
+        for(Slot& s: slots) if(uint32_t(s.event)==q.event) slot = &s;
+        if(!slot){
+            r.status = ERR_NO_EVENT;
+            if(!write_all(fd, &r, sizeof r)) break;
+            continue;
+        }
+        auto cur = slot->current.load();                 // one generation for the whole batch
+        out.resize(q.n);
+        dp_lookup_many(cur->policy.get(), states.data(), q.n, out.data());
+        r.generation = cur->generation;
+        r.n = q.n;
+        r.rules_hash = cur->rules_hash;
+        if(!write_all(fd, &r, sizeof r) || !write_all(fd, out.data(), out.size()*sizeof(dp_result))) break;
+    }
+}
+
+int main(int argc, char** argv){
+    string sock_path;
+    vector<string> paths;
+    int poll_ms = 200;
+    for(int i=1; i<argc; ++i){
+        string a = argv[i];
+        if(a=="--poll-ms" && i+1<argc) poll_ms = max(1, atoi(argv[++i]));
+        else if(a.rfind("--",0)==0){ fprintf(stderr,"unknown option %s\n", a.c_str()); return 1; }
+        else if(sock_path.empty()) sock_path = a;
+        else paths.push_back(a);
+    }
+    if(sock_path.empty() || paths.empty()){
+        fprintf(stderr,"usage: policy_server SOCKET policy.bin [policy.bin ...] [--poll-ms MS]\n"); return 1;
+    }
+
+    deque<Slot> slots;                                   // stable addresses
+    for(const string& p: paths){
+        slots.emplace_back().path = p;
+        if(!refresh(slots.back())) return 2;
+        for(size_t j=0; j+1<slots.size(); ++j)
+            if(slots[j].event==slots.back().event){
+                fprintf(stderr,"%s and %s are both event %d\n", slots[j].path.c_str(), p.c_str(), slots[j].event);
+                return 1;
+            }
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    struct sigaction sa{};
+    sa.sa_handler = [](int sig){ if(sig==SIGHUP) g_reload = 1; else g_stop = 1; };
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+    sigaction(SIGHUP, &sa, nullptr);
+
+    int ls = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if(sock_path.size() >= sizeof(addr.sun_path)){ fprintf(stderr,"socket path too long\n"); return 1; }
+    strcpy(addr.sun_path, sock_path.c_str());
+    unlink(sock_path.c_str());
+    if(ls<0 || ::bind(ls, (sockaddr*)&addr, sizeof addr)!=0 || listen(ls, 128)!=0){
+        fprintf(stderr,"cannot listen on %s: %s\n", sock_path.c_str(), strerror(errno));
+        return 2;
+    }
+    fprintf(stderr,"listening on %s\n", sock_path.c_str());
+
+    jthread watcher([&](stop_token stop){
+        par::Stopwatch since;
+        while(!stop.stop_requested()){
+            this_thread::sleep_for(chrono::milliseconds(min(poll_ms, 20)));
+            if(g_reload.exchange(0) || since.ms() >= poll_ms){
+                for(Slot& s: slots) refresh(s);
+                since = {};
+            }
+        }
+    });
+
+    // one thread per connection; finished ones are closed on the next accept
+    struct Conn { int fd; atomic<bool> done{false}; jthread thread; };
+    auto reap = [](Conn& c){ c.thread.join(); close(c.fd); return true; };
+    list<Conn> conns;
+    while(!g_stop){
+        pollfd pfd{ls, POLLIN, 0};
+        if(poll(&pfd, 1, 100) <= 0) continue;
+        int fd = accept(ls, nullptr, nullptr);
+        if(fd<0) continue;
+        conns.remove_if([&](Conn& c){ return c.done.load() && reap(c); });
+        Conn& c = conns.emplace_back();
+        c.fd = fd;
+        c.thread = jthread([&c, &slots]{ serve(c.fd, slots); c.done = true; });
+    }
+    for(Conn& c: conns) shutdown(c.fd, SHUT_RDWR);
+    for(Conn& c: conns) reap(c);
+    conns.clear();
+    close(ls);
+    unlink(sock_path.c_str());
+    fprintf(stderr,"stopped\n");
+    return 0;
+}
@@ -0,0 +1,233 @@
+// g++ -O3 -march=native -std=c++20 -pthread solvers/policy_sim.cpp -o solvers/policy_sim
+// Usage: ./policy_sim policy.bin [--games N] [--threads N] [--seed S] [--csv FILE] [--max-z Z]
+//
+// Plays N games (default 1e7; "1e9" is accepted) of the event of a binary
+// policy file (policy_format.hpp, 100m or single-attempt long jump) with the
+// file's actions, and compares the empirical score distribution with the
+// exact one (plain or compact files):
+//   - the policy's own moments (root_ev/root_sd in the header);
+//   - the optimal PMF for the same rules, solved in-process with dp::Solver.
+// The rules are inferred from the file's state count and checked against
+// its rules_hash. z is the mean's error in standard errors; with --max-z Z
+// the exit status is 3 when |z| > Z, for scripted regression checks.
+//
+// Dice come from rng::Stream (counter_rng.hpp), one stream per game keyed by
+// --seed, so results do not depend on --threads. Each roll is a single
+// uniform draw over the 6^n ordered outcomes, mapped to its pattern by a
+// table. --csv writes score, games, empirical pmf, exact pmf.
+#include <bits/stdc++.h>
+#include "counter_rng.hpp"
+#include "dice_outcomes.hpp"
+#include "dp_engine.hpp"
+#include "event_100m.hpp"
+#include "event_longjump.hpp"
+#include "parallel.hpp"
+#include "policy_format.hpp"
+using namespace std;
+
+static constexpr int BAD_GAME = INT_MIN;           // the policy had no legal action
+static constexpr int64_t CHUNK = 1 << 16;          // games per work item
+
+static constexpr uint32_t pow6(int n){ uint32_t p = 1; while(n--) p *= 6; return p; }
+
+// Pattern rank in dice::OUTCOMES<N> of every ordered roll, by its base-6 code.
+template<int N>
+static constexpr auto ROLL_RANK = []{
+    array<uint16_t, pow6(N)> a{};
+    for(uint32_t code=0; code<pow6(N); ++code){
+        uint8_t count[7]{};
+        for(uint32_t c=code, i=0; i<N; ++i, c/=6) count[c%6 + 1]++;
+        a[code] = uint16_t(dice::pattern_rank(count));
+    }
+    return a;
+}();
+
+template<int N>
+static const dice::Outcome& roll(rng::Stream& s){
+    return dice::OUTCOMES<N>[ROLL_RANK<N>[s.below(pow6(N))]];
+}
+
+static const dice::Outcome& roll(rng::Stream& s, int n){
+    switch(n){
+        case 1: return roll<1>(s);
+        case 2: return roll<2>(s);
+        case 3: return roll<3>(s);
+        case 4: return roll<4>(s);
+        default: return roll<5>(s);
+    }
+}
+
+// One 100m game: stage 1 and 2 share the reroll budget.
+static int play_100m(const events::M100& ev, const policy::ActionCodes& act, rng::Stream& s){
+    int r = ev.rules.max_rerolls, set1 = 0;
+    for(int stage=1; stage<=2; ++stage){
+        for(;;){
+            int pat = ROLL_RANK<4>[s.below(pow6(4))];
+            uint8_t a = act[ev.state_index({stage, r, pat, set1})];
+            if(a == events::M100::REROLL && r > 0){ --r; continue; }
+            if(a != events::M100::FREEZE) return BAD_GAME;
+            if(stage == 1) set1 = events::M100::PAT_SCORE[pat];
+            else return set1 + events::M100::PAT_SCORE[pat];
+            break;
+        }
+    }
+    return BAD_GAME;
+}
+
+// One long jump attempt: run-up freezing the k smallest, then the jump with
+// the dice frozen in the run-up, freezing the k largest.
+static int play_longjump(const events::LongJump& ev, const policy::ActionCodes& act, rng::Stream& s){
+    int n = events::lj::N_DICE, sum = 0;
+    while(n > 0){
+        const dice::Outcome& o = roll(s, n);
+        int k = act[ev.runup_post(sum, o.index)];
+        if(k == 0) break;
+        if(k > n || sum + o.low[k] > ev.rules.max_runup) return BAD_GAME;
+        sum += o.low[k];
+        n -= k;
+    }
+    int jump = events::lj::N_DICE - n, score = 0;
+    while(jump > 0){
+        const dice::Outcome& o = roll(s, jump);
+        int k = act[ev.jump_post(o.index)];
+        if(k < 1 || k > jump) return BAD_GAME;
+        score += o.high[k];
+        jump -= k;
+    }
+    return score;
+}
+
+struct Tally {
+    vector<uint64_t> hist;     // games per score - Score::MIN
+    uint64_t bad = 0;
+};
+
+template<class Event, class Play>
+static Tally simulate(const Event& ev, const policy::ActionCodes& act, int64_t games, uint64_t seed, int threads,
+                      Play&& play){
+    using Score = typename Event::Score;
+    Tally total{vector<uint64_t>(Score::N)};
+    mutex mu;
+    const int64_t chunks = (games + CHUNK - 1) / CHUNK;
+    par::parallel_for_dynamic(int(chunks), threads, [&](int c){
+        array<uint64_t, Score::N> h{};
+        uint64_t bad = 0;
+        for(int64_t g = c*CHUNK, end = min(games, g + CHUNK); g < end; ++g){
+            rng::Stream s(seed, uint64_t(g));
+            int x = play(ev, act, s);
+            if(x == BAD_GAME || x < Score::MIN || x > Score::MAX) ++bad;
+            else ++h[x - Score::MIN];
+        }
+        lock_guard lock(mu);
+        for(int i=0; i<Score::N; ++i) total.hist[i] += h[i];
+        total.bad += bad;
+    });
+    return total;
+}
+
+template<class Event>
+static int report(const Event& ev, const policy::File& f, const Tally& t, int64_t games, double ms,
+                  const string& csv, double max_z){
+    using Score = typename Event::Score;
+    if(t.bad){
+        fprintf(stderr,"%llu game(s) reached a state with no legal policy action\n", (unsigned long long)t.bad);
+        return 2;
+    }
+    dp::Solver<Event> solver(ev);
+    solver.solve();
+    const auto& exact = solver.root().pmf;
+
+    double mean = 0, m2 = 0, tv = 0, chi2 = 0;
+    int dof = -1;
+    for(int i=0; i<Score::N; ++i){
+        double p = double(t.hist[i]) / games, x = Score::MIN + i;
+        mean += x*p; m2 += x*x*p;
+        tv += fabs(p - exact.p[i]) / 2;
+        double expect = exact.p[i] * games;
+        if(expect >= 5){ chi2 += (t.hist[i] - expect)*(t.hist[i] - expect) / expect; ++dof; }
+    }
+    const double sd = sqrt(max(0.0, m2 - mean*mean));
+    const double pol_ev = f.header().root_ev, pol_sd = f.header().root_sd;
+    const double z = (mean - pol_ev) / (pol_sd / sqrt(double(games)));
+
+    fprintf(stderr,"%lld games in %.1f ms (%.1f M games/s)\n", (long long)games, ms, games / ms / 1e3);
+    fprintf(stderr,"simulated: EV=%.6f SD=%.6f\n", mean, sd);
+    fprintf(stderr,"policy:    EV=%.6f SD=%.6f  z=%+.2f\n", pol_ev, pol_sd, z);
+    fprintf(stderr,"optimal:   EV=%.6f SD=%.6f  total variation %.2e, chi2=%.1f on %d dof\n",
+            solver.root().m.ev, solver.root().m.sd(), tv, chi2, dof);
+    if(fabs(pol_ev - solver.root().m.ev) > 1e-9)
+        fprintf(stderr,"note: the policy is not optimal for these rules; the PMF comparison is against the optimum\n");
+
+    if(!csv.empty()){
+        ofstream out(csv);
+        out << "score,games,pmf,exact_pmf\n" << setprecision(12);
+        for(int i=0; i<Score::N; ++i)
+            out << Score::MIN + i << "," << t.hist[i] << "," << double(t.hist[i]) / games << "," << exact.p[i] << "\n";
+        fprintf(stderr,"Wrote %s\n", csv.c_str());
+    }
+    return max_z > 0 && fabs(z) > max_z ? 3 : 0;
+}
+
+int main(int argc, char** argv){
+    string path, csv;
+    int64_t games = 10'000'000;
+    int threads = 0;           // 0 = one per hardware thread
+    uint64_t seed = 1;
+    double max_z = 0;          // 0 = never fail
+    for(int i=1; i<argc; ++i){
+        string a = argv[i];
+        if(a=="--games" && i+1<argc) games = int64_t(strtod(argv[++i], nullptr));
+        else if(a=="--threads" && i+1<argc) threads = atoi(argv[++i]);
+        else if(a=="--seed" && i+1<argc) seed = strtoull(argv[++i], nullptr, 0);
+        else if(a=="--csv" && i+1<argc) csv = argv[++i];
+        else if(a=="--max-z" && i+1<argc) max_z = atof(argv[++i]);
+        else if(a.rfind("--",0)==0){ fprintf(stderr,"unknown option %s\n", a.c_str()); return 1; }
+        else path = a;
+    }
+    if(path.empty()){ fprintf(stderr,"usage: policy_sim policy.bin [--games N] ...\n"); return 1; }
+    if(games < 1 || (games + CHUNK - 1) / CHUNK > INT_MAX){ fprintf(stderr,"--games out of range\n"); return 1; }
+    if(threads<=0) threads = par::hardware_threads();
+
+    try {
+        policy::File f(path);
+        const policy::ActionCodes act = f.actions();
+        if(act.size() != f.n_states()) throw runtime_error("policy file has no action section: " + path);
+        const int64_t n = int64_t(f.n_states());
+
+        // Rules from the table size, checked against the recorded fingerprint.
+        auto check_rules = [&](const rules::Fingerprint& fp){
+            uint64_t h = f.header().rules_hash;
+            if(h && h != fp.hash())
+                fprintf(stderr,"warning: %s was solved for rules %s, not %s\n", path.c_str(),
+                        rules::Fingerprint::to_hex(h).c_str(), fp.text().c_str());
+        };
+        par::Stopwatch clock;
+        if(f.event() == policy::EVENT_100M){
+            const bool folded = f.header().flags & policy::FLAG_SET1_OFFSET;
+            const int per = folded ? 2*policy::m100::N_PATTERNS : policy::m100::n_states(0);
+            if(n % per) throw runtime_error("100m policy has an unexpected state count");
+            const events::M100 ev({int(n / per) - 1});
+            check_rules(ev.fingerprint());
+            // stage 2 stored once per (rerolls, dice): unfold to the full table
+            vector<uint8_t> unfolded;
+            if(folded){
+                unfolded.resize(ev.n_states());
+                for(int s=0; s<ev.n_states(); ++s) unfolded[s] = act[policy::m100::stored_index(s, ev.n_stage1()).index];
+            }
+            Tally t = simulate(ev, folded ? policy::ActionCodes(unfolded) : act, games, seed, threads, play_100m);
+            return report(ev, f, t, games, clock.ms(), csv, max_z);
+        }
+        if(f.event() == policy::EVENT_LONGJUMP){
+            const int per = policy::longjump::N_COUNTS;
+            if(n % per || n / per < 2) throw runtime_error("long jump policy has an unexpected state count");
+            const events::LongJump ev({int(n / per) - 2});
+            check_rules(ev.fingerprint());
+            Tally t = simulate(ev, act, games, seed, threads, play_longjump);
+            return report(ev, f, t, games, clock.ms(), csv, max_z);
+        }
+        throw runtime_error("unknown event in " + path);
+    } catch(const exception& e){
+        fprintf(stderr,"%s\n", e.what());
+        return 2;
+    }
+}
@@ -0,0 +1,163 @@
+// g++ -O3 -std=c++20 -pthread solvers/rule_sweep.cpp -lsqlite3 -o solvers/rule_sweep
+// Usage: ./rule_sweep sweep.db --event 100m --max-rerolls 0..10 [--threads N] [--policies DIR] [--force]
+//        ./rule_sweep sweep.db --event longjump --max-runup 4,6,8..12 [--bo3] [--threads N] ...
+//
+// Solves a grid of rule variants of one event in a single process and
+// writes a summary of each: root EV/SD and the exact score PMF. Variants are
+// solved in parallel, one per thread (the dice outcome tables are compile-time
+// constants, so they are shared for free). With --policies, each variant's
+// binary policy is also written to DIR/<output>_<rules hash>.bin.
+//
+// Tables:
+//   sweep_variants(hash, output, rules, ev, sd, solve_ms)   one row per variant
+//   sweep_pmf(hash, score, pmf)                              score distribution
+// hash and rules are the variant's rules::Fingerprint. Variants already in
+// the summary are skipped unless --force is given.
+#include <bits/stdc++.h>
+#include "dp_engine.hpp"
+#include "event_100m.hpp"
+#include "event_longjump.hpp"
+#include "parallel.hpp"
+#include "sqlite_writer.hpp"
+using namespace std;
+
+struct Result {
+    explicit Result(rules::Fingerprint f = rules::Fingerprint("", 0)) : fp(std::move(f)) {}
+    rules::Fingerprint fp;
+    double ev = 0, sd = 0, ms = 0;
+    int lo = 0;               // score of pmf[0]
+    vector<double> pmf;
+};
+
+// "4", "0..10", "4,6,8..12"
+static vector<int> parse_values(const string& spec){
+    vector<int> out;
+    stringstream ss(spec);
+    for(string part; getline(ss, part, ','); ){
+        size_t dots = part.find("..");
+        int lo = stoi(part.substr(0, dots)), hi = dots==string::npos ? lo : stoi(part.substr(dots+2));
+        for(int v=lo; v<=hi; ++v) out.push_back(v);
+    }
+    return out;
+}
+
+template<class Event>
+static Result solve_variant(const Event& event, policy::Event id, const string& policies){
+    par::Stopwatch clock;
+    dp::Solver<Event> solver(event);
+    solver.solve();
+    Result r(event.fingerprint());
+    r.ms = clock.ms();
+    const auto& root = solver.root();
+    r.ev = root.m.ev;
+    r.sd = root.m.sd();
+    r.lo = Event::Score::MIN;
+    r.pmf.assign(root.pmf.p.begin(), root.pmf.p.end());
+    if(!policies.empty())
+        dp::write_policy_bin(solver, id, policies + "/" + r.fp.output() + "_" + r.fp.hex() + ".bin", r.fp.hash());
+    return r;
+}
+
+static void write_summary(sqlw::Db& db, const vector<Result>& results, int batch){
+    db.exec("CREATE TABLE IF NOT EXISTS sweep_variants(hash TEXT PRIMARY KEY, output TEXT NOT NULL,"
+            " rules TEXT NOT NULL, ev REAL NOT NULL, sd REAL NOT NULL, solve_ms REAL NOT NULL) WITHOUT ROWID;");
+    db.exec("CREATE TABLE IF NOT EXISTS sweep_pmf(hash TEXT NOT NULL, score INTEGER NOT NULL, pmf REAL NOT NULL,"
+            " PRIMARY KEY(hash, score)) WITHOUT ROWID;");
+    db.begin();
+    vector<string> hex;
+    for(const Result& r: results) hex.push_back(r.fp.hex());
+    for(const string& h: hex){
+        db.exec("DELETE FROM sweep_variants WHERE hash='" + h + "';");
+        db.exec("DELETE FROM sweep_pmf WHERE hash='" + h + "';");
+    }
+    sqlw::Inserter var(db, "sweep_variants", {"hash","output","rules","ev","sd","solve_ms"}, batch);
+    sqlw::Inserter pmf(db, "sweep_pmf", {"hash","score","pmf"}, batch);
+    for(size_t i=0; i<results.size(); ++i){
+        const Result& r = results[i];
+        var.text(hex[i].c_str()).text(r.fp.output().c_str()).text(r.fp.text().c_str())
+           .d(r.ev).d(r.sd).d(r.ms).end_row();
+        for(size_t k=0; k<r.pmf.size(); ++k) pmf.text(hex[i].c_str()).i(r.lo + int(k)).d(r.pmf[k]).end_row();
+    }
+    var.finish();
+    pmf.finish();
+    db.commit();
+}
+
+int main(int argc, char** argv){
+    string path = "sweep.db", event, policies, rerolls_spec, runup_spec;
+    int threads = 0;           // 0 = one per hardware thread
+    int sql_batch = 256;
+    bool bo3 = false, force = false;
+    for(int i=1; i<argc; ++i){
+        string a = argv[i];
+        if(a=="--event" && i+1<argc) event = argv[++i];
+        else if(a=="--max-rerolls" && i+1<argc) rerolls_spec = argv[++i];
+        else if(a=="--max-runup" && i+1<argc) runup_spec = argv[++i];
+        else if(a=="--threads" && i+1<argc) threads = atoi(argv[++i]);
+        else if(a=="--policies" && i+1<argc) policies = argv[++i];
+        else if(a=="--sql-batch" && i+1<argc) sql_batch = atoi(argv[++i]);
+        else if(a=="--bo3") bo3 = true;
+        else if(a=="--force") force = true;
+        else if(a.rfind("--",0)==0){ fprintf(stderr,"unknown option %s\n", a.c_str()); return 1; }
+        else path = a;
+    }
+    if(event!="100m" && event!="longjump"){ fprintf(stderr,"--event must be 100m or longjump\n"); return 1; }
+    if(!(event=="100m" ? runup_spec : rerolls_spec).empty()){
+        fprintf(stderr,"%s does not apply to %s\n", event=="100m" ? "--max-runup" : "--max-rerolls", event.c_str());
+        return 1;
+    }
+    const string spec = event=="100m" ? rerolls_spec : runup_spec;
+    if(bo3 && !policies.empty()){
+        fprintf(stderr,"--policies: the best-of-three policy has no binary policy layout\n"); return 1;
+    }
+    if(threads<=0) threads = par::hardware_threads();
+
+    try {
+        vector<int> values = parse_values(spec.empty() ? (event=="100m" ? "5" : "8") : spec);
+        // one solve per variant; the event objects validate the rules up front
+        vector<function<Result()>> jobs;
+        vector<rules::Fingerprint> fps;
+        for(int v: values){
+            if(event=="100m"){
+                events::M100 ev({v});
+                fps.push_back(ev.fingerprint());
+                jobs.push_back([ev, &policies]{ return solve_variant(ev, policy::EVENT_100M, policies); });
+            } else if(bo3){
+                events::LongJumpBo3 ev({v});
+                fps.push_back(ev.fingerprint());
+                jobs.push_back([ev]{ return solve_variant(ev, policy::EVENT_LONGJUMP, string()); });
+            } else {
+                events::LongJump ev({v});
+                fps.push_back(ev.fingerprint());
+                jobs.push_back([ev, &policies]{ return solve_variant(ev, policy::EVENT_LONGJUMP, policies); });
+            }
+        }
+
+        sqlw::Db db(path);
+        if(!force && db.has_table("sweep_variants")){
+            vector<function<Result()>> todo;
+            for(size_t i=0; i<jobs.size(); ++i){
+                if(db.query_text("SELECT hash FROM sweep_variants WHERE hash=?;", fps[i].hex()))
+                    fprintf(stderr,"skip %s (in %s)\n", fps[i].text().c_str(), path.c_str());
+                else todo.push_back(jobs[i]);
+            }
+            jobs.swap(todo);
+        }
+        if(!policies.empty()) filesystem::create_directories(policies);
+
+        par::Stopwatch clock;
+        vector<Result> results(jobs.size());
+        par::parallel_for_dynamic(int(jobs.size()), threads, [&](int i){ results[i] = jobs[i](); });
+        const double solve_ms = clock.ms();
+
+        write_summary(db, results, sql_batch);
+        for(const Result& r: results)
+            fprintf(stderr,"%s  EV=%.6f SD=%.6f  (%.1f ms)\n", r.fp.text().c_str(), r.ev, r.sd, r.ms);
+        fprintf(stderr,"Solved %zu variant(s) in %.1f ms on %d thread(s), summary in %s\n",
+                results.size(), solve_ms, min<int>(threads, max<size_t>(results.size(), 1)), path.c_str());
+    } catch(const exception& e){
+        fprintf(stderr,"%s\n", e.what());
+        return 2;
+    }
+    return 0;
+}
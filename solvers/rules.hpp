@@ -0,0 +1,73 @@
+// Rule fingerprints: which game rules (and solver revision) an output was
+// generated for.
+//
+// A Fingerprint is the canonical text "output;key=value;key=value..." of an
+// event's rule parameters, in the order the event adds them, plus its 64-bit
+// FNV-1a hash. The solvers store both with their outputs and skip
+// regeneration when the stored fingerprint already matches; value() lets a
+// solver compare single parameters to update only what a change affects.
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <utility>
+
+namespace rules {
+
+class Fingerprint {
+public:
+    // revision: bumped by the event whenever its solver output changes for the same rules
+    Fingerprint(std::string output, int revision) : output_(std::move(output)), text_(output_) {
+        add("revision", revision);
+    }
+
+    Fingerprint& add(const std::string& key, long long v){ return add(key, std::to_string(v)); }
+    Fingerprint& add(const std::string& key, const std::string& v){
+        text_ += ";" + key + "=" + v;
+        return *this;
+    }
+
+    const std::string& output() const { return output_; }
+    const std::string& text() const { return text_; }
+
+    uint64_t hash() const {
+        uint64_t h = 0xcbf29ce484222325ull;
+        for(unsigned char c: text_){ h ^= c; h *= 0x100000001b3ull; }
+        return h;
+    }
+    std::string hex() const { return to_hex(hash()); }
+
+    static std::string to_hex(uint64_t h){
+        char buf[17];
+        snprintf(buf, sizeof buf, "%016llx", (unsigned long long)h);
+        return buf;
+    }
+
+    // Value of `key` in a fingerprint text, if present.
+    static std::optional<std::string> value(const std::string& text, const std::string& key){
+        std::string pat = ";" + key + "=";
+        size_t p = text.find(pat);
+        if(p==std::string::npos) return std::nullopt;
+        p += pat.size();
+        return text.substr(p, text.find(';', p) - p);
+    }
+
+    // Same text once `key` is removed from both, i.e. the fingerprints differ at most in `key`.
+    static bool same_except(const std::string& a, const std::string& b, const std::string& key){
+        return without(a, key) == without(b, key);
+    }
+
+private:
+    static std::string without(std::string text, const std::string& key){
+        std::string pat = ";" + key + "=";
+        size_t p = text.find(pat);
+        if(p==std::string::npos) return text;
+        size_t e = text.find(';', p+1);
+        return text.erase(p, e==std::string::npos ? std::string::npos : e - p);
+    }
+
+    std::string output_, text_;
+};
+
+} // namespace rules
@@ -0,0 +1,99 @@
+// Exact score distributions over a fixed integer range.
+//
+// Pmf<LO, HI> is a dense histogram indexed by score - LO. The solvers build
+// one per chance node from the children of the chosen actions (a shifted,
+// probability-weighted sum), so the root distribution falls out of the same
+// bottom-up pass that computes the moments. Mass shifted outside [LO, HI] is
+// dropped; mass() lets callers check that the range was wide enough.
+//
+// Dist is the same histogram with a range chosen at run time, for sums of
+// event scores (convolve).
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+namespace pmf {
+
+template<int LO, int HI>
+struct Pmf {
+    static_assert(LO <= HI);
+    static constexpr int MIN = LO, MAX = HI, N = HI - LO + 1;
+
+    std::array<double, N> p{};
+
+    static Pmf point(int score){ Pmf d; d.add_point(score, 1.0); return d; }
+
+    double operator[](int score) const { return p[score - LO]; }
+
+    void add_point(int score, double w){
+        if(score >= LO && score <= HI) p[score - LO] += w;
+    }
+
+    // this += w * (d with every score moved up by `shift`)
+    void add(const Pmf& d, double w, int shift = 0){
+        int lo = std::max(0, -shift), hi = std::min(N, N - shift);
+        for(int i=lo; i<hi; ++i) p[i + shift] += w * d.p[i];
+    }
+
+    double mass() const { double m=0; for(double x: p) m += x; return m; }
+    double mean() const { double m=0; for(int i=0; i<N; ++i) m += (LO + i) * p[i]; return m; }
+    double sd() const {
+        double mu = mean(), v = 0;
+        for(int i=0; i<N; ++i){ double d = LO + i - mu; v += d*d*p[i]; }
+        return std::sqrt(std::max(0.0, v));
+    }
+
+    // cdf[i] = P(score <= LO + i)
+    std::array<double, N> cdf() const {
+        std::array<double, N> c{};
+        double acc = 0;
+        for(int i=0; i<N; ++i){ acc += p[i]; c[i] = acc; }
+        return c;
+    }
+};
+
+struct Dist {
+    int lo = 0;                    // score of p[0]
+    std::vector<double> p;
+
+    static Dist point(int score){ return {score, {1.0}}; }
+    template<int LO, int HI>
+    static Dist of(const Pmf<LO, HI>& d){ return {LO, std::vector<double>(d.p.begin(), d.p.end())}; }
+
+    int hi() const { return lo + int(p.size()) - 1; }
+    double at(int score) const { return score < lo || score > hi() ? 0.0 : p[score - lo]; }
+
+    double mass() const { double m=0; for(double x: p) m += x; return m; }
+    double mean() const { double m=0; for(size_t i=0; i<p.size(); ++i) m += (lo + int(i)) * p[i]; return m; }
+    double sd() const {
+        double mu = mean(), v = 0;
+        for(size_t i=0; i<p.size(); ++i){ double d = lo + int(i) - mu; v += d*d*p[i]; }
+        return std::sqrt(std::max(0.0, v));
+    }
+    // P(score >= t)
+    double tail(int t) const {
+        double m = 0;
+        for(int x=std::max(t, lo); x<=hi(); ++x) m += p[x - lo];
+        return m;
+    }
+};
+
+// Distribution of the sum of independent scores. Event supports are a few
+// dozen points, so the direct O(n*m) sum is cheaper than an FFT and exact: no
+// round-off noise in the far tails that threshold probabilities read. The
+// inner loop is a contiguous axpy the compiler vectorizes.
+inline Dist convolve(const Dist& a, const Dist& b){
+    if(a.p.empty() || b.p.empty()) return {};
+    Dist c{a.lo + b.lo, std::vector<double>(a.p.size() + b.p.size() - 1)};
+    for(size_t i=0; i<a.p.size(); ++i){
+        const double w = a.p[i];
+        if(w == 0) continue;
+        double* out = c.p.data() + i;
+        for(size_t j=0; j<b.p.size(); ++j) out[j] += w * b.p[j];
+    }
+    return c;
+}
+
+} // namespace pmf
@@ -0,0 +1,138 @@
+// Per-layer checkpoints for a backward solve split across processes.
+//
+// A sharded solve runs the same command once per shard (--shard K/N), on one
+// machine or on several that share a directory. Every layer's work items are
+// dealt out by index (item k belongs to shard k % N, which spreads the cheap
+// and the expensive items evenly). Each shard writes its results for the layer
+// to its own file in that directory and then reads the other shards' files
+// for the layer, which is all the next layer depends on. The directory is the
+// only channel: there is no coordinator, and shards may start at different
+// times.
+//
+// A layer file is written to a temporary name and renamed, so it is either
+// absent or complete. Its header carries a key (a hash of everything the
+// results depend on) and the layer, so a file from another run is ignored
+// rather than read. A restarted shard reuses its own files whose key matches:
+// the files double as resumable checkpoints.
+//
+// File: magic "DDSHARD1", key u64, layer i32, shard i32, n_shards i32,
+// n_records i32, then per record k i32, n i32, n doubles. Little endian, as
+// the binary policy.
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace shard {
+
+struct Record {
+    int32_t k;                    // work item
+    std::vector<double> v;        // its results
+};
+
+struct Spec {
+    int index = 0, count = 1;
+    std::string dir;              // empty: no files, everything in-process
+    double timeout_s = 3600;      // longest wait for another shard's layer
+
+    // "K/N" with 0 <= K < N.
+    static Spec parse(const std::string& k_of_n){
+        Spec s;
+        const std::invalid_argument bad("--shard expects K/N with 0 <= K < N, got " + k_of_n);
+        size_t slash = k_of_n.find('/'), used_k = 0, used_n = 0;
+        if(slash == std::string::npos) throw bad;
+        try {
+            s.index = std::stoi(k_of_n.substr(0, slash), &used_k);
+            s.count = std::stoi(k_of_n.substr(slash+1), &used_n);
+        } catch(const std::logic_error&){ throw bad; }
+        if(used_k != slash || used_n != k_of_n.size() - slash - 1 || s.count < 1 || s.index < 0 || s.index >= s.count)
+            throw bad;
+        return s;
+    }
+
+    bool uses_files() const { return !dir.empty(); }
+    bool owns(int k) const { return k % count == index; }
+
+    // File of shard `of`'s results for `layer` of the solve called `name`.
+    std::string path(const std::string& name, int layer, int of) const {
+        return (std::filesystem::path(dir) / (name + ".L" + std::to_string(layer) + ".S" + std::to_string(of) +
+                                              "of" + std::to_string(count))).string();
+    }
+};
+
+namespace detail {
+
+inline constexpr char MAGIC[8] = {'D','D','S','H','A','R','D','1'};
+
+struct Header {
+    char magic[8];
+    uint64_t key;
+    int32_t layer, shard, n_shards, n_records;
+};
+
+} // namespace detail
+
+inline void write_layer(const Spec& s, const std::string& name, int layer, uint64_t key,
+                        const std::vector<Record>& records){
+    const std::string path = s.path(name, layer, s.index), tmp = path + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "wb");
+    if(!f) throw std::runtime_error("cannot write " + tmp);
+    detail::Header h{};
+    std::memcpy(h.magic, detail::MAGIC, sizeof h.magic);
+    h.key = key; h.layer = layer; h.shard = s.index; h.n_shards = s.count; h.n_records = int32_t(records.size());
+    bool ok = fwrite(&h, sizeof h, 1, f) == 1;
+    for(const Record& r: records){
+        const int32_t n = int32_t(r.v.size());
+        ok = ok && fwrite(&r.k, sizeof r.k, 1, f) == 1 && fwrite(&n, sizeof n, 1, f) == 1
+                && fwrite(r.v.data(), sizeof(double), r.v.size(), f) == r.v.size();
+    }
+    ok = (fclose(f) == 0) && ok;
+    std::error_code ec;
+    if(ok) std::filesystem::rename(tmp, path, ec);
+    if(!ok || ec){
+        std::filesystem::remove(tmp, ec);
+        throw std::runtime_error("cannot write " + path);
+    }
+}
+
+// Shard `of`'s records for `layer`, or nullopt if that file is missing or
+// from another run.
+inline std::optional<std::vector<Record>> read_layer(const Spec& s, const std::string& name, int layer, int of,
+                                                     uint64_t key){
+    FILE* f = fopen(s.path(name, layer, of).c_str(), "rb");
+    if(!f) return std::nullopt;
+    detail::Header h{};
+    std::vector<Record> out;
+    bool ok = fread(&h, sizeof h, 1, f) == 1 && std::memcmp(h.magic, detail::MAGIC, sizeof h.magic) == 0
+           && h.key == key && h.layer == layer && h.shard == of && h.n_shards == s.count && h.n_records >= 0;
+    if(ok) out.resize(size_t(h.n_records));
+    for(size_t i=0; ok && i<out.size(); ++i){
+        int32_t n = 0;
+        ok = fread(&out[i].k, sizeof out[i].k, 1, f) == 1 && fread(&n, sizeof n, 1, f) == 1 && n >= 0;
+        if(ok){ out[i].v.resize(size_t(n)); ok = fread(out[i].v.data(), sizeof(double), size_t(n), f) == size_t(n); }
+    }
+    fclose(f);
+    if(!ok) return std::nullopt;
+    return out;
+}
+
+// read_layer, waiting for the file to appear (polling every poll_ms).
+inline std::vector<Record> wait_layer(const Spec& s, const std::string& name, int layer, int of, uint64_t key,
+                                      int poll_ms = 200){
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(s.timeout_s);
+    for(;;){
+        if(auto r = read_layer(s, name, layer, of, key)) return std::move(*r);
+        if(std::chrono::steady_clock::now() > deadline)
+            throw std::runtime_error("timed out waiting for " + s.path(name, layer, of));
+        std::this_thread::sleep_for(std::chrono::milliseconds(poll_ms));
+    }
+}
+
+} // namespace shard
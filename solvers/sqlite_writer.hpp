@@ -0,0 +1,244 @@
+// Bulk SQLite output shared by the event solvers.
+//
+// Db opens a database for a one-shot bulk load (no journal, no fsync) and
+// turns every SQLite failure into std::runtime_error. Inserter appends rows
+// through a prepared multi-row "INSERT ... VALUES (...),(...),..." statement:
+// values are buffered for `batch` rows and stepped once per batch, and a
+// statement sized for the remainder flushes the final partial batch. The
+// batch is capped so a statement stays within SQLite's bound-parameter
+// limit (SQLITE_LIMIT_VARIABLE_NUMBER, 32766 by default, 999 before 3.32).
+//
+// Callers insert rows in PRIMARY KEY order into WITHOUT ROWID tables, so each
+// batch appends to the rightmost leaf of the table B-tree and no secondary
+// index is needed.
+//
+// solver_rules records, per output (an event's table group), the rule
+// fingerprint it was generated for (rules.hpp).
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sqlite3.h>
+
+#include "rules.hpp"
+#include "score_pmf.hpp"
+
+namespace sqlw {
+
+class Db {
+public:
+    explicit Db(const std::string& path){
+        if(sqlite3_open(path.c_str(), &db_)!=SQLITE_OK){
+            std::string msg = db_ ? sqlite3_errmsg(db_) : "out of memory";
+            sqlite3_close(db_);
+            throw std::runtime_error("sqlite open failed: " + path + ": " + msg);
+        }
+        exec("PRAGMA journal_mode=OFF;");
+        exec("PRAGMA synchronous=OFF;");
+    }
+    ~Db(){ sqlite3_close(db_); }
+    Db(const Db&) = delete;
+    Db& operator=(const Db&) = delete;
+
+    void exec(const std::string& sql){
+        char* err = nullptr;
+        if(sqlite3_exec(db_, sql.c_str(), nullptr, nullptr, &err)!=SQLITE_OK){
+            std::string msg = err ? err : "(unknown sqlite error)";
+            sqlite3_free(err);
+            throw std::runtime_error("sqlite error: " + msg);
+        }
+    }
+
+    sqlite3_stmt* prepare(const std::string& sql){
+        sqlite3_stmt* st = nullptr;
+        if(sqlite3_prepare_v2(db_, sql.c_str(), -1, &st, nullptr)!=SQLITE_OK)
+            throw std::runtime_error("sqlite prepare failed: " + std::string(sqlite3_errmsg(db_)));
+        return st;
+    }
+
+    // First column of the first row as text; nullopt if there is no row or it is NULL.
+    std::optional<std::string> query_text(const std::string& sql, const std::string& arg){
+        sqlite3_stmt* st = prepare(sql);
+        sqlite3_bind_text(st, 1, arg.c_str(), -1, SQLITE_TRANSIENT);
+        std::optional<std::string> out;
+        if(sqlite3_step(st)==SQLITE_ROW && sqlite3_column_type(st, 0)!=SQLITE_NULL)
+            out = reinterpret_cast<const char*>(sqlite3_column_text(st, 0));
+        sqlite3_finalize(st);
+        return out;
+    }
+
+    bool has_table(const std::string& name){
+        return query_text("SELECT name FROM sqlite_master WHERE type='table' AND name=?;", name).has_value();
+    }
+
+    void begin(){ exec("BEGIN;"); }
+    void commit(){ exec("COMMIT;"); }
+
+    sqlite3* handle(){ return db_; }
+
+private:
+    sqlite3* db_ = nullptr;
+};
+
+class Inserter {
+public:
+    Inserter(Db& db, std::string table, std::vector<std::string> cols, int batch = 256)
+        : db_(db), table_(std::move(table)), cols_(std::move(cols)), batch_(max_batch(batch)) {
+        vals_.reserve(size_t(batch_) * cols_.size());
+        full_ = db_.prepare(sql(batch_));
+    }
+    ~Inserter(){ sqlite3_finalize(full_); }
+    Inserter(const Inserter&) = delete;
+    Inserter& operator=(const Inserter&) = delete;
+
+    Inserter& i(int64_t v){ vals_.push_back({Val::INT, v, 0, nullptr}); return *this; }
+    Inserter& d(double v){ vals_.push_back({Val::REAL, 0, v, nullptr}); return *this; }
+    Inserter& null(){ vals_.push_back({Val::NUL, 0, 0, nullptr}); return *this; }
+    // The string must stay alive until the row is flushed.
+    Inserter& text(const char* s){ vals_.push_back({Val::TEXT, 0, 0, s}); return *this; }
+
+    void end_row(){
+        if(vals_.size() % cols_.size()) throw std::logic_error("sqlw::Inserter: row has wrong column count");
+        if(++rows_ == batch_) flush(full_);
+    }
+
+    // Write the remaining partial batch; call before COMMIT.
+    void finish(){
+        if(rows_==0) return;
+        sqlite3_stmt* tail = db_.prepare(sql(rows_));
+        try { flush(tail); } catch(...){ sqlite3_finalize(tail); throw; }
+        sqlite3_finalize(tail);
+    }
+
+    int64_t rows_written() const { return written_; }
+
+private:
+    struct Val { enum Kind { INT, REAL, NUL, TEXT } kind; int64_t i; double d; const char* s; };
+
+    // `batch`, lowered to the rows whose parameters fit in one statement; at least 1.
+    int max_batch(int batch) const {
+        const int fit = sqlite3_limit(db_.handle(), SQLITE_LIMIT_VARIABLE_NUMBER, -1) / int(cols_.size());
+        return std::max(1, std::min(batch, fit));
+    }
+
+    std::string sql(int rows) const {
+        std::string one = "(";
+        for(size_t c=0; c<cols_.size(); ++c) one += c ? ",?" : "?";
+        one += ")";
+        std::string q = "INSERT INTO " + table_ + " (";
+        for(size_t c=0; c<cols_.size(); ++c){ if(c) q += ","; q += cols_[c]; }
+        q += ") VALUES ";
+        for(int r=0; r<rows; ++r){ if(r) q += ","; q += one; }
+        return q + ";";
+    }
+
+    void flush(sqlite3_stmt* st){
+        for(size_t k=0; k<vals_.size(); ++k){
+            const Val& v = vals_[k];
+            int p = int(k) + 1;
+            switch(v.kind){
+                case Val::INT:  sqlite3_bind_int64 (st, p, v.i); break;
+                case Val::REAL: sqlite3_bind_double(st, p, v.d); break;
+                case Val::NUL:  sqlite3_bind_null  (st, p); break;
+                case Val::TEXT: sqlite3_bind_text  (st, p, v.s, -1, SQLITE_STATIC); break;
+            }
+        }
+        int rc = sqlite3_step(st);
+        sqlite3_reset(st);
+        if(rc!=SQLITE_DONE)
+            throw std::runtime_error("sqlite insert into " + table_ + " failed: " + sqlite3_errmsg(db_.handle()));
+        written_ += rows_;
+        rows_ = 0;
+        vals_.clear();
+    }
+
+    Db& db_;
+    std::string table_;
+    std::vector<std::string> cols_;
+    int batch_;
+    int rows_ = 0;
+    int64_t written_ = 0;
+    std::vector<Val> vals_;
+    sqlite3_stmt* full_ = nullptr;
+};
+
+// (Re)create `table(score, pmf, cdf)` from a pmf::Pmf-style histogram, one
+// row per score in the histogram's range.
+template<class Pmf>
+void write_pmf_table(Db& db, const std::string& table, const Pmf& d){
+    db.exec("DROP TABLE IF EXISTS " + table + ";");
+    db.exec("CREATE TABLE " + table + "(score INTEGER PRIMARY KEY, pmf REAL NOT NULL, cdf REAL NOT NULL);");
+    auto cdf = d.cdf();
+    Inserter ins(db, table, {"score","pmf","cdf"}, Pmf::N);
+    for(int i=0; i<Pmf::N; ++i) ins.i(Pmf::MIN + i).d(d.p[i]).d(cdf[i]).end_row();
+    ins.finish();
+}
+
+// (Re)create `table(target, p_max, p_policy)`: for every target score, the
+// best achievable P(score >= target) (dp::Solver::reach, each target under
+// its own policy) and the same probability under the policy of the PMF d.
+template<class Pmf, class Reach>
+void write_reach_table(Db& db, const std::string& table, const Reach& best, const Pmf& d){
+    db.exec("DROP TABLE IF EXISTS " + table + ";");
+    db.exec("CREATE TABLE " + table + "(target INTEGER PRIMARY KEY, p_max REAL NOT NULL, p_policy REAL NOT NULL);");
+    Inserter ins(db, table, {"target","p_max","p_policy"}, Pmf::N);
+    double tail = 0;
+    std::vector<double> at_least(Pmf::N);
+    for(int i=Pmf::N-1; i>=0; --i){ tail += d.p[i]; at_least[i] = tail; }
+    for(int i=0; i<Pmf::N; ++i) ins.i(Pmf::MIN + i).d(best[i]).d(at_least[i]).end_row();
+    ins.finish();
+}
+
+inline void write_pmf_table(Db& db, const std::string& table, const pmf::Dist& d){
+    db.exec("DROP TABLE IF EXISTS " + table + ";");
+    db.exec("CREATE TABLE " + table + "(score INTEGER PRIMARY KEY, pmf REAL NOT NULL, cdf REAL NOT NULL);");
+    Inserter ins(db, table, {"score","pmf","cdf"}, 256);
+    double cdf = 0;
+    for(size_t i=0; i<d.p.size(); ++i){ cdf += d.p[i]; ins.i(d.lo + int(i)).d(d.p[i]).d(cdf).end_row(); }
+    ins.finish();
+}
+
+// Read a table written by write_pmf_table back as a pmf::Dist.
+inline pmf::Dist read_pmf_table(Db& db, const std::string& table){
+    if(!db.has_table(table)) throw std::runtime_error("no table " + table);
+    sqlite3_stmt* st = db.prepare("SELECT score, pmf FROM " + table + " ORDER BY score;");
+    pmf::Dist d;
+    while(sqlite3_step(st)==SQLITE_ROW){
+        int score = sqlite3_column_int(st, 0);
+        if(d.p.empty()) d.lo = score;
+        d.p.resize(score - d.lo + 1);
+        d.p.back() = sqlite3_column_double(st, 1);
+    }
+    sqlite3_finalize(st);
+    if(d.p.empty()) throw std::runtime_error("table " + table + " is empty");
+    return d;
+}
+
+// Fingerprint text stored for `output`, if any.
+inline std::optional<std::string> read_rules(Db& db, const std::string& output){
+    if(!db.has_table("solver_rules")) return std::nullopt;
+    return db.query_text("SELECT rules FROM solver_rules WHERE output=?;", output);
+}
+
+// Record fp for fp.output(); call inside the transaction that writes the
+// output's tables, after them, so a stored fingerprint implies complete tables.
+inline void write_rules(Db& db, const rules::Fingerprint& fp){
+    db.exec("CREATE TABLE IF NOT EXISTS solver_rules(output TEXT PRIMARY KEY, rules TEXT NOT NULL,"
+            " hash TEXT NOT NULL) WITHOUT ROWID;");
+    sqlite3_stmt* st = db.prepare("INSERT OR REPLACE INTO solver_rules VALUES (?,?,?);");
+    std::string hex = fp.hex();
+    sqlite3_bind_text(st, 1, fp.output().c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(st, 2, fp.text().c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(st, 3, hex.c_str(), -1, SQLITE_TRANSIENT);
+    int rc = sqlite3_step(st);
+    sqlite3_finalize(st);
+    if(rc!=SQLITE_DONE) throw std::runtime_error("sqlite insert into solver_rules failed: " +
+                                                 std::string(sqlite3_errmsg(db.handle())));
+}
+
+} // namespace sqlw
@@ -0,0 +1,78 @@
+// SQLite output of the 100m solver (schema below), shared by the solver and
+// the tools that time or compare it.
+//
+//   states100m(stage,rerolls,d1..d4,set1_score,ev_freeze,sd_freeze,ev_reroll,sd_reroll,best)
+//   actions100m(code,name)
+//   pmf100m(score,pmf,cdf)
+//   reach100m(target,p_max,p_policy)   if the solver tracked reach()
+#pragma once
+#include <cstdint>
+#include <string>
+
+#include "dp_engine.hpp"
+#include "event_100m.hpp"
+#include "sqlite_writer.hpp"
+
+namespace store {
+
+// states100m rows in primary-key order. set1_score is 0 for stage 1 (WITHOUT
+// ROWID keys cannot be NULL) and best is the action code, named in actions100m.
+// pmf100m holds the exact final-score PMF/CDF under the solved policy (the
+// optimal one for the solver's objective).
+// Rows with rerolls <= keep are assumed current and left in place. Returns
+// the number of states100m rows written. The solver is for events::M100 or
+// events::M100Offset; either way every set1_score gets its rows.
+template<class Event>
+int64_t write_100m(sqlw::Db& db, const dp::Solver<Event>& solver, int keep = -1, int batch = 256){
+    using events::M100;
+    const M100 ev(solver.event().rules);
+    if(keep < 0){
+        db.exec("DROP TABLE IF EXISTS states100m;");
+        db.exec("DROP TABLE IF EXISTS actions100m;");
+        db.exec(
+            "CREATE TABLE states100m ("
+            " stage INTEGER NOT NULL,"
+            " rerolls INTEGER NOT NULL,"
+            " d1 INTEGER NOT NULL, d2 INTEGER NOT NULL, d3 INTEGER NOT NULL, d4 INTEGER NOT NULL,"
+            " set1_score INTEGER NOT NULL,"    // 0 for stage 1
+            " ev_freeze REAL NOT NULL, sd_freeze REAL NOT NULL,"
+            " ev_reroll REAL, sd_reroll REAL,"
+            " best INTEGER NOT NULL,"          // 0 freeze, 1 reroll
+            " PRIMARY KEY (stage,rerolls,d1,d2,d3,d4,set1_score)"
+            ") WITHOUT ROWID;"
+        );
+        db.exec("CREATE TABLE actions100m (code INTEGER PRIMARY KEY, name TEXT NOT NULL);");
+        db.exec("INSERT INTO actions100m VALUES (0,'freeze'),(1,'reroll');");
+    }
+
+    db.begin();
+    if(keep >= 0) db.exec("DELETE FROM states100m WHERE rerolls > " + std::to_string(keep) + ";");
+    sqlw::Inserter ins(db, "states100m",
+        {"stage","rerolls","d1","d2","d3","d4","set1_score","ev_freeze","sd_freeze","ev_reroll","sd_reroll","best"},
+        batch);
+    // stream the dense table in index (= primary key) order
+    for(int idx=0; idx<ev.n_states(); ++idx){
+        const M100::State s = ev.state_at(idx);
+        if(s.rerolls <= keep) continue;
+        const uint8_t* d = dice::OUTCOMES<4>[s.pat].dice;
+        const auto [at, offset] = solver.event().fold(idx);    // the offset shifts EV, not SD
+        const dp::Moments f = solver.action_moments(at, M100::FREEZE);
+        ins.i(s.stage).i(s.rerolls).i(d[0]).i(d[1]).i(d[2]).i(d[3])
+           .i(s.stage==1 ? 0 : s.set1_score)
+           .d(f.ev + offset).d(f.sd());
+        if(s.rerolls>0){
+            const dp::Moments r = solver.action_moments(at, M100::REROLL);
+            ins.d(r.ev + offset).d(r.sd());
+        } else ins.null().null();
+        ins.i(solver.action(at));
+        ins.end_row();
+    }
+    ins.finish();
+    sqlw::write_pmf_table(db, "pmf100m", solver.root().pmf);
+    if(solver.tracks_reach()) sqlw::write_reach_table(db, "reach100m", solver.reach(), solver.root().pmf);
+    sqlw::write_rules(db, dp::fingerprint(ev, solver.objective()));
+    db.commit();
+    return ins.rows_written();
+}
+
+} // namespace store
@@ -0,0 +1,218 @@
+// Arrow IPC export (arrow_ipc.hpp) of the solver tables, for dataframes:
+//
+//   write_100m_arrow          stage, rerolls, d1..d4, set1_score, best,
+//                             ev_freeze, ev2_freeze, ev_reroll, ev2_reroll
+//   write_longjump_arrow      phase, sum_frozen, n1..n6, freeze_count, ev, ev2
+//   write_longjump_bo3_arrow  attempt, best, then as write_longjump_arrow
+//
+// Row i is state index i of the binary policy (policy::m100::index,
+// policy::longjump::index, LongJumpBo3::index), so the table is dense: states
+// no policy reaches have action dp::NO_ACTION (255) and NaN moments. ev2 is
+// E[X^2] (sd = sqrt(ev2 - ev^2)); the moments are NaN where an action is not
+// legal. With pmf, a "pmf" column holds, per state, the distribution of the
+// score from there on under the chosen action, as a fixed-size list over
+// score_min.. (schema metadata, with the rules and the root moments). For the
+// long jump attempt that is the score still to come, since a jump state does
+// not carry its sum.
+//
+// The action column and, for an events::M100 solve, the moment columns are
+// the solver's arrays (Solver::actions, action_ev, action_ev2), written as
+// they are. The folded stage 2 of events::M100Offset is fanned out to every
+// set1_score, like states100m, so those rows are gathered through fold(). The
+// long jump solver keeps no moments per decision state, so ev/ev2 there are
+// those of the chosen action's edge, from the chance-node values.
+#pragma once
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "arrow_ipc.hpp"
+#include "dp_engine.hpp"
+#include "event_100m.hpp"
+#include "event_longjump.hpp"
+
+namespace store {
+
+// Calls f(s, edge of the chosen action) for every solved decision state.
+template<class Event, class F>
+void for_each_choice(const dp::Solver<Event>& solver, F&& f){
+    const Event& ev = solver.event();
+    for(int c=0; c<ev.n_chance(); ++c){
+        if(!solver.reachable(c)) continue;
+        const auto outs = dice::outcomes(ev.dice(c));
+        for(int i=0; i<int(outs.size()); ++i){
+            const int s = ev.state(c, i, outs[i]);
+            ev.actions(c, i, outs[i], [&](int a, dp::Edge e){ if(a == solver.action(s)) f(s, e); });
+        }
+    }
+}
+
+// out[0, Score::N) = distribution of (reward + score from e on), moved up by shift.
+template<class Event>
+void edge_pmf(const dp::Solver<Event>& solver, const dp::Edge& e, int shift, double* out){
+    using Score = typename Event::Score;
+    Score d;
+    if(e.next == dp::TERMINAL) d.add_point(e.reward + shift, 1.0);
+    else d.add(solver.value(e.next).pmf, 1.0, e.reward + shift);
+    std::copy(d.p.begin(), d.p.end(), out);
+}
+
+// Metadata every export carries.
+template<class Event>
+void arrow_meta(arrowipc::Writer& w, const dp::Solver<Event>& solver, const rules::Fingerprint& fp){
+    char buf[64];
+    w.set_meta("rules", fp.text());
+    w.set_meta("rules_hash", fp.hex());
+    w.set_meta("objective", solver.objective().text());
+    snprintf(buf, sizeof buf, "%.17g", solver.root().m.ev);   w.set_meta("root_ev", buf);
+    snprintf(buf, sizeof buf, "%.17g", solver.root().m.sd()); w.set_meta("root_sd", buf);
+    w.set_meta("score_min", std::to_string(Event::Score::MIN));
+}
+
+// The solver is for events::M100 or events::M100Offset.
+template<class Event>
+void write_100m_arrow(const dp::Solver<Event>& solver, const std::string& path, bool pmf = false){
+    using events::M100;
+    using Score = typename Event::Score;
+    constexpr bool folded = !std::is_same_v<Event, M100>;
+    const Event& solved = solver.event();
+    const M100 ev(solved.rules);
+    const size_t n = size_t(ev.n_states());
+    std::vector<uint8_t> stage(n), rerolls(n), d[4], best;
+    std::vector<int8_t> set1(n);
+    std::vector<double> mom[2*M100::N_ACTIONS];
+    for(auto& v: d) v.resize(n);
+    for(size_t idx=0; idx<n; ++idx){
+        const M100::State s = ev.state_at(int(idx));
+        stage[idx] = uint8_t(s.stage); rerolls[idx] = uint8_t(s.rerolls);
+        for(int k=0; k<4; ++k) d[k][idx] = dice::OUTCOMES<4>[s.pat].dice[k];
+        set1[idx] = int8_t(s.stage==1 ? 0 : s.set1_score);
+    }
+    // the solver's own columns, unless stage 2 is folded
+    std::span<const uint8_t> best_col = solver.actions();
+    std::span<const double> mom_col[2*M100::N_ACTIONS];
+    if constexpr(folded){
+        best.resize(n);
+        for(auto& v: mom) v.resize(n);
+        for(size_t idx=0; idx<n; ++idx){
+            const auto [at, offset] = solved.fold(int(idx));
+            best[idx] = solver.action(at);
+            for(int a=0; a<M100::N_ACTIONS; ++a){
+                const dp::Moments m = solver.action_moments(at, a).shifted(offset);
+                mom[2*a][idx] = m.ev; mom[2*a+1][idx] = m.ev2;
+            }
+        }
+        best_col = best;
+        for(int k=0; k<2*M100::N_ACTIONS; ++k) mom_col[k] = mom[k];
+    } else
+        for(int a=0; a<M100::N_ACTIONS; ++a){ mom_col[2*a] = solver.action_ev(a); mom_col[2*a+1] = solver.action_ev2(a); }
+    // per solver state, then fanned out like the moments
+    std::vector<double> dist;
+    if(pmf){
+        std::vector<double> at_state(size_t(solved.n_states())*Score::N, 0.0);
+        for_each_choice(solver, [&](int s, const dp::Edge& e){ edge_pmf(solver, e, 0, &at_state[size_t(s)*Score::N]); });
+        dist.assign(n*Score::N, 0.0);
+        for(size_t idx=0; idx<n; ++idx){
+            const auto [at, offset] = solved.fold(int(idx));
+            Score p, q;
+            std::copy_n(&at_state[size_t(at)*Score::N], Score::N, p.p.begin());
+            q.add(p, 1.0, offset);
+            std::copy(q.p.begin(), q.p.end(), &dist[idx*Score::N]);
+        }
+    }
+
+    arrowipc::Writer w;
+    w.add<uint8_t>("stage", stage);
+    w.add<uint8_t>("rerolls", rerolls);
+    for(int k=0; k<4; ++k) w.add<uint8_t>("d" + std::to_string(k+1), d[k]);
+    w.add<int8_t>("set1_score", set1);
+    w.add<uint8_t>("best", best_col);
+    w.add<double>("ev_freeze", mom_col[0]);  w.add<double>("ev2_freeze", mom_col[1]);
+    w.add<double>("ev_reroll", mom_col[2]);  w.add<double>("ev2_reroll", mom_col[3]);
+    if(pmf) w.add_list("pmf", dist, Score::N);
+    w.set_meta("event", "100m");
+    arrow_meta(w, solver, dp::fingerprint(ev, solver.objective()));
+    w.write(path);
+}
+
+namespace detail {
+
+// Key, action and moment columns shared by the long jump exports; post(s)
+// gives the (phase, sum_frozen, counts) of state s.
+template<class Event, class Post>
+void longjump_arrow(arrowipc::Writer& w, const dp::Solver<Event>& solver, bool pmf, std::vector<uint8_t>& phase,
+                    std::vector<uint8_t>& sum, std::array<std::vector<uint8_t>, 6>& counts,
+                    std::vector<double>& mean, std::vector<double>& mean2, std::vector<double>& dist, Post&& post){
+    using events::lj::COUNTS_AT;
+    using Score = typename Event::Score;
+    const size_t n = size_t(solver.event().n_states());
+    phase.resize(n); sum.resize(n);
+    for(auto& v: counts) v.resize(n);
+    for(size_t s=0; s<n; ++s){
+        const auto [ph, sf, k] = post(int(s));
+        phase[s] = uint8_t(ph); sum[s] = uint8_t(sf);
+        for(int f=0; f<6; ++f) counts[f][s] = uint8_t(COUNTS_AT[k][f+1]);
+    }
+    mean.assign(n, NAN); mean2.assign(n, NAN);
+    if(pmf) dist.assign(n*Score::N, 0.0);
+    for_each_choice(solver, [&](int s, const dp::Edge& e){
+        const dp::Moments m = e.next==dp::TERMINAL ? dp::Moments{double(e.reward), double(e.reward)*double(e.reward)}
+                                                    : solver.value(e.next).m.shifted(e.reward);
+        mean[size_t(s)] = m.ev; mean2[size_t(s)] = m.ev2;
+        if(pmf) edge_pmf(solver, e, 0, &dist[size_t(s)*Score::N]);
+    });
+    w.add<uint8_t>("phase", phase);
+    w.add<uint8_t>("sum_frozen", sum);
+    for(int f=0; f<6; ++f) w.add<uint8_t>("n" + std::to_string(f+1), counts[f]);
+    w.add<uint8_t>("freeze_count", solver.actions());
+    w.add<double>("ev", mean);
+    w.add<double>("ev2", mean2);
+    if(pmf) w.add_list("pmf", dist, Score::N);
+}
+
+} // namespace detail
+
+inline void write_longjump_arrow(const dp::Solver<events::LongJump>& solver, const std::string& path, bool pmf = false){
+    const events::LongJump& ev = solver.event();
+    std::vector<uint8_t> phase, sum;
+    std::array<std::vector<uint8_t>, 6> counts;
+    std::vector<double> mean, mean2, dist;
+    arrowipc::Writer w;
+    detail::longjump_arrow(w, solver, pmf, phase, sum, counts, mean, mean2, dist, [&](int s){
+        const auto p = ev.post_at(s);
+        return std::array<int,3>{p.phase, p.sum_frozen, p.counts};
+    });
+    w.set_meta("event", "longjump");
+    arrow_meta(w, solver, ev.fingerprint());
+    w.write(path);
+}
+
+inline void write_longjump_bo3_arrow(const dp::Solver<events::LongJumpBo3>& solver, const std::string& path,
+                                     bool pmf = false){
+    const events::LongJumpBo3& ev = solver.event();
+    const size_t n = size_t(ev.n_states());
+    std::vector<uint8_t> attempt(n), best(n), phase, sum;
+    std::array<std::vector<uint8_t>, 6> counts;
+    std::vector<double> mean, mean2, dist;
+    for(size_t s=0; s<n; ++s){
+        const auto p = ev.post_at(int(s));
+        attempt[s] = uint8_t(p.attempt); best[s] = uint8_t(p.best);
+    }
+    arrowipc::Writer w;
+    w.add<uint8_t>("attempt", attempt);
+    w.add<uint8_t>("best", best);
+    detail::longjump_arrow(w, solver, pmf, phase, sum, counts, mean, mean2, dist, [&](int s){
+        const auto p = ev.post_at(s);
+        return std::array<int,3>{p.phase, p.sum_frozen, p.counts};
+    });
+    w.set_meta("event", "longjump_bo3");
+    arrow_meta(w, solver, dp::fingerprint(ev, solver.objective()));
+    w.write(path);
+}
+
+} // namespace store
@@ -0,0 +1,126 @@
+// SQLite output of the long jump solver (schema in longjump_precompute.cpp),
+// shared by the solver and the tools that time or compare it.
+//
+//   write_longjump      lj_post_simple, lj_attempt_pmf, attempt keys of lj_meta
+//   write_longjump_bo3  lj_bo3_post, lj_bo3_value, lj_bo3_pmf, bo3 keys of lj_meta
+// plus lj_attempt_reach / lj_bo3_reach when the solver tracked reach().
+#pragma once
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include "dp_engine.hpp"
+#include "event_longjump.hpp"
+#include "sqlite_writer.hpp"
+
+namespace store {
+
+// lj_meta is shared by the single-attempt and best-of-three outputs, which
+// each replace only their own keys.
+inline void create_lj_meta(sqlw::Db& db){
+    db.exec("CREATE TABLE IF NOT EXISTS lj_meta(key TEXT PRIMARY KEY,value REAL) WITHOUT ROWID;");
+}
+
+// Policy rows sorted into primary-key order; sum_frozen is 0 for JUMP_POST
+// (WITHOUT ROWID keys cannot be NULL).
+inline void write_longjump(sqlw::Db& db, const dp::Solver<events::LongJump>& solver, int batch = 256){
+    using events::LongJump; using events::lj::COUNTS_AT;
+    const LongJump& ev = solver.event();
+    using Row = std::array<int,9>; // phase, sum_frozen, n1..n6, freeze_count
+    std::vector<Row> rows;
+    auto act = solver.actions();
+    for(int idx=0; idx<int(act.size()); ++idx){
+        if(act[idx]==dp::NO_ACTION) continue;
+        const LongJump::Post p = ev.post_at(idx);
+        Row r{p.phase, p.sum_frozen};
+        for(int i=1;i<=6;i++) r[1+i]=COUNTS_AT[p.counts][i];
+        r[8]=act[idx]; rows.push_back(r);
+    }
+    std::sort(rows.begin(), rows.end());
+
+    db.exec("DROP TABLE IF EXISTS lj_post_simple;");
+    db.exec("CREATE TABLE lj_post_simple(phase INTEGER NOT NULL,sum_frozen INTEGER NOT NULL,"
+            "n1 INTEGER NOT NULL,n2 INTEGER NOT NULL,n3 INTEGER NOT NULL,"
+            "n4 INTEGER NOT NULL,n5 INTEGER NOT NULL,n6 INTEGER NOT NULL,"
+            "freeze_count INTEGER NOT NULL,"
+            "PRIMARY KEY(phase,sum_frozen,n1,n2,n3,n4,n5,n6)) WITHOUT ROWID;");
+    create_lj_meta(db);
+
+    db.begin();
+    sqlw::Inserter ins(db, "lj_post_simple",
+        {"phase","sum_frozen","n1","n2","n3","n4","n5","n6","freeze_count"}, batch);
+    for(const Row& r: rows){
+        for(int v: r) ins.i(v);
+        ins.end_row();
+    }
+    ins.finish();
+
+    const auto& root=solver.root();
+    db.exec("DELETE FROM lj_meta WHERE key IN ('attempt_ev','attempt_sd');");
+    sqlw::Inserter meta(db, "lj_meta", {"key","value"}, 1);
+    meta.text("attempt_ev").d(root.m.ev).end_row();
+    meta.text("attempt_sd").d(root.m.sd()).end_row();
+    sqlw::write_pmf_table(db, "lj_attempt_pmf", root.pmf);
+    if(solver.tracks_reach()) sqlw::write_reach_table(db, "lj_attempt_reach", solver.reach(), root.pmf);
+    sqlw::write_rules(db, ev.fingerprint());
+    db.commit();
+}
+
+// lj_bo3_post rows for every solved state, in primary-key order; the values
+// of attempts that cannot be reached (attempt 0 with best > 0) are left out.
+inline void write_longjump_bo3(sqlw::Db& db, const dp::Solver<events::LongJumpBo3>& solver, int batch = 256){
+    using events::LongJumpBo3; using events::lj::COUNTS_AT;
+    const LongJumpBo3& ev = solver.event();
+    using Row = std::array<int,11>; // attempt, best, phase, sum_frozen, n1..n6, freeze_count
+    std::vector<Row> rows;
+    auto act = solver.actions();
+    for(int idx=0; idx<int(act.size()); ++idx){
+        if(act[idx]==dp::NO_ACTION) continue;
+        const LongJumpBo3::Post p = ev.post_at(idx);
+        Row r{p.attempt, p.best, p.phase, p.sum_frozen};
+        for(int f=1; f<=6; ++f) r[3+f]=COUNTS_AT[p.counts][f];
+        r[10]=act[idx]; rows.push_back(r);
+    }
+    std::sort(rows.begin(), rows.end());
+
+    db.exec("DROP TABLE IF EXISTS lj_bo3_post;");
+    db.exec("DROP TABLE IF EXISTS lj_bo3_value;");
+    db.exec("CREATE TABLE lj_bo3_post(attempt INTEGER NOT NULL,best INTEGER NOT NULL,"
+            "phase INTEGER NOT NULL,sum_frozen INTEGER NOT NULL,"
+            "n1 INTEGER NOT NULL,n2 INTEGER NOT NULL,n3 INTEGER NOT NULL,"
+            "n4 INTEGER NOT NULL,n5 INTEGER NOT NULL,n6 INTEGER NOT NULL,"
+            "freeze_count INTEGER NOT NULL,"
+            "PRIMARY KEY(attempt,best,phase,sum_frozen,n1,n2,n3,n4,n5,n6)) WITHOUT ROWID;");
+    db.exec("CREATE TABLE lj_bo3_value(attempt INTEGER NOT NULL,best INTEGER NOT NULL,ev REAL NOT NULL,"
+            "PRIMARY KEY(attempt,best)) WITHOUT ROWID;");
+
+    db.begin();
+    sqlw::Inserter ins(db, "lj_bo3_post",
+        {"attempt","best","phase","sum_frozen","n1","n2","n3","n4","n5","n6","freeze_count"}, batch);
+    for(const Row& r: rows){
+        for(int v: r) ins.i(v);
+        ins.end_row();
+    }
+    ins.finish();
+
+    sqlw::Inserter val(db, "lj_bo3_value", {"attempt","best","ev"}, batch);
+    for(int a=0; a<LongJumpBo3::N_ATTEMPTS; ++a)
+        for(int b=0; b<LongJumpBo3::N_BEST; ++b){
+            int c = ev.attempt_root(a, b);
+            if(solver.reachable(c)) val.i(a).i(b).d(solver.value(c).m.ev).end_row();
+        }
+    val.finish();
+
+    const auto& root=solver.root();
+    create_lj_meta(db);
+    db.exec("DELETE FROM lj_meta WHERE key IN ('bo3_ev','bo3_sd');");
+    sqlw::Inserter meta(db, "lj_meta", {"key","value"}, 1);
+    meta.text("bo3_ev").d(root.m.ev).end_row();
+    meta.text("bo3_sd").d(root.pmf.sd()).end_row();
+    sqlw::write_pmf_table(db, "lj_bo3_pmf", root.pmf);
+    if(solver.tracks_reach()) sqlw::write_reach_table(db, "lj_bo3_reach", solver.reach(), root.pmf);
+    sqlw::write_rules(db, dp::fingerprint(ev, solver.objective()));
+    db.commit();
+}
+
+} // namespace store
@@ -0,0 +1,106 @@
+// Minimal assertions for the regression tests: CHECK counts failures and
+// prints the first few, main returns check::result().
+//
+// Tests of the command-line tools get the build directory as argv[1], run
+// the tools in a Scratch directory with check::run and read what they wrote
+// with check::Query.
+#pragma once
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <sqlite3.h>
+
+namespace check {
+
+inline int failures = 0;
+inline int checks = 0;
+inline constexpr int MAX_REPORTED = 20;
+
+inline void fail(const char* file, int line, const char* expr){
+    if(++failures <= MAX_REPORTED) fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expr);
+}
+
+inline int result(const char* name){
+    if(failures) fprintf(stderr, "%s: %d of %d checks failed\n", name, failures, checks);
+    else fprintf(stderr, "%s: %d checks passed\n", name, checks);
+    return failures ? 1 : 0;
+}
+
+// Equal, or both NaN (a missing value on both sides).
+inline bool same(double a, double b){ return a == b || (std::isnan(a) && std::isnan(b)); }
+
+// ------------------------------------------------------------ tool tests
+
+// Fresh directory under the system temp dir, removed with its contents.
+struct Scratch {
+    std::filesystem::path dir;
+    Scratch(){
+        std::string t = (std::filesystem::temp_directory_path() / "solver_test_XXXXXX").string();
+        if(!mkdtemp(t.data())){ perror("mkdtemp"); exit(2); }
+        dir = t;
+    }
+    ~Scratch(){ std::error_code ec; std::filesystem::remove_all(dir, ec); }
+    std::string operator/(const std::string& name) const { return (dir / name).string(); }
+};
+
+// Runs a shell command in `at`; its output is only shown if it fails.
+// Returns the exit status.
+inline int status(const Scratch& at, const std::string& cmd){
+    const std::string log = at / "log";
+    const int rc = std::system(("cd '" + at.dir.string() + "' && " + cmd + " >'" + log + "' 2>&1").c_str());
+    const int code = WIFEXITED(rc) ? WEXITSTATUS(rc) : -1;
+    if(code != 0){
+        std::ifstream in(log);
+        std::cerr << in.rdbuf() << "exit status " << code << ": " << cmd << "\n";
+    }
+    return code;
+}
+inline bool run(const Scratch& at, const std::string& cmd){
+    ++checks;
+    if(status(at, cmd) == 0) return true;
+    ++failures;
+    return false;
+}
+
+// Rows of a query; NULL columns read as NaN (num) or -1 (integer).
+class Query {
+public:
+    Query(const std::string& db_path, const std::string& sql){
+        if(sqlite3_open_v2(db_path.c_str(), &db_, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK ||
+           sqlite3_prepare_v2(db_, sql.c_str(), -1, &st_, nullptr) != SQLITE_OK){
+            fprintf(stderr, "%s: %s\n", db_path.c_str(), sqlite3_errmsg(db_));
+            ++checks; ++failures;
+        }
+    }
+    ~Query(){ sqlite3_finalize(st_); sqlite3_close(db_); }
+    Query(const Query&) = delete;
+    Query& operator=(const Query&) = delete;
+
+    bool step(){ return st_ && sqlite3_step(st_) == SQLITE_ROW; }
+    bool null(int i) const { return sqlite3_column_type(st_, i) == SQLITE_NULL; }
+    double num(int i) const { return null(i) ? NAN : sqlite3_column_double(st_, i); }
+    int integer(int i) const { return null(i) ? -1 : sqlite3_column_int(st_, i); }
+    std::string text(int i) const {
+        const unsigned char* t = sqlite3_column_text(st_, i);
+        return t ? reinterpret_cast<const char*>(t) : "";
+    }
+
+private:
+    sqlite3* db_ = nullptr;
+    sqlite3_stmt* st_ = nullptr;
+};
+
+// First column of the first row, NaN if there is none.
+inline double scalar(const std::string& db_path, const std::string& sql){
+    Query q(db_path, sql);
+    return q.step() ? q.num(0) : NAN;
+}
+
+} // namespace check
+
+#define CHECK(cond) do { ++check::checks; if(!(cond)) check::fail(__FILE__, __LINE__, #cond); } while(0)
@@ -0,0 +1,287 @@
+// Arrow IPC files (arrow_ipc.hpp, store_arrow.hpp) read back with a reader
+// written from the format spec (File.fbs, Message.fbs, Schema.fbs), not from
+// the writer: the magic, footer, schema (names, types, metadata) and record
+// batch (field nodes, 64-byte aligned buffers) must describe the columns the
+// solver wrote.
+#include <bits/stdc++.h>
+#include "../arrow_ipc.hpp"
+#include "../dp_engine.hpp"
+#include "../event_100m.hpp"
+#include "../event_longjump.hpp"
+#include "../store_arrow.hpp"
+#include "check.hpp"
+using namespace std;
+
+// Flatbuffer tables over a byte buffer; offsets are absolute.
+struct Fb {
+    const vector<uint8_t>& b;
+
+    template<class T> T get(size_t at) const {
+        if(at + sizeof(T) > b.size()) throw runtime_error("read past the end of the file");
+        T v;
+        memcpy(&v, &b[at], sizeof(T));
+        return v;
+    }
+    size_t deref(size_t at) const { return at + get<uint32_t>(at); }
+    // position of field id of the table at t, or 0 if absent
+    size_t field(size_t t, int id) const {
+        const size_t vt = t - get<int32_t>(t);
+        const uint16_t vt_size = get<uint16_t>(vt);
+        if(4 + 2*id >= vt_size) return 0;
+        const uint16_t off = get<uint16_t>(vt + 4 + 2*id);
+        return off ? t + off : 0;
+    }
+    template<class T> T scalar(size_t t, int id, T def = 0) const {
+        const size_t f = field(t, id);
+        return f ? get<T>(f) : def;
+    }
+    size_t table(size_t t, int id) const {
+        const size_t f = field(t, id);
+        return f ? deref(f) : 0;
+    }
+    // vector field: (count, position of element 0)
+    pair<uint32_t, size_t> vec(size_t t, int id) const {
+        const size_t f = field(t, id);
+        if(!f) return {0, 0};
+        const size_t v = deref(f);
+        return {get<uint32_t>(v), v + 4};
+    }
+    string str(size_t t, int id) const {
+        const auto [n, at] = vec(t, id);
+        return n ? string(reinterpret_cast<const char*>(&b[at]), n) : string();
+    }
+};
+
+struct Column {
+    string name;
+    uint8_t type = 0;            // Schema.fbs Type: 2 Int, 3 FloatingPoint, 16 FixedSizeList
+    int bits = 0;                // Int
+    bool is_signed = false;
+    int list_size = 0;           // FixedSizeList
+    int64_t length = 0;          // values (list: child values)
+    const uint8_t* data = nullptr;
+    int64_t bytes = 0;
+
+    template<class T> T at(size_t i) const {
+        T v;
+        memcpy(&v, data + i*sizeof(T), sizeof(T));
+        return v;
+    }
+};
+
+struct Table {
+    vector<uint8_t> file;
+    int64_t rows = 0;
+    vector<Column> cols;
+    map<string, string> meta;
+
+    const Column& col(const string& name) const {
+        for(const Column& c: cols) if(c.name == name) return c;
+        throw runtime_error("no column " + name);
+    }
+};
+
+static Table read_arrow(const string& path){
+    Table t;
+    {
+        ifstream in(path, ios::binary);
+        t.file.assign(istreambuf_iterator<char>(in), {});
+    }
+    const vector<uint8_t>& b = t.file;
+    const Fb fb{b};
+    if(b.size() < 22 || memcmp(b.data(), "ARROW1\0\0", 8) || memcmp(&b[b.size()-6], "ARROW1", 6))
+        throw runtime_error(path + ": bad magic");
+    const int32_t footer_len = fb.get<int32_t>(b.size() - 10);
+    const size_t footer = fb.deref(b.size() - 10 - size_t(footer_len));
+    CHECK(fb.scalar<int16_t>(footer, 0) == 4);                            // MetadataVersion V5
+
+    const size_t schema = fb.table(footer, 1);
+    CHECK(fb.scalar<int16_t>(schema, 0) == 0);                            // little-endian
+    const auto [nf, fields] = fb.vec(schema, 1);
+    for(uint32_t i=0; i<nf; ++i){
+        const size_t f = fb.deref(fields + 4*i);
+        Column c;
+        c.name = fb.str(f, 0);
+        CHECK(fb.scalar<uint8_t>(f, 1) == 0);                             // not nullable
+        c.type = fb.scalar<uint8_t>(f, 2);
+        const size_t ty = fb.table(f, 3);
+        if(c.type == 2){ c.bits = fb.scalar<int32_t>(ty, 0); c.is_signed = fb.scalar<uint8_t>(ty, 1); }
+        else if(c.type == 3) CHECK(fb.scalar<int16_t>(ty, 0) == 2);        // DOUBLE
+        else if(c.type == 16){
+            c.list_size = fb.scalar<int32_t>(ty, 0);
+            const auto [nc, ch] = fb.vec(f, 5);
+            CHECK(nc == 1 && fb.scalar<uint8_t>(fb.deref(ch), 2) == 3);
+        } else CHECK(!"unexpected column type");
+        t.cols.push_back(c);
+    }
+    const auto [nm, kvs] = fb.vec(schema, 2);
+    for(uint32_t i=0; i<nm; ++i){
+        const size_t kv = fb.deref(kvs + 4*i);
+        t.meta[fb.str(kv, 0)] = fb.str(kv, 1);
+    }
+
+    const auto [nb, blocks] = fb.vec(footer, 3);
+    CHECK(nb == 1);
+    const int64_t offset = fb.get<int64_t>(blocks), meta_len = fb.get<int32_t>(blocks + 8),
+                  body_len = fb.get<int64_t>(blocks + 16);
+    CHECK(fb.get<uint32_t>(size_t(offset)) == 0xFFFFFFFFu);
+    CHECK(int64_t(fb.get<int32_t>(size_t(offset) + 4)) + 8 == meta_len);
+    const size_t msg = fb.deref(size_t(offset) + 8);
+    CHECK(fb.scalar<uint8_t>(msg, 1) == 3);                               // RecordBatch
+    CHECK(fb.scalar<int64_t>(msg, 3) == body_len);
+    const size_t batch = fb.table(msg, 2);
+    const int64_t body = offset + meta_len;
+    CHECK(body % 64 == 0 && size_t(body + body_len) <= b.size());
+    t.rows = fb.scalar<int64_t>(batch, 0);
+    const auto [n_nodes, nodes] = fb.vec(batch, 1);
+    const auto [n_bufs, bufs] = fb.vec(batch, 2);
+    uint32_t node = 0, buf = 0;
+    auto next_node = [&]{ CHECK(node < n_nodes); const size_t at = nodes + 16*node++;
+                          CHECK(fb.get<int64_t>(at + 8) == 0); return fb.get<int64_t>(at); };
+    auto next_buf = [&]{ CHECK(buf < n_bufs); const size_t at = bufs + 16*buf++;
+                         return pair{fb.get<int64_t>(at), fb.get<int64_t>(at + 8)}; };
+    for(Column& c: t.cols){
+        c.length = next_node();
+        CHECK(c.length == t.rows);
+        CHECK(next_buf().second == 0);                                    // no validity bitmap
+        if(c.type == 16){
+            c.length = next_node();
+            CHECK(c.length == t.rows * c.list_size);
+            CHECK(next_buf().second == 0);
+        }
+        const auto [off, len] = next_buf();
+        CHECK(off % 64 == 0 && off + len <= body_len);
+        c.data = &b[size_t(body + off)];
+        c.bytes = len;
+        CHECK(len == c.length * (c.type == 2 ? c.bits/8 : 8));
+    }
+    CHECK(node == n_nodes && buf == n_bufs);
+    return t;
+}
+
+static bool same(double a, double b){ return bit_cast<uint64_t>(a) == bit_cast<uint64_t>(b); }
+
+static string tmp(const string& name){
+    return (filesystem::temp_directory_path() / (name + "." + to_string(getpid()) + ".arrow")).string();
+}
+
+// Every column type the writer has, with values that show the byte order.
+static void test_writer(){
+    const vector<int8_t> i8{-1, 2, -128};
+    const vector<uint16_t> u16{1, 0x1234, 65535};
+    const vector<int64_t> i64{-1, 1ll << 40, 7};
+    const vector<double> f64{0.5, -NAN, 1e300};
+    const vector<double> list{1, 2, 3, 4, 5, 6};
+    arrowipc::Writer w;
+    w.add<int8_t>("i8", i8);
+    w.add<uint16_t>("u16", u16);
+    w.add<int64_t>("i64", i64);
+    w.add<double>("f64", f64);
+    w.add_list("pair", list, 2);
+    w.set_meta("key", "value");
+    const string path = tmp("test_arrow_writer");
+    w.write(path);
+    const Table t = read_arrow(path);
+    remove(path.c_str());
+    CHECK(t.rows == 3 && t.cols.size() == 5 && t.meta.at("key") == "value");
+    CHECK(t.col("i8").type == 2 && t.col("i8").bits == 8 && t.col("i8").is_signed);
+    CHECK(t.col("u16").bits == 16 && !t.col("u16").is_signed);
+    CHECK(t.col("f64").type == 3 && t.col("pair").type == 16 && t.col("pair").list_size == 2);
+    for(size_t i=0; i<3; ++i){
+        CHECK(t.col("i8").at<int8_t>(i) == i8[i]);
+        CHECK(t.col("u16").at<uint16_t>(i) == u16[i]);
+        CHECK(t.col("i64").at<int64_t>(i) == i64[i]);
+        CHECK(same(t.col("f64").at<double>(i), f64[i]));
+    }
+    for(size_t i=0; i<list.size(); ++i) CHECK(t.col("pair").at<double>(i) == list[i]);
+}
+
+// The 100m export, from the full and the folded solve: one row per state
+// index, the solver's actions and moments, and a PMF per state whose mean is
+// the chosen action's EV.
+template<class Event>
+static void test_100m(const Event& ev){
+    using events::M100;
+    dp::Solver<Event> solver(ev);
+    solver.solve();
+    dp::Solver<M100> full(M100(ev.rules));
+    full.solve();
+    const string path = tmp("test_arrow_100m");
+    store::write_100m_arrow(solver, path, true);
+    const Table t = read_arrow(path);
+    remove(path.c_str());
+    const M100 m(ev.rules);
+    CHECK(t.rows == m.n_states());
+    CHECK(t.meta.at("event") == "100m" && t.meta.at("rules") == m.fingerprint().text());
+    CHECK(t.meta.at("rules_hash") == m.fingerprint().hex() && t.meta.at("objective") == "ev");
+    CHECK(fabs(stod(t.meta.at("root_ev")) - full.root().m.ev) <= 1e-12);
+    const int score_min = stoi(t.meta.at("score_min"));
+    const Column& pmf = t.col("pmf");
+    for(int s=0; s<m.n_states(); ++s){
+        const M100::State st = m.state_at(s);
+        CHECK(t.col("stage").at<uint8_t>(s) == st.stage && t.col("rerolls").at<uint8_t>(s) == st.rerolls);
+        CHECK(t.col("d1").at<uint8_t>(s) == dice::OUTCOMES<4>[st.pat].dice[0]);
+        CHECK(t.col("set1_score").at<int8_t>(s) == (st.stage==1 ? 0 : st.set1_score));
+        const int a = full.action(s);
+        CHECK(t.col("best").at<uint8_t>(s) == a);
+        const dp::Moments f = full.action_moments(s, M100::FREEZE), r = full.action_moments(s, M100::REROLL);
+        CHECK(fabs(t.col("ev_freeze").at<double>(s) - f.ev) <= 1e-9);
+        CHECK(fabs(t.col("ev2_freeze").at<double>(s) - f.ev2) <= 1e-7);
+        CHECK(isnan(r.ev) ? isnan(t.col("ev_reroll").at<double>(s)) : fabs(t.col("ev_reroll").at<double>(s) - r.ev) <= 1e-9);
+        double mass = 0, mean = 0;
+        for(int k=0; k<pmf.list_size; ++k){
+            const double p = pmf.at<double>(size_t(s)*pmf.list_size + k);
+            mass += p; mean += p*(score_min + k);
+        }
+        CHECK(fabs(mass - 1) <= 1e-9 && fabs(mean - full.action_moments(s, a).ev) <= 1e-9);
+    }
+}
+
+static void test_longjump(){
+    namespace lj = events::lj;
+    dp::Solver<events::LongJump> single(events::LongJump({7}));
+    single.solve();
+    const string path = tmp("test_arrow_longjump");
+    store::write_longjump_arrow(single, path);
+    Table t = read_arrow(path);
+    remove(path.c_str());
+    const events::LongJump& ev = single.event();
+    CHECK(t.rows == ev.n_states() && t.meta.at("rules") == ev.fingerprint().text());
+    for(int s=0; s<ev.n_states(); ++s){
+        const auto p = ev.post_at(s);
+        CHECK(t.col("phase").at<uint8_t>(s) == p.phase && t.col("sum_frozen").at<uint8_t>(s) == p.sum_frozen);
+        for(int f=0; f<6; ++f) CHECK(t.col("n" + to_string(f+1)).at<uint8_t>(s) == lj::COUNTS_AT[p.counts][f+1]);
+        CHECK(t.col("freeze_count").at<uint8_t>(s) == single.action(s));
+        CHECK(single.action(s) != dp::NO_ACTION || isnan(t.col("ev").at<double>(s)));
+    }
+
+    dp::Solver<events::LongJumpBo3> bo3(events::LongJumpBo3({8}));
+    bo3.solve();
+    const string path3 = tmp("test_arrow_bo3");
+    store::write_longjump_bo3_arrow(bo3, path3, true);
+    t = read_arrow(path3);
+    remove(path3.c_str());
+    const events::LongJumpBo3& ev3 = bo3.event();
+    CHECK(t.rows == ev3.n_states() && t.meta.at("rules") == ev3.fingerprint().text());
+    CHECK(t.col("pmf").list_size == events::LongJumpBo3::Score::N);
+    for(int s=0; s<ev3.n_states(); ++s){
+        const auto p = ev3.post_at(s);
+        CHECK(t.col("attempt").at<uint8_t>(s) == p.attempt && t.col("best").at<uint8_t>(s) == p.best);
+        CHECK(t.col("freeze_count").at<uint8_t>(s) == bo3.action(s));
+    }
+}
+
+int main(){
+    try {
+        test_writer();
+        for(int r: {5, 2}){
+            test_100m(events::M100({r}));
+            test_100m(events::M100Offset({r}));
+        }
+        test_longjump();
+    } catch(const exception& e){
+        fprintf(stderr, "%s\n", e.what());
+        CHECK(!"exception");
+    }
+    return check::result("test_arrow");
+}
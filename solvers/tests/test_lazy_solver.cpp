@@ -0,0 +1,46 @@
+// dp::LazySolver against dp::Solver: the same root moments and the same
+// decision (and, for the 100m, every action's moments) at every solved
+// state, bit for bit, with a cache that holds the event and with one small
+// enough to evict.
+#include <bits/stdc++.h>
+#include "../dp_engine.hpp"
+#include "../event_100m.hpp"
+#include "../event_longjump.hpp"
+#include "../lazy_solver.hpp"
+#include "check.hpp"
+using namespace std;
+
+static bool same(double a, double b){ return bit_cast<uint64_t>(a) == bit_cast<uint64_t>(b); }
+
+// Every stride-th solved state.
+template<class Event>
+static void compare(const Event& ev, size_t capacity, int stride){
+    dp::Solver<Event> full(ev);
+    full.solve();
+    dp::LazySolver<Event> lazy(ev, capacity);
+    const dp::Moments r = lazy.root();
+    CHECK(same(r.ev, full.root().m.ev) && same(r.ev2, full.root().m.ev2));
+    for(int s=0; s<ev.n_states(); s+=stride){
+        if(full.action(s) == dp::NO_ACTION) continue;
+        const auto d = lazy.decide_state(s);
+        CHECK(d.action == full.action(s));
+        if constexpr(Event::ACTION_MOMENTS)
+            for(int a=0; a<Event::N_ACTIONS; ++a){
+                const dp::Moments m = full.action_moments(s, a);
+                CHECK(same(d.per_action[a].ev, m.ev) && (isnan(m.ev) || same(d.per_action[a].ev2, m.ev2)));
+            }
+    }
+    if(dp::STATS) CHECK(capacity >= size_t(ev.n_chance()) || lazy.cache_stats().evictions > 0);
+}
+
+int main(){
+    for(int r: {5, 2}){
+        compare(events::M100({r}), 4096, 1);
+        compare(events::M100({r}), 64, 7);
+    }
+    compare(events::LongJump({8}), 4096, 1);
+    compare(events::LongJump({6}), 32, 5);
+    compare(events::LongJumpBo3({8}), 1 << 16, 1);
+    compare(events::LongJumpBo3({8}), 4096, 31);
+    return check::result("test_lazy_solver");
+}
@@ -0,0 +1,73 @@
+// longjump_precompute --bo3 on its own outputs: the value before the last
+// attempt with nothing scored (V[2][0]) is the single-attempt EV, V[0][0] is
+// the event EV and the mean of lj_bo3_pmf, V never falls as the best score so
+// far or the attempts left grow, and the event EV is at least that of three
+// attempts played for single-attempt EV. --exact-freeze finds no decision
+// state where freezing other dice than the k smallest/largest is better.
+#include <bits/stdc++.h>
+#include "check.hpp"
+using namespace std;
+
+static string bin;
+
+static bool near(double a, double b, double tol = 1e-9){ return fabs(a - b) <= tol; }
+
+static void test_bo3(){
+    check::Scratch tmp;
+    if(!check::run(tmp, bin + "/longjump_precompute lj.db --bo3")) return;
+    const string db = tmp / "lj.db";
+    const double attempt_ev = check::scalar(db, "SELECT value FROM lj_meta WHERE key='attempt_ev'");
+    const double bo3_ev = check::scalar(db, "SELECT value FROM lj_meta WHERE key='bo3_ev'");
+
+    map<pair<int,int>, double> v;
+    check::Query q(db, "SELECT attempt, best, ev FROM lj_bo3_value");
+    while(q.step()) v[{q.integer(0), q.integer(1)}] = q.num(2);
+    CHECK(v.count({2, 0}) && v.count({0, 0}));
+    CHECK(near(v[{2, 0}], attempt_ev));
+    CHECK(near(v[{0, 0}], bo3_ev));
+    for(const auto& [k, ev]: v){
+        const auto [a, b] = k;
+        const auto more_best = v.find({a, b+1}), fewer_left = v.find({a+1, b});
+        CHECK(ev >= b - 1e-12);
+        if(more_best != v.end()) CHECK(more_best->second >= ev - 1e-12);
+        if(fewer_left != v.end()) CHECK(fewer_left->second <= ev + 1e-12);
+    }
+
+    double mass = 0, mean = 0;
+    check::Query p(db, "SELECT score, pmf FROM lj_bo3_pmf");
+    while(p.step()){ mass += p.num(1); mean += p.integer(0) * p.num(1); }
+    CHECK(near(mass, 1) && near(mean, bo3_ev));
+
+    // E[max of three attempts] when each is played for its own EV
+    double iid = 0, prev = 0;
+    check::Query a(db, "SELECT score, cdf FROM lj_attempt_pmf ORDER BY score");
+    while(a.step()){
+        const double f3 = pow(a.num(1), 3);
+        iid += a.integer(0) * (f3 - prev);
+        prev = f3;
+    }
+    CHECK(iid > attempt_ev && bo3_ev >= iid - 1e-12);
+}
+
+static void test_exact_freeze(){
+    for(const char* args: {"--bo3", "--bo3 --max-runup 6 --objective maxprob:25"}){
+        check::Scratch tmp;
+        if(!check::run(tmp, bin + "/longjump_precompute --exact-freeze " + args)) continue;
+        ifstream log(tmp / "log");
+        int reports = 0;
+        for(string line; getline(log, line); )
+            if(line.find("another freeze is better at") != string::npos){
+                ++reports;
+                CHECK(line.find(" at 0 of ") != string::npos);
+            }
+        CHECK(reports == 2);
+    }
+}
+
+int main(int argc, char** argv){
+    if(argc < 2){ fprintf(stderr, "usage: %s BUILD_DIR\n", argv[0]); return 2; }
+    bin = filesystem::absolute(argv[1]).string();
+    test_bo3();
+    test_exact_freeze();
+    return check::result("test_longjump");
+}
@@ -0,0 +1,58 @@
+// dp::Objective and set_track_reach: a maxprob:T solve reaches T with the
+// probability reach()[T] of a tracked EV solve (root value and root PMF),
+// that is at least the EV policy's, and a meanvar:L policy scores at least
+// as well on E - L*Var as the EV policy. Objective text reads back.
+#include <bits/stdc++.h>
+#include "../dp_engine.hpp"
+#include "../event_100m.hpp"
+#include "../event_longjump.hpp"
+#include "check.hpp"
+using namespace std;
+
+static bool near(double a, double b, double tol = 1e-12){ return fabs(a - b) <= tol; }
+
+template<class Score>
+static double tail(const Score& d, int t){
+    double m = 0;
+    for(int x=max(t, Score::MIN); x<=Score::MAX; ++x) m += d[x];
+    return m;
+}
+
+template<class Event>
+static void test_event(const Event& ev, initializer_list<int> targets, double lambda){
+    using Score = typename Event::Score;
+    dp::Solver<Event> base(ev);
+    base.set_track_reach(true);
+    base.solve();
+    const auto& reach = base.reach();
+    for(int t: targets){
+        dp::Solver<Event> s(ev);
+        s.set_objective(dp::Objective::parse("maxprob:" + to_string(t)));
+        s.solve();
+        const double p = reach[t - Score::MIN];
+        CHECK(near(s.root().u, p) && near(tail(s.root().pmf, t), p));
+        CHECK(p >= tail(base.root().pmf, t) - 1e-12);
+        CHECK(p > 0 && p < 1);
+    }
+    dp::Solver<Event> mv(ev);
+    mv.set_objective({dp::Objective::MEANVAR, lambda});
+    mv.solve();
+    const auto score = [&](const dp::Moments& m){ return m.ev - lambda*m.sd()*m.sd(); };
+    CHECK(score(mv.root().m) >= score(base.root().m) - 1e-12);
+    CHECK(mv.root().m.ev <= base.root().m.ev + 1e-12);
+}
+
+int main(){
+    CHECK(dp::Objective::parse("maxprob:30").text() == "maxprob:30");
+    CHECK(dp::Objective::parse("maxprob:29.5").text() == "maxprob:30");
+    CHECK(dp::Objective::parse("meanvar:0.1").text() == "meanvar:0.1");
+    CHECK(dp::Objective::parse("ev").is_ev());
+    for(const char* bad: {"max", "maxprob:", "maxprob:3x", "meanvar:-1"}){
+        bool threw = false;
+        try { dp::Objective::parse(bad); } catch(const exception&){ threw = true; }
+        CHECK(threw);
+    }
+    test_event(events::M100({5}), {20, 25, 30}, 0.1);
+    test_event(events::LongJumpBo3({8}), {20, 25}, 0.05);
+    return check::result("test_objective");
+}
@@ -0,0 +1,45 @@
+// policy_diff over every binary policy encoding and the DB solved with it:
+// plain (--full-table), folded (the ev default) and compact 100m files, plain
+// and compact long jump files, and the folded and full 100m solves against
+// each other all match. A compact file at the default tolerance must be
+// reported as different (exit 3), so a policy_diff that passes everything
+// fails here.
+#include <bits/stdc++.h>
+#include "check.hpp"
+using namespace std;
+
+static string bin;
+
+static void diff_ok(const check::Scratch& tmp, const string& args){
+    check::run(tmp, bin + "/policy_diff " + args + " --quiet");
+}
+
+int main(int, char** argv){
+    bin = filesystem::absolute(argv[1]).string();
+    check::Scratch tmp;
+    const string m100 = bin + "/100m_precompute ", lj = bin + "/longjump_precompute ";
+    bool solved = check::run(tmp, m100 + "full.db --policy-bin full.bin --full-table");
+    solved &= check::run(tmp, m100 + "folded.db --policy-bin folded.bin");
+    solved &= check::run(tmp, m100 + "compact.db --policy-bin compact.bin --compact --full-table");
+    solved &= check::run(tmp, m100 + "folded_compact.db --policy-bin folded_compact.bin --compact");
+    solved &= check::run(tmp, m100 + "r3.db --policy-bin r3_folded.bin --max-rerolls 3");
+    solved &= check::run(tmp, lj + "lj.db --policy-bin lj.bin --bo3");
+    solved &= check::run(tmp, lj + "lj_compact.db --policy-bin lj_compact.bin --compact");
+    solved &= check::run(tmp, lj + "lj6.db --policy-bin lj6.bin --max-runup 6");
+    if(!solved) return check::result("test_policy_diff");
+
+    diff_ok(tmp, "full.db full.bin");
+    diff_ok(tmp, "folded.db folded.bin");
+    diff_ok(tmp, "full.db folded.db");
+    diff_ok(tmp, "full.db folded.bin");
+    diff_ok(tmp, "r3.db r3_folded.bin");
+    diff_ok(tmp, "full.db compact.bin --tol 0.002");
+    diff_ok(tmp, "full.db folded_compact.bin --tol 0.002");
+    diff_ok(tmp, "lj.db lj.bin");
+    diff_ok(tmp, "lj.db lj_compact.bin");
+    diff_ok(tmp, "lj_compact.db lj.db");
+    diff_ok(tmp, "lj6.db lj6.bin");
+
+    check::run(tmp, "{ " + bin + "/policy_diff full.db compact.bin --quiet; test $? -eq 3; }");
+    return check::result("test_policy_diff");
+}
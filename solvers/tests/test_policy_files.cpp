@@ -0,0 +1,113 @@
+// --policy-bin files against the DBs written in the same run: every DB row
+// has the same action at its policy::*::index, and for the 100m the same
+// moments of both actions, bit for bit (folded 100m files: within 1e-12 once
+// set1_score is added back; compact files: the stored action's, within
+// 1/512); no two rows share an index, and (long jump) every other state is
+// unreachable.
+#include <bits/stdc++.h>
+#include "../policy_format.hpp"
+#include "check.hpp"
+using namespace std;
+
+static string bin;
+namespace m100 = policy::m100;
+namespace lj = policy::longjump;
+
+// flags: --compact and/or --full-table; without --full-table the file is
+// folded (FLAG_SET1_OFFSET) and stage-2 EVs are stored without set1_score.
+static void test_100m(const string& flags){
+    const bool compact = flags.find("--compact") != string::npos;
+    const bool folded = flags.find("--full-table") == string::npos;
+    check::Scratch tmp;
+    if(!check::run(tmp, bin + "/100m_precompute 100m.db --policy-bin 100m.bin " + flags)) return;
+    const policy::File f(tmp / "100m.bin");
+    CHECK(f.event() == policy::EVENT_100M && f.compact() == compact);
+    CHECK(bool(f.header().flags & policy::FLAG_SET1_OFFSET) == folded);
+    CHECK(f.header().version == (folded ? 3u : compact ? 2u : 1u));
+    CHECK(f.n_states() == uint64_t(folded ? 2*m100::N_STAGE1 : m100::N_STATES));
+    const policy::ActionCodes action = f.actions();
+    const auto ev_f = f.section<double>(policy::ev_section(m100::FREEZE));
+    const auto sd_f = f.section<double>(policy::sd_section(m100::FREEZE));
+    const auto ev_r = f.section<double>(policy::ev_section(m100::REROLL));
+    const auto sd_r = f.section<double>(policy::sd_section(m100::REROLL));
+    const auto ev_q = f.section<int16_t>(policy::SEC_EV_Q);
+    const auto sd_q = f.section<int16_t>(policy::SEC_SD_Q);
+    const size_t n = compact ? 0 : f.n_states(), nq = compact ? f.n_states() : 0;
+    CHECK(action.size() == f.n_states() && ev_q.size() == nq && sd_q.size() == nq);
+    CHECK(ev_f.size() == n && sd_f.size() == n && ev_r.size() == n && sd_r.size() == n);
+    if(action.size() != f.n_states() || ev_q.size() != nq || ev_r.size() != n) return;
+
+    vector<bool> seen(m100::N_STATES);
+    check::Query q(tmp / "100m.db", "SELECT stage,rerolls,d1,d2,d3,d4,set1_score,"
+                                    "ev_freeze,sd_freeze,ev_reroll,sd_reroll,best FROM states100m");
+    int rows = 0;
+    while(q.step()){
+        ++rows;
+        const int d[4] = {q.integer(2), q.integer(3), q.integer(4), q.integer(5)};
+        const int idx = m100::index(q.integer(0), q.integer(1), d, q.integer(6));
+        CHECK(idx >= 0 && !seen[idx]);
+        if(idx < 0 || seen[idx]) continue;
+        seen[idx] = true;
+        const auto [s, offset] = folded ? m100::stored_index(idx, m100::N_STAGE1) : m100::Stored{idx, 0};
+        const int best = q.integer(11);
+        CHECK(action[s] == best);
+        if(compact){
+            const int col = best == m100::REROLL ? 9 : 7;
+            CHECK(fabs(policy::dequantize(ev_q[s]) + offset - q.num(col)) <= 1.0/512);
+            CHECK(fabs(policy::dequantize(sd_q[s]) - q.num(col + 1)) <= 1.0/512);
+        } else if(folded){
+            CHECK(fabs(ev_f[s] + offset - q.num(7)) <= 1e-12 && check::same(sd_f[s], q.num(8)));
+            CHECK((isnan(ev_r[s]) && isnan(q.num(9))) || fabs(ev_r[s] + offset - q.num(9)) <= 1e-12);
+            CHECK(check::same(sd_r[s], q.num(10)));
+        } else {
+            CHECK(check::same(ev_f[s], q.num(7)) && check::same(sd_f[s], q.num(8)));
+            CHECK(check::same(ev_r[s], q.num(9)) && check::same(sd_r[s], q.num(10)));
+        }
+    }
+    CHECK(rows == m100::N_STATES);
+}
+
+// The rules are unchanged, but the layout is not: the file must be rewritten.
+static void test_layout_switch(){
+    check::Scratch tmp;
+    if(!check::run(tmp, bin + "/100m_precompute 100m.db --policy-bin 100m.bin") ||
+       !check::run(tmp, bin + "/100m_precompute 100m.db --policy-bin 100m.bin --full-table")) return;
+    CHECK(policy::File(tmp / "100m.bin").n_states() == uint64_t(m100::N_STATES));
+}
+
+static void test_longjump(bool compact){
+    check::Scratch tmp;
+    if(!check::run(tmp, bin + "/longjump_precompute lj.db --policy-bin lj.bin" + (compact ? " --compact" : ""))) return;
+    const policy::File f(tmp / "lj.bin");
+    CHECK(f.event() == policy::EVENT_LONGJUMP && f.compact() == compact);
+    CHECK(f.n_states() == uint64_t(lj::N_STATES));
+    const policy::ActionCodes action = f.actions();
+    CHECK(action.size() == f.n_states());
+    if(action.size() != f.n_states()) return;
+
+    vector<bool> seen(f.n_states());
+    check::Query q(tmp / "lj.db", "SELECT phase,sum_frozen,n1,n2,n3,n4,n5,n6,freeze_count FROM lj_post_simple");
+    int rows = 0;
+    while(q.step()){
+        ++rows;
+        const int c[7] = {0, q.integer(2), q.integer(3), q.integer(4), q.integer(5), q.integer(6), q.integer(7)};
+        const int s = lj::index(q.integer(0), q.integer(1), c);
+        CHECK(s >= 0 && !seen[s]);
+        if(s < 0 || seen[s]) continue;
+        seen[s] = true;
+        CHECK(action[s] == q.integer(8));
+    }
+    CHECK(rows > 0);
+    uint64_t reachable = 0;
+    for(uint64_t i=0; i<action.size(); ++i) reachable += action[i] != lj::NO_ACTION;
+    CHECK(uint64_t(rows) == reachable);
+}
+
+int main(int argc, char** argv){
+    if(argc < 2){ fprintf(stderr, "usage: %s BUILD_DIR\n", argv[0]); return 2; }
+    bin = filesystem::absolute(argv[1]).string();
+    for(const char* flags: {"", "--compact", "--full-table", "--full-table --compact"}) test_100m(flags);
+    test_layout_switch();
+    for(bool compact: {false, true}) test_longjump(compact);
+    return check::result("test_policy_files");
+}
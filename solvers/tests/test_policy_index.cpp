@@ -0,0 +1,116 @@
+// libdecathlon_policy (decathlon_policy.h) on files written by
+// dp::write_policy_bin, for the standard and non-standard reroll budgets and
+// run-up limits: dp_state_index_* maps every state of the solver back to its
+// own index, and dp_best_action / dp_moments give the solver's action and
+// moments there. Covers plain, compact and (100m) folded files.
+#include <bits/stdc++.h>
+#include "../decathlon_policy.h"
+#include "../dp_engine.hpp"
+#include "../event_100m.hpp"
+#include "../event_longjump.hpp"
+#include "check.hpp"
+using namespace std;
+
+static filesystem::path dir;
+
+static dp_policy* open_written(const string& name){
+    dp_policy* p = dp_open((dir / name).c_str());
+    if(!p) fprintf(stderr, "%s: %s\n", name.c_str(), dp_last_error());
+    CHECK(p != nullptr);
+    return p;
+}
+
+// moments within tol of the solver's (compact files: the best action only)
+static void check_moments(const dp_policy* p, int s, int a, const dp::Moments& m, double tol){
+    double e = NAN, d = NAN;
+    const int rc = dp_moments(p, s, a, &e, &d);
+    if(isnan(m.ev)){ CHECK(rc == -1); return; }
+    CHECK(rc == 0 && fabs(e - m.ev) <= tol && fabs(d - m.sd()) <= tol);
+}
+
+static void test_100m(int max_rerolls){
+    using events::M100;
+    const M100 ev({max_rerolls});
+    dp::Solver<M100> full(ev);
+    full.solve();
+    dp::Solver<events::M100Offset> folded(events::M100Offset({max_rerolls}));
+    folded.solve();
+    const string tag = "100m_" + to_string(max_rerolls);
+    dp::write_policy_bin(full, policy::EVENT_100M, (dir / (tag + ".bin")).string(), 1);
+    dp::write_policy_bin(full, policy::EVENT_100M, (dir / (tag + "_compact.bin")).string(), 1, policy::COMPACT);
+    dp::write_policy_bin(folded, policy::EVENT_100M, (dir / (tag + "_folded.bin")).string(), 1);
+
+    for(const char* kind: {"", "_compact", "_folded"}){
+        dp_policy* p = open_written(tag + kind + ".bin");
+        if(!p) continue;
+        const bool compact = string(kind) == "_compact";
+        CHECK(dp_event(p) == DP_EVENT_100M);
+        CHECK(dp_num_states(p) == uint64_t(ev.n_states()));
+        CHECK(dp_rules_hash(p) == 1);
+        int lj_counts[6] = {0, 0, 0, 0, 0, 0};
+        CHECK(dp_state_index_longjump(p, DP_LJ_JUMP_POST, 0, lj_counts) == -1);
+        for(int s=0; s<ev.n_states(); ++s){
+            const M100::State st = ev.state_at(s);
+            int d[4];
+            for(int k=0; k<4; ++k) d[k] = dice::OUTCOMES<4>[st.pat].dice[k];
+            reverse(d, d + 4);                               // any order
+            CHECK(dp_state_index_100m(p, st.stage, st.rerolls, d, st.stage==1 ? 99 : st.set1_score) == s);
+            if(max_rerolls == policy::m100::MAX_REROLLS)
+                CHECK(dp_index_100m(st.stage, st.rerolls, d, st.set1_score) == s);
+            const int a = full.action(s);
+            CHECK(dp_best_action(p, s) == a);
+            if(compact) check_moments(p, s, a, full.action_moments(s, a), 1.0/512);
+            else for(int b=0; b<M100::N_ACTIONS; ++b) check_moments(p, s, b, full.action_moments(s, b), 1e-9);
+        }
+        int d[4] = {1, 2, 3, 4};
+        CHECK(dp_state_index_100m(p, 1, max_rerolls + 1, d, 0) == -1);
+        CHECK(dp_state_index_100m(p, 2, 0, d, policy::m100::S1_MAX + 1) == -1);
+        CHECK(dp_best_action(p, int32_t(ev.n_states())) == -1);
+        dp_close(p);
+    }
+}
+
+static void test_longjump(int max_runup){
+    using events::LongJump;
+    namespace lj = events::lj;
+    const LongJump ev({max_runup});
+    dp::Solver<LongJump> full(ev);
+    full.solve();
+    const string tag = "longjump_" + to_string(max_runup);
+    dp::write_policy_bin(full, policy::EVENT_LONGJUMP, (dir / (tag + ".bin")).string(), 2);
+    dp::write_policy_bin(full, policy::EVENT_LONGJUMP, (dir / (tag + "_compact.bin")).string(), 2, policy::COMPACT);
+
+    for(const char* kind: {"", "_compact"}){
+        dp_policy* p = open_written(tag + kind + ".bin");
+        if(!p) continue;
+        CHECK(dp_event(p) == DP_EVENT_LONGJUMP);
+        CHECK(dp_num_states(p) == uint64_t(ev.n_states()));
+        int d[4] = {1, 1, 1, 1};
+        CHECK(dp_state_index_100m(p, 1, 0, d, 0) == -1);
+        for(int s=0; s<ev.n_states(); ++s){
+            const LongJump::Post post = ev.post_at(s);
+            int counts[6];
+            for(int f=0; f<6; ++f) counts[f] = lj::COUNTS_AT[post.counts][f+1];
+            CHECK(dp_state_index_longjump(p, post.phase, post.sum_frozen, counts) == s);
+            if(max_runup == policy::longjump::MAX_RUNUP)
+                CHECK(dp_index_longjump(post.phase, post.sum_frozen, counts) == s);
+            const int a = full.action(s);
+            CHECK(dp_best_action(p, s) == (a == dp::NO_ACTION ? -1 : a));
+        }
+        int counts[6] = {0, 0, 0, 0, 0, 0};
+        CHECK(dp_state_index_longjump(p, DP_LJ_RUNUP_POST, max_runup + 1, counts) == -1);
+        counts[0] = 6;
+        CHECK(dp_state_index_longjump(p, DP_LJ_JUMP_POST, 0, counts) == -1);
+        dp_close(p);
+    }
+}
+
+int main(){
+    dir = filesystem::temp_directory_path() / ("test_policy_index." + to_string(getpid()));
+    filesystem::create_directories(dir);
+    for(int r: {5, 3}) test_100m(r);
+    for(int r: {8, 6}) test_longjump(r);
+    CHECK(dp_open((dir / "missing.bin").c_str()) == nullptr && *dp_last_error());
+    filesystem::remove_all(dir);
+    return check::result("test_policy_index");
+}
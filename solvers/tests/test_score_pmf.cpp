@@ -0,0 +1,148 @@
+// Score distributions (score_pmf.hpp): pmf::Pmf and pmf::convolve on small
+// known cases, and the root PMFs the solvers store (pmf100m, lj_attempt_pmf):
+// mass 1, a CDF that ends at 1, and a mean equal to the EV stored next to
+// them (the binary policy's root_ev, lj_meta attempt_ev). decathlon_total's
+// table of the total is the convolution of the tables it is given, and two
+// --shard processes sharing a --work-dir write the same target tables as one
+// unsharded run.
+#include <bits/stdc++.h>
+#include "../policy_format.hpp"
+#include "../score_pmf.hpp"
+#include "check.hpp"
+using namespace std;
+
+static string bin;
+
+static bool near(double a, double b, double tol = 1e-12){ return fabs(a - b) <= tol; }
+
+static void test_pmf(){
+    using P = pmf::Pmf<-2, 3>;
+    P d = P::point(1);
+    CHECK(d.mass() == 1 && d.mean() == 1 && d.sd() == 0);
+    // {1: 1/2, 3: 1/4, -1: 1/4}; the shift to 4 falls outside and is dropped
+    P e;
+    e.add(d, 0.5);
+    e.add(d, 0.25, 2);
+    e.add(d, 0.25, -2);
+    e.add(d, 0.125, 3);
+    CHECK(e[1] == 0.5 && e[3] == 0.25 && e[-1] == 0.25 && e[0] == 0);
+    CHECK(near(e.mass(), 1) && near(e.mean(), 0.5 + 0.75 - 0.25));
+    CHECK(near(e.sd(), sqrt(0.5*0.0 + 0.25*4 + 0.25*4)));
+    const auto c = e.cdf();
+    CHECK(c[0] == 0 && c[1] == 0.25 && c[3] == 0.75 && c[5] == 1);
+}
+
+static void test_convolve(){
+    // {-1, 0} uniform + {2: 1/4, 4: 3/4} = {1: 1/8, 2: 1/8, 3: 3/8, 4: 3/8}
+    const pmf::Dist a{-1, {0.5, 0.5}}, b{2, {0.25, 0.0, 0.75}};
+    const pmf::Dist c = pmf::convolve(a, b);
+    CHECK(c.lo == 1 && c.hi() == 4);
+    CHECK(c.at(1) == 0.125 && c.at(2) == 0.125 && c.at(3) == 0.375 && c.at(4) == 0.375);
+    CHECK(c.at(0) == 0 && c.at(5) == 0);
+    CHECK(c.mean() == a.mean() + b.mean() && c.tail(3) == 0.75);
+    CHECK(near(c.sd()*c.sd(), a.sd()*a.sd() + b.sd()*b.sd()));
+    const pmf::Dist shifted = pmf::convolve(pmf::Dist::point(5), b);
+    CHECK(shifted.lo == 7 && shifted.p == b.p);
+    CHECK(pmf::convolve(a, pmf::Dist{}).p.empty());
+}
+
+static pmf::Dist read_dist(const string& db, const string& table){
+    pmf::Dist d;
+    check::Query q(db, "SELECT score, pmf FROM " + table + " ORDER BY score");
+    while(q.step()){
+        if(d.p.empty()) d.lo = q.integer(0);
+        d.p.resize(q.integer(0) - d.lo + 1);
+        d.p.back() = q.num(1);
+    }
+    return d;
+}
+
+// mass, CDF and mean of table(score, pmf, cdf)
+static void check_table(const string& db, const string& table, double ev){
+    check::Query q(db, "SELECT score, pmf, cdf FROM " + table + " ORDER BY score");
+    double mass = 0, mean = 0, last_cdf = 0;
+    int rows = 0;
+    while(q.step()){
+        ++rows;
+        mass += q.num(1);
+        mean += q.integer(0) * q.num(1);
+        CHECK(q.num(1) >= 0 && near(q.num(2), mass, 1e-12));
+        last_cdf = q.num(2);
+    }
+    CHECK(rows > 0);
+    CHECK(near(mass, 1, 1e-12) && near(last_cdf, 1, 1e-12));
+    CHECK(near(mean, ev, 1e-9));
+}
+
+static void test_100m(){
+    check::Scratch tmp;
+    if(!check::run(tmp, bin + "/100m_precompute 100m.db --policy-bin 100m.bin")) return;
+    const policy::File f(tmp / "100m.bin");
+    check_table(tmp / "100m.db", "pmf100m", f.header().root_ev);
+}
+
+static void test_longjump(){
+    check::Scratch tmp;
+    if(!check::run(tmp, bin + "/longjump_precompute lj.db")) return;
+    const double ev = check::scalar(tmp / "lj.db", "SELECT value FROM lj_meta WHERE key='attempt_ev'");
+    CHECK(ev > 0);
+    check_table(tmp / "lj.db", "lj_attempt_pmf", ev);
+}
+
+// Events with a fixed PMF only: the total is their convolution, and playing
+// for a target cannot change it.
+static void test_total(){
+    check::Scratch tmp;
+    if(!check::run(tmp, bin + "/100m_precompute 100m.db") || !check::run(tmp, bin + "/longjump_precompute lj.db")) return;
+    if(!check::run(tmp, bin + "/decathlon_total total.db --pmf sprint=100m.db:pmf100m"
+                              " --pmf jump=lj.db:lj_attempt_pmf --pmf again=100m.db:pmf100m --target 45")) return;
+    const pmf::Dist s = read_dist(tmp / "100m.db", "pmf100m"), j = read_dist(tmp / "lj.db", "lj_attempt_pmf");
+    const pmf::Dist want = pmf::convolve(pmf::convolve(s, j), s);
+    const pmf::Dist got = read_dist(tmp / "total.db", "decathlon_total");
+    CHECK(got.p.size() <= want.p.size());
+    for(int x=want.lo; x<=want.hi(); ++x) CHECK(near(got.at(x), want.at(x), 1e-15));
+    check::Query q(tmp / "total.db", "SELECT p_ev_play, p_target_play FROM decathlon_target WHERE target=45");
+    CHECK(q.step() && near(q.num(0), want.tail(45)) && near(q.num(1), q.num(0)));
+}
+
+// Every row of `sql` as numbers, in its order.
+static vector<vector<double>> rows(const string& db, const string& sql, int cols){
+    vector<vector<double>> out;
+    check::Query q(db, sql);
+    while(q.step()){
+        out.emplace_back();
+        for(int i=0; i<cols; ++i) out.back().push_back(q.num(i));
+    }
+    return out;
+}
+
+static void test_shards(){
+    check::Scratch tmp;
+    if(!check::run(tmp, bin + "/100m_precompute 100m.db") || !check::run(tmp, bin + "/longjump_precompute lj.db --bo3")) return;
+    const string total = bin + "/decathlon_total ", events = " --100m 100m.db --longjump lj.db --target 40 --target 45";
+    if(!check::run(tmp, total + "all.db" + events)) return;
+    if(!check::run(tmp, "{ " + total + "s0.db" + events + " --shard 0/2 --work-dir w & " +
+                        total + "s1.db" + events + " --shard 1/2 --work-dir w; r1=$?; wait $!; r0=$?;"
+                        " test $r0 -eq 0 -a $r1 -eq 0; }")) return;
+    const pair<const char*, int> tables[] = {
+        {"SELECT * FROM decathlon_target ORDER BY target", 5},
+        {"SELECT * FROM decathlon_target_value ORDER BY target, position, total_before", 4},
+        {"SELECT * FROM decathlon_target_pmf ORDER BY target, score", 3},
+    };
+    for(const auto& [sql, cols]: tables){
+        const auto want = rows(tmp / "all.db", sql, cols);
+        CHECK(!want.empty() && rows(tmp / "s0.db", sql, cols) == want);
+    }
+}
+
+int main(int argc, char** argv){
+    if(argc < 2){ fprintf(stderr, "usage: %s BUILD_DIR\n", argv[0]); return 2; }
+    bin = filesystem::absolute(argv[1]).string();
+    test_pmf();
+    test_convolve();
+    test_100m();
+    test_longjump();
+    test_total();
+    test_shards();
+    return check::result("test_score_pmf");
+}